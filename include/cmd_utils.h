@@ -1,6 +1,13 @@
 #ifndef CMD_UTILS_H
 #define CMD_UTILS_H
 
+#include <stdint.h>
+
+#include "inode.h"
+
 int split_path(const char* path, char* dir_path, char* ir_name);
+int parse_number(const char* num_str, uint32_t* number);
+int parse_offset(const char* num_str, uint64_t* number);
+int create_file(struct inode* inode_new, const char* path);
 
 #endif
@@ -32,6 +32,15 @@ enum error_ {
     Err_os_open_file		= 1021,
 	Err_os_file_too_big		= 1022,
 	Err_malloc				= 1023,
+	Err_arg_nan				= 1024,
+	Err_fd_invalid			= 1025,
+	Err_fd_limit			= 1026,
+	Err_fs_no_feature		= 1027,
+	Err_block_shares_limit	= 1028,
+	Err_data_corrupted		= 1029,
+	Err_fs_block_size		= 1030,
+	Err_archive_invalid		= 1031,
+	Err_arg_invalid			= 1032,
 };
 
 extern enum error_ my_errno;
@@ -13,46 +13,133 @@
 
 int init_filesystem(const char* fsp, bool* is_formatted);
 void close_filesystem();
-uint32_t get_count_data_blocks(const off_t file_size);
+uint32_t get_count_data_blocks(const uint64_t file_size);
 bool is_enough_space(const uint32_t count_blocks, const uint32_t count_empty_blocks);
+size_t get_max_name_length();
 
 // FILESYSTEM BITMAP FUNCTIONS
 
 uint32_t allocate_bitmap_field_inode();
 uint32_t allocate_bitmap_field_data();
+uint32_t allocate_bitmap_range_data(const uint32_t goal, const uint32_t wanted, uint32_t* allocated);
 void free_bitmap_field_inode(int32_t id);
+void free_bitmap_range_inode(const uint32_t id, const uint32_t length);
 void free_bitmap_field_data(int32_t id);
+void free_bitmap_range_data(const uint32_t id, const uint32_t length);
 uint32_t get_empty_fields_amount_data();
 void read_whole_bitmap_inodes(bool* bitmap);
 void read_whole_bitmap_data(bool* bitmap);
 
+// FILESYSTEM REFERENCE COUNT FUNCTIONS
+
+uint16_t get_block_shares(const uint32_t id);
+int share_blocks(const uint32_t id, const uint32_t length);
+size_t unshare_blocks(const uint32_t id, const uint32_t length, bool* is_shared);
+
+// FILESYSTEM DEDUPLICATION FUNCTIONS
+
+uint32_t dedup_find_block(const char* block, const uint32_t id_exclude);
+void dedup_add_block(const char* block, const uint32_t id);
+void dedup_remove_blocks(const uint32_t id, const uint32_t length);
+int64_t dedup_file(struct inode* inode_target);
+
+// FILESYSTEM COMPRESSION FUNCTIONS
+
+int incp_data_compressed(struct inode* inode_target, FILE* file, const uint64_t limit, uint64_t* size);
+size_t read_compressed_data(const struct inode* inode_source, char* buffer, const uint64_t offset, const size_t length);
+int outcp_data_compressed(const struct inode* inode_source, FILE* file);
+int expand_compressed_file(struct inode* inode_target);
+
 // FILESYSTEM INODE FUNCTIONS
 
 int free_inode_file(struct inode* id_inode);
+int unlink_inode_file(struct inode* inode_target);
 int free_inode_directory(struct inode* id_inode);
+int free_inodes_released(struct inode* inodes, const size_t count);
 uint32_t create_inode_file(struct inode* new_inode);
 uint32_t create_inode_directory(struct inode* new_inode, const uint32_t id_parent);
+bool fits_inline(const uint64_t size);
+int set_inline_data(struct inode* inode_target, const char* data, const uint32_t size);
+int expand_inline_file(struct inode* inode_target);
+int expand_inline_directory(struct inode* inode_dir);
+
+// FILESYSTEM EXTENT FUNCTIONS
+
+int iterate_extents(const struct inode* inode_source, void* carry, bool (*callback)());
+uint32_t bmap_extents(const struct inode* inode_source, const uint32_t logical_block);
+struct extent* get_extents(const struct inode* inode_source, size_t* count);
+int free_all_extents(struct inode* inode_source);
+int collect_extent_blocks(const struct inode* inode_source, struct carry_links* carry);
+int free_amount_of_extents(struct inode* inode_target, const size_t to_free);
+int create_empty_extents(uint32_t* buffer, const size_t to_create, struct inode* inode_source);
+int create_extents_at(uint32_t* buffer, const uint32_t logical_block, const size_t to_create, struct inode* inode_source);
+int free_extents_range(struct inode* inode_target, const uint32_t logical_block, const size_t to_free);
+int remap_extents(struct inode* inode_target, const uint32_t logical_block, const uint32_t start, const uint32_t length);
+int share_extents(const struct inode* inode_source, struct inode* inode_target);
 
 // FILESYSTEM LINK FUNCTIONS
 
+uint32_t bmap(const struct inode* inode_source, const uint32_t logical_block);
+uint32_t get_count_mapped_blocks(const struct inode* inode_source);
+int free_all_links(struct inode* inode_source);
+int collect_all_blocks(const struct inode* inode_source, struct carry_links* carry);
+int free_blocks(uint32_t* ids, const size_t count);
 int free_amount_of_links(struct inode* inode_target, const size_t to_free);
 int create_empty_links(uint32_t* buffer, const size_t to_create, struct inode* inode_source);
+int create_links_at(uint32_t* buffer, const uint32_t logical_block, const size_t to_create, struct inode* inode_source);
+int preallocate_links(struct inode* inode_target, const uint32_t logical_block, const size_t count);
+int free_links_range(struct inode* inode_target, const uint32_t logical_block, const size_t to_free);
+int share_links(const struct inode* inode_source, struct inode* inode_target);
+int map_links_at(struct inode* inode_target, const uint32_t logical_block, const uint32_t start, const uint32_t length);
 
 // FILESYSTEM DATA BLOCK FUNCTIONS
 
+struct directory_item* alloc_dir_items();
 int init_block_with_directories(const uint32_t id_block);
 int init_empty_dir_block(struct directory_item* block, const uint32_t id_self, const uint32_t id_parent);
-int incp_data_inplace(const uint32_t* links, const uint32_t links_count, FILE* file);
+bool has_space_for_record(const struct directory_item* block, const char* name);
+int incp_data_sparse(struct inode* inode_target, FILE* file, const uint64_t limit, uint64_t* size);
+int64_t sync_data_sparse(struct inode* inode_target, FILE* file);
+int incp_data_inline(struct inode* inode_target, FILE* file);
+int outcp_data_sparse(const struct inode* inode_source, FILE* file);
+int outcp_data_inline(const struct inode* inode_source, FILE* file);
+int copy_data_sparse(const struct inode* inode_source, struct inode* inode_target);
+int cat_data_inline(const struct inode* inode_source);
+int cat_data_range(const struct inode* inode_source, const uint64_t offset, const uint64_t length);
+
+// FILESYSTEM FILE FUNCTIONS
+
+size_t read_file_data(const struct inode* inode_source, char* buffer, const uint64_t offset, const size_t length);
+int64_t write_file_data(struct inode* inode_target, const char* buffer, const uint64_t offset, const size_t length);
+int preallocate_file(struct inode* inode_target, const uint64_t size);
+int file_open(const char* path);
+int file_close(const int fd);
+void file_close_all();
+void file_close_inode(const uint32_t id_inode);
+void file_reload_all();
+int64_t file_read(const int fd, char* buffer, const size_t length);
+int64_t file_write(const int fd, const char* buffer, const size_t length);
+int64_t file_pread(const int fd, char* buffer, const size_t length, const uint64_t offset);
+int64_t file_pwrite(const int fd, const char* buffer, const size_t length, const uint64_t offset);
+int64_t file_seek(const int fd, const int64_t offset, const int whence);
+int file_truncate(const int fd, const uint64_t size);
 
 // FILESYSTEM UTILS FUNCTIONS
 
 int get_inode(struct inode* inode_dest, const char* path);
 int get_inode_wparent(struct inode* inode_dest, struct inode* inode_parent, const char* path);
+uint32_t get_parent_inode_id(const struct inode* inode_child);
+int set_parent_inode_id(struct inode* inode_child, const uint32_t id_parent);
 int get_path_to_root(char* dest_path, const size_t length_path, const struct inode* inode_source);
 int add_to_parent(struct inode* inode_parent, struct carry_dir_item* carry);
+int remove_from_parent(struct inode* inode_parent, struct carry_dir_item* carry);
+int compact_directory(struct inode* inode_dir);
 bool is_directory_empty(const struct inode* inode_source);
 bool item_exists(const struct inode* inode_parent, const char* dir_name);
-int update_size(struct inode* inode_target, const uint32_t file_size);
+int update_size(struct inode* inode_target, const uint64_t file_size);
+int load_inodes(struct inode* inodes, const uint32_t* ids, const size_t count);
+int collect_tree(const struct inode* inode_root, struct tree_item** tree, size_t* count);
+int free_tree(struct tree_item* tree, const size_t count);
 int load_inode_ids(bool* inode_ids, const size_t ids_count, int* active);
 
 // FILESYSTEM INPUT/OUTPUT FUNCTIONS
@@ -62,12 +149,21 @@ size_t fs_read_inode(struct inode* buffer, const size_t count, const uint32_t id
 size_t fs_read_directory_item(struct directory_item* buffer, const size_t count, const uint32_t id);
 size_t fs_read_link(uint32_t* buffer, const size_t count, const uint32_t id);
 size_t fs_read_data(char* buffer, const size_t count, const uint32_t id);
+size_t fs_read_refcount(uint16_t* buffer, const size_t count, const uint32_t id);
+size_t fs_read_dedup_entry(struct dedup_entry* buffer, const size_t count, const uint32_t slot);
+size_t fs_read_dedup_slot(uint32_t* buffer, const size_t count, const uint32_t id);
 // write
 size_t fs_write_inode(const struct inode* buffer, const size_t count, const uint32_t id);
 size_t fs_write_directory_item(const struct directory_item* buffer, const size_t count, const uint32_t id);
 size_t fs_write_link(const uint32_t* buffer, const size_t count, const uint32_t id);
 size_t fs_write_data(const char* buffer, const size_t count, const uint32_t id);
+size_t fs_write_blocks(const char* buffer, const size_t count, const uint32_t id);
+size_t fs_write_refcount(const uint16_t* buffer, const size_t count, const uint32_t id);
+size_t fs_write_dedup_entry(const struct dedup_entry* buffer, const size_t count, const uint32_t slot);
+size_t fs_write_dedup_slot(const uint32_t* buffer, const size_t count, const uint32_t id);
 // flush
 void fs_flush();
+// cache
+void fs_reset_link_cache();
 
 #endif
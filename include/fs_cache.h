@@ -8,6 +8,7 @@ extern struct inode inode_actual;
 
 extern char fs_name[];
 extern char buff_pwd[];
+extern char buff_cwd[];
 extern char buff_prompt[];
 
 #endif
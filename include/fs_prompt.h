@@ -7,6 +7,9 @@
 // buffer size of pwd
 #define STRLEN_PWD_LENGTH	101
 
+// buffer size of whole path to working directory (pwd is its shortened tail)
+#define STRLEN_CWD_LENGTH	4096
+
 // +3 for ":> " in FORMAT_PROMPT
 #define BUFFER_PROMPT_LENGTH 	(STRLEN_FS_NAME + STRLEN_PWD_LENGTH + 3)
 
@@ -3,9 +3,16 @@
 
 #include <stdint.h>
 
+// 255 chars + \0 = 256 chars in total for item name in memory
+#define STRLEN_ITEM_NAME 		256
 // 7 chars (name) + dot + 3 chars (extension) + \0 =
-// = 12 chars in total for item name
-#define STRLEN_ITEM_NAME 		12
+// = 12 chars in total for item name in fixed size directory record
+#define STRLEN_RECORD_NAME		12
+
+// variable-length directory record is:
+//  id of i-node (4 B) | record length (2 B) | name length (1 B) | name (without \0)
+#define DIR_RECORD_HEADER		7
+#define DIR_RECORD_MIN			(DIR_RECORD_HEADER + 1)		// record with one char name
 
 #define ROOT_ID					1
 
@@ -14,7 +21,46 @@
 #define COUNT_INDIRECT_LINKS_1	1
 #define COUNT_INDIRECT_LINKS_2	1
 
+// size of data, which can be stored inline in inode in place of its links
+#define INODE_INLINE_SIZE		((COUNT_DIRECT_LINKS + COUNT_INDIRECT_LINKS_1 \
+								+ COUNT_INDIRECT_LINKS_2) * sizeof(uint32_t))
+
+// extents stored in inode in place of links, last link is link to block with more extents
+#define COUNT_INODE_EXTENTS		2
+// block with extents is: id of next block (4 B) | count of extents (4 B) | extents
+#define EXTENT_BLOCK_HEADER		2
+
+// data of compressed file are compressed by clusters of blocks, cluster stored in fewer blocks
+// is compressed -- its first block starts with length of compressed data (4 B)
+#define COMPRESS_CLUSTER		16
+
+// flags of inode
+#define INODE_FLAG_INLINE		0x1		// data are stored inline in inode, there are no links
+#define INODE_FLAG_EXTENTS		0x2		// data blocks are mapped by extents instead of links
+#define INODE_FLAG_COMPRESSED	0x4		// data are compressed by clusters of blocks
+#define INODE_FLAG_PREALLOC		0x8		// data blocks are preallocated behind end of file, they are unwritten
+
+// signature of filesystem with current layout, images of 32b layout are signed "kmat95"
+#define FS_SIGNATURE			"kmat95-64"
+
+// features of filesystem
+#define FS_FEATURE_INLINE_DATA	0x1		// small files and empty directories are stored inline
+#define FS_FEATURE_DIR_VARLEN	0x2		// directory blocks have variable-length records
+#define FS_FEATURE_EXTENTS		0x4		// files are mapped by extents
+#define FS_FEATURE_REFLINK		0x8		// data blocks can be shared by files, see 'addr_refcounts'
+#define FS_FEATURE_DEDUP		0x10	// identical data blocks are shared, see 'addr_dedup_index' (needs reflink)
+#define FS_FEATURE_COMPRESSION	0x20	// files can be compressed
+#define FS_FEATURE_64BIT		0x40	// addresses of regions and sizes of files are 64b
+
 #define mb2b(mb)	((mb)*1024UL*1024UL)
+#define isinline(p_inode)		((p_inode)->flags & INODE_FLAG_INLINE)
+#define inline_data(p_inode)	((char*) (p_inode)->direct)
+#define isextent(p_inode)		((p_inode)->flags & INODE_FLAG_EXTENTS)
+#define iscompressed(p_inode)	((p_inode)->flags & INODE_FLAG_COMPRESSED)
+#define isprealloc(p_inode)		((p_inode)->flags & INODE_FLAG_PREALLOC)
+#define inode_extents(p_inode)	((struct extent*) (p_inode)->direct)
+#define extent_block(p_inode)	((p_inode)->indirect_2[0])
+#define dir_record_size(name_length)	(DIR_RECORD_HEADER + (name_length))
 
 // types of inodes in filesystem
 enum item {
@@ -31,27 +77,62 @@ struct superblock {
 	uint32_t block_count;			// block count in data part of filesystem
 	uint32_t count_links;			// maximum count of indirect links in block
 	uint32_t count_dir_items;		// maximum count of directory items in block
-	uint32_t addr_bm_inodes;		// address of start of i-nodes bitmap
-	uint32_t addr_bm_data;			// address of start of data bitmap
-	uint32_t addr_inodes;			// address of start of i-nodes
-	uint32_t addr_data;				// address of start of data
-	uint32_t max_file_size;			// maximal size of file
+	uint64_t addr_bm_inodes;		// address of start of i-nodes bitmap
+	uint64_t addr_bm_data;			// address of start of data bitmap
+	uint64_t addr_inodes;			// address of start of i-nodes
+	uint64_t addr_data;				// address of start of data
+	uint64_t max_file_size;			// maximal size of file
+	uint32_t features;				// features of filesystem (FS_FEATURE_*)
+	uint64_t addr_refcounts;		// address of start of reference counts of data blocks
+	uint64_t addr_dedup_index;		// address of start of index of data blocks by their hash
+	uint64_t addr_dedup_slots;		// address of start of index slots of data blocks
 };
 
 struct inode {
 	uint32_t id_inode;								// i-node id
 	enum item inode_type;							// type of item in filesystem
-	uint32_t file_size;								// size of file in Bytes
+	uint64_t file_size;								// size of file in Bytes
+	uint32_t flags;									// flags of inode (INODE_FLAG_*)
+	uint32_t nlink;									// count of directory items linking the inode
 	uint32_t direct[COUNT_DIRECT_LINKS];			// direct links
 	uint32_t indirect_1[COUNT_INDIRECT_LINKS_1];	// indirect links level 1 (pointer-data)
 	uint32_t indirect_2[COUNT_INDIRECT_LINKS_2];	// indirect links level 2 (pointer-pointer-data)
 };
 
+// continuous run of data blocks of file
+struct extent {
+	uint32_t logical;	// index of first block of the run in file
+	uint32_t start;		// id of first data block of the run
+	uint32_t length;	// count of data blocks in the run
+};
+
+#define DEDUP_PROBES			8		// count of entries in index of data blocks checked for one hash
+
+// entry of index of data blocks by their hash, free entry has id 'FREE_LINK'
+struct dedup_entry {
+	uint32_t hash;		// hash of data in the block
+	uint32_t id;		// id of data block
+};
+
+// directory item in memory, independent of format of directory blocks
 struct directory_item {
 	uint32_t id_inode;					// i-node of file
 	char item_name[STRLEN_ITEM_NAME];	// name of item in directory
 };
 
+// item of directory tree in memory, items are ordered, so parent is always before its children
+struct tree_item {
+	struct inode inode;					// i-node of the item
+	uint32_t parent;					// index of parent item, root item is its own parent
+	char name[STRLEN_ITEM_NAME];		// name of item in parent directory
+};
+
+// fixed size directory record in block
+struct directory_record {
+	uint32_t id_inode;					// i-node of file
+	char item_name[STRLEN_RECORD_NAME];	// name of item in directory
+};
+
 #endif
 
 /*
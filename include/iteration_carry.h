@@ -17,20 +17,24 @@ int iterate_links(const struct inode* inode_source, void* carry, bool (*callback
 struct carry_dir_item {
 	uint32_t id;
 	char name[STRLEN_ITEM_NAME];
+	bool is_block_empty;	// block with deleted item has no other items
 };
 
-struct carry_stream {
-	FILE* file;
-	off_t data_count;
+struct carry_items {
+	struct directory_item* items;
+	size_t count;
+	size_t capacity;
 };
 
-struct carry_copy {
-	uint32_t* dest_links;
-	size_t links_count;
+struct carry_links {
+	uint32_t* links;
+	size_t count;
+	size_t capacity;
 };
 
 struct carry_fsck {
 	bool* inode_ids;
+	uint32_t* nlinks;	// count of found directory items linking each inode
 	int active;
 };
 
@@ -40,11 +44,9 @@ ITERABLE(add_block_item);
 ITERABLE(delete_block_item);
 ITERABLE(has_common_directories);
 ITERABLE(has_space_for_dir);
-ITERABLE(list_items);
-ITERABLE(incp_data);
-ITERABLE(outcp_data);
+ITERABLE(collect_items);
+ITERABLE(collect_links);
 ITERABLE(cat_data);
-ITERABLE(copy_data);
 ITERABLE(filter_correct_ids);
 
 #endif
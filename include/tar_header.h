@@ -0,0 +1,30 @@
+#ifndef TAR_HEADER_H
+#define TAR_HEADER_H
+
+#define TAR_BLOCK		512				// archive is made of blocks of this size
+#define TAR_NAME		100				// length of name in header
+#define TAR_PREFIX		155				// length of name prefix in header
+#define TAR_SIZE_MAX	077777777777ULL	// biggest size, which fits into header
+
+// header of item in POSIX (ustar) tar archive
+struct tar_header {
+	char name[TAR_NAME];
+	char mode[8];
+	char uid[8];
+	char gid[8];
+	char size[12];
+	char mtime[12];
+	char chksum[8];
+	char typeflag;
+	char linkname[TAR_NAME];
+	char magic[6];
+	char version[2];
+	char uname[32];
+	char gname[32];
+	char devmajor[8];
+	char devminor[8];
+	char prefix[TAR_PREFIX];
+	char pad[12];
+};
+
+#endif
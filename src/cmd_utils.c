@@ -1,8 +1,14 @@
+#include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
+#include <ctype.h>
+#include <errno.h>
 #include <libgen.h>
 
 #include "cmd_utils.h"
+#include "fs_api.h"
 #include "inode.h"
+#include "iteration_carry.h"
 
 #include "errors.h"
 
@@ -25,7 +31,7 @@ int split_path(const char* path, char* const dir_path, char* const dir_name) {
 	p_copy_dirname = dirname(copy_dirname);
 	p_copy_basename = basename(copy_basename);
 
-	if (strlen(p_copy_basename) < STRLEN_ITEM_NAME) {
+	if (strlen(p_copy_basename) <= get_max_name_length()) {
 		// copy dir path and name
 		strncpy(dir_path, p_copy_dirname, strlen(p_copy_dirname) + 1);
 		strncpy(dir_name, p_copy_basename, strlen(p_copy_basename) + 1);
@@ -36,3 +42,87 @@ int split_path(const char* path, char* const dir_path, char* const dir_name) {
 		return RETURN_FAILURE;
 	}
 }
+
+/*
+ * Convert given string to non-negative offset or size in file (64b).
+ * Whole string must be made of digits.
+ */
+int parse_offset(const char* num_str, uint64_t* number) {
+	size_t i;
+	unsigned long long num = 0;
+
+	if (strlen(num_str) == 0) {
+		set_myerrno(Err_arg_missing);
+		return RETURN_FAILURE;
+	}
+	for (i = 0; i < strlen(num_str); ++i) {
+		if (!isdigit(num_str[i])) {
+			set_myerrno(Err_arg_nan);
+			return RETURN_FAILURE;
+		}
+	}
+
+	errno = 0;
+	num = strtoull(num_str, NULL, 10);
+	if (errno != 0) {
+		set_myerrno(Err_arg_nan);
+		return RETURN_FAILURE;
+	}
+
+	*number = (uint64_t) num;
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Convert given string to non-negative number. Whole string must be made of digits.
+ */
+int parse_number(const char* num_str, uint32_t* number) {
+	uint64_t num = 0;
+
+	if (parse_offset(num_str, &num) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+	if (num > UINT32_MAX) {
+		set_myerrno(Err_arg_nan);
+		return RETURN_FAILURE;
+	}
+
+	*number = (uint32_t) num;
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Create new empty file with given path. Parent directory must exist.
+ */
+int create_file(struct inode* inode_new, const char* path) {
+	char dir_path[strlen(path) + 1];
+	char dir_name[STRLEN_ITEM_NAME] = {0};
+	struct inode inode_parent = {0};
+	struct carry_dir_item carry_dir = {0};
+
+	if (split_path(path, dir_path, dir_name) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+	if (get_inode(&inode_parent, dir_path) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+	if (inode_parent.inode_type != Inode_type_dirc) {
+		set_myerrno(Err_item_not_directory);
+		return RETURN_FAILURE;
+	}
+	if (item_exists(&inode_parent, dir_name)) {
+		set_myerrno(Err_item_exists);
+		return RETURN_FAILURE;
+	}
+	if (create_inode_file(inode_new) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+
+	carry_dir.id = inode_new->id_inode;
+	strncpy(carry_dir.name, dir_name, strlen(dir_name));
+	if (add_to_parent(&inode_parent, &carry_dir) == RETURN_FAILURE) {
+		free_inode_file(inode_new);
+		return RETURN_FAILURE;
+	}
+	return RETURN_SUCCESS;
+}
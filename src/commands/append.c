@@ -0,0 +1,109 @@
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fs_api.h"
+#include "fs_cache.h"
+#include "inode.h"
+#include "cmd_utils.h"
+
+#include "logger.h"
+#include "errors.h"
+
+// system io
+extern size_t stream_incp(char* buffer, const size_t count, FILE* stream);
+
+
+/*
+ * Append file from normal filesystem to end of file in simulation filesystem.
+ * File is created, if it does not exist. Existing data are not rewritten,
+ * only blocks behind end of file are created and the last partial block is completed.
+ */
+int sim_append(const char* path_source, const char* path_target) {
+	log_info("append: [%s] [%s]", path_source, path_target);
+
+	struct stat st = {0};
+	FILE* f_source = NULL;
+	char* buffer = NULL;
+	size_t read = 0;
+	size_t to_read = 0;
+	size_t buffer_size = 0;
+	uint32_t count_blocks = 0;
+	uint32_t count_prealloc = 0;
+	uint32_t count_empty_blocks = 0;
+	struct inode inode_target = {0};
+
+	// CONTROL
+
+	if (strlen(path_source) == 0 || strlen(path_target) == 0) {
+		set_myerrno(Err_arg_missing);
+		goto fail;
+	}
+	if (stat(path_source, &st) == -1
+			|| (f_source = fopen(path_source, "rb")) == NULL) {
+		set_myerrno(Err_os_open_file);
+		log_error("Unable to open system file [%s].", path_source);
+		goto fail;
+	}
+	if (get_inode(&inode_target, path_target) == RETURN_FAILURE) {
+		reset_myerrno();
+		if (create_file(&inode_target, path_target) == RETURN_FAILURE) {
+			goto fail;
+		}
+	}
+	if (inode_target.inode_type != Inode_type_file) {
+		set_myerrno(Err_item_not_file);
+		goto fail;
+	}
+	if ((uint64_t) inode_target.file_size + st.st_size > sb.max_file_size) {
+		set_myerrno(Err_os_file_too_big);
+		goto fail;
+	}
+	// only new blocks are needed, blocks preallocated behind end of file are filled at first
+	count_blocks = get_count_data_blocks(st.st_size);
+	if (isprealloc(&inode_target)) {
+		count_prealloc = get_count_mapped_blocks(&inode_target);
+		count_prealloc -= count_prealloc > get_count_data_blocks(inode_target.file_size)
+						  ? get_count_data_blocks(inode_target.file_size) : count_prealloc;
+		count_blocks -= count_blocks > count_prealloc ? count_prealloc : count_blocks;
+	}
+	count_empty_blocks = get_empty_fields_amount_data();
+	if (is_error()) { // error during malloc in 'get_empty_fields_amount_data()'
+		goto fail;
+	}
+	if (!is_enough_space(count_blocks, count_empty_blocks)) {
+		set_myerrno(Err_block_no_blocks);
+		goto fail;
+	}
+
+	// data are appended by blocks of links
+	buffer_size = sb.count_links * sb.block_size;
+	if ((buffer = malloc(buffer_size)) == NULL) {
+		set_myerrno(Err_malloc);
+		goto fail;
+	}
+
+	// APPEND
+
+	// first part completes the last partial block, so the rest is aligned to blocks
+	to_read = buffer_size - inode_target.file_size % sb.block_size;
+	while ((read = stream_incp(buffer, to_read, f_source)) > 0) {
+		if (write_file_data(&inode_target, buffer, inode_target.file_size, read) == RETURN_FAILURE) {
+			goto fail;
+		}
+		to_read = buffer_size;
+	}
+
+	free(buffer);
+	fclose(f_source);
+	return RETURN_SUCCESS;
+
+fail:
+	if (buffer != NULL)
+		free(buffer);
+	if (f_source != NULL)
+		fclose(f_source);
+	log_warning("append: unable to append file [%s] [%s]", path_source, path_target);
+	return RETURN_FAILURE;
+}
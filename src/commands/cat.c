@@ -1,5 +1,6 @@
 #include <string.h>
 
+#include "cmd_utils.h"
 #include "fs_api.h"
 #include "inode.h"
 #include "iteration_carry.h"
@@ -10,10 +11,13 @@
 
 /*
  * Concatenate file from filesystem and print it to standard output.
+ * With offset, only part of file from the offset is printed, optionally limited by length.
  */
-int sim_cat(const char* path_source) {
-	log_info("cat: [%s]", path_source);
+int sim_cat(const char* path_source, const char* offset_str, const char* length_str) {
+	log_info("cat: [%s] [%s] [%s]", path_source, offset_str, length_str);
 
+	uint64_t offset = 0;
+	uint64_t length = 0;
 	struct inode inode_source = {0};
 
 	// CONTROL
@@ -22,6 +26,12 @@ int sim_cat(const char* path_source) {
 		set_myerrno(Err_arg_missing);
 		goto fail;
 	}
+	if (strlen(offset_str) > 0 && parse_offset(offset_str, &offset) == RETURN_FAILURE) {
+		goto fail;
+	}
+	if (strlen(length_str) > 0 && parse_offset(length_str, &length) == RETURN_FAILURE) {
+		goto fail;
+	}
 	if (get_inode(&inode_source, path_source) == RETURN_FAILURE) {
 		goto fail;
 	}
@@ -32,7 +42,22 @@ int sim_cat(const char* path_source) {
 
 	// CONCATENATE
 
-	iterate_links(&inode_source, NULL, cat_data);
+	// only range of file, rest of file by default
+	if (strlen(offset_str) > 0) {
+		if (strlen(length_str) == 0)
+			length = inode_source.file_size;
+		cat_data_range(&inode_source, offset, length);
+	}
+	// inline data are stored in inode itself
+	else if (isinline(&inode_source)) {
+		cat_data_inline(&inode_source);
+	}
+	// compressed data are decompressed by clusters
+	else if (iscompressed(&inode_source)) {
+		cat_data_range(&inode_source, 0, inode_source.file_size);
+	} else {
+		iterate_links(&inode_source, NULL, cat_data);
+	}
 
 	return RETURN_SUCCESS;
 
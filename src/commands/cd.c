@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdbool.h>
 #include <string.h>
 
 #include "fs_api.h"
@@ -10,14 +11,107 @@
 #include "errors.h"
 
 
-static int handle_prompt_change() {
+// whole path in 'buff_cwd' is exact -- it was not shortened or left unknown
+static bool is_cwd_exact = true;
+
+/*
+ * Apply given path of 'cd' to whole path of working directory. Target inode
+ * of the path is already found, so only names in the path are pushed or popped
+ * and no directory block has to be searched for name of its child.
+ */
+static int apply_path_to_cwd(const char* path) {
+	size_t length = 0;
+	size_t length_dir = 0;
+	char* dir = NULL;
+	char* p_last = NULL;
+	char path_copy[strlen(path) + 1];
+
+	strncpy(path_copy, path, strlen(path) + 1);
+
+	// track path from root
+	if (path_copy[0] == SEPARATOR[0]) {
+		strncpy(buff_cwd, SEPARATOR, 2);
+	}
+	length = strlen(buff_cwd);
+
+	dir = strtok(path_copy, SEPARATOR);
+
+	while (dir != NULL) {
+		// go to parent -- remove last name, parent of root is root again
+		if (strcmp(dir, "..") == 0) {
+			p_last = strrchr(buff_cwd, SEPARATOR[0]);
+			length = (p_last == buff_cwd) ? 1 : (size_t) (p_last - buff_cwd);
+			buff_cwd[length] = '\0';
+		}
+		// go to child -- append separator and name
+		else if (strcmp(dir, ".") != 0) {
+			length_dir = strlen(dir);
+			if (length + length_dir + 1 >= STRLEN_CWD_LENGTH) {
+				return RETURN_FAILURE; // path too long to be tracked
+			}
+			if (length > 1) {
+				buff_cwd[length++] = SEPARATOR[0];
+			}
+			strncpy(buff_cwd + length, dir, length_dir + 1);
+			length += length_dir;
+		}
+		dir = strtok(NULL, SEPARATOR);
+	}
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Shorten whole path to working directory, so it fits to pwd. If it is too long,
+ * names from the beginning are replaced with "..", same as in 'get_path_to_root()'.
+ */
+static int cwd_to_pwd() {
+	size_t length = strlen(buff_cwd);
+	const char* p_tail = buff_cwd;
+
+	if (length < STRLEN_PWD_LENGTH) {
+		strncpy(buff_pwd, buff_cwd, STRLEN_PWD_LENGTH);
+		return RETURN_SUCCESS;
+	}
+
+	// +2 for ".." at the beginning
+	while (strlen(p_tail) + 2 >= STRLEN_PWD_LENGTH) {
+		if ((p_tail = strchr(p_tail + 1, SEPARATOR[0])) == NULL) {
+			// last name itself is too long, so cut it
+			p_tail = buff_cwd + length - (STRLEN_PWD_LENGTH - 3);
+			break;
+		}
+	}
+	snprintf(buff_pwd, STRLEN_PWD_LENGTH, "..%s", p_tail);
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Read whole path to working directory again by going from actual inode
+ * back to root over parents. Needed, when names on the path could change.
+ */
+int reload_pwd() {
+	get_path_to_root(buff_cwd, STRLEN_CWD_LENGTH, &inode_actual);
+	// path is either exact, or shortened with "..", or unknown
+	is_cwd_exact = (buff_cwd[0] == SEPARATOR[0]);
+
+	cwd_to_pwd();
+	snprintf(buff_prompt, BUFFER_PROMPT_LENGTH, FORMAT_PROMPT, fs_name, buff_pwd);
+	return RETURN_SUCCESS;
+}
+
+static int handle_prompt_change(const char* path) {
+	// whole path change -- relative path can be applied only to exact path
+	if ((is_cwd_exact || path[0] == SEPARATOR[0])
+			&& apply_path_to_cwd(path) == RETURN_SUCCESS) {
+		is_cwd_exact = true;
+	} else {
+		return reload_pwd();
+	}
 	// pwd change
-	char new_pwd[STRLEN_PWD_LENGTH] = {0};
-	get_path_to_root(new_pwd, STRLEN_PWD_LENGTH, &inode_actual);
-	strncpy(buff_pwd, new_pwd, STRLEN_PWD_LENGTH);
+	cwd_to_pwd();
 	// whole prompt change
 	snprintf(buff_prompt, BUFFER_PROMPT_LENGTH, FORMAT_PROMPT, fs_name, buff_pwd);
-	return 0;
+	return RETURN_SUCCESS;
 }
 
 /*
@@ -49,7 +143,7 @@ int sim_cd(const char* path) {
 
 	// change directory
 	memcpy(&inode_actual, &inode_cd, sizeof(struct inode));
-	handle_prompt_change();
+	handle_prompt_change(target);
 
 	return RETURN_SUCCESS;
 
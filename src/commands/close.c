@@ -0,0 +1,22 @@
+#include "cmd_utils.h"
+#include "fs_api.h"
+
+#include "errors.h"
+#include "logger.h"
+
+
+/*
+ * Close handle of open file.
+ */
+int sim_close(const char* fd_str) {
+	log_info("close: [%s]", fd_str);
+
+	uint32_t fd = 0;
+
+	if (parse_number(fd_str, &fd) == RETURN_FAILURE
+			|| file_close((int) fd) == RETURN_FAILURE) {
+		log_warning("close: unable to close [%s]", fd_str);
+		return RETURN_FAILURE;
+	}
+	return RETURN_SUCCESS;
+}
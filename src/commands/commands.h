@@ -21,6 +21,20 @@
 #define CMD_HELP		"help"
 #define CMD_EXIT		"exit"
 #define CMD_DEBUG		"d"
+#define CMD_COMPACT		"compact"
+#define CMD_HEAD		"head"
+#define CMD_TAIL		"tail"
+#define CMD_OPEN		"open"
+#define CMD_CLOSE		"close"
+#define CMD_READ		"read"
+#define CMD_WRITE		"write"
+#define CMD_SEEK		"seek"
+#define CMD_TRUNCATE	"truncate"
+#define CMD_APPEND		"append"
+#define CMD_SYNC		"sync"
+#define CMD_LN			"ln"
+#define CMD_DEDUP		"dedup"
+#define CMD_FALLOC		"falloc"
 
 #define CMD_UNKNOWN_ID	0
 #define CMD_PWD_ID		1
@@ -43,24 +57,54 @@
 #define CMD_HELP_ID		18
 #define CMD_EXIT_ID		19
 #define CMD_DEBUG_ID	20
+#define CMD_COMPACT_ID	21
+#define CMD_HEAD_ID		22
+#define CMD_TAIL_ID		23
+#define CMD_OPEN_ID		24
+#define CMD_CLOSE_ID	25
+#define CMD_READ_ID		26
+#define CMD_WRITE_ID	27
+#define CMD_SEEK_ID		28
+#define CMD_TRUNCATE_ID	29
+#define CMD_APPEND_ID	30
+#define CMD_SYNC_ID		31
+#define CMD_LN_ID		32
+#define CMD_DEDUP_ID	33
+#define CMD_FALLOC_ID	34
 
 extern int sim_pwd();
-extern int sim_cat(const char*);
-extern int sim_ls(const char*);
+extern int sim_cat(const char*, const char*, const char*);
+extern int sim_ls(const char*, const char*);
 extern int sim_info(const char*);
 extern int sim_mv(const char*, const char*);
-extern int sim_cp(const char*, const char*);
-extern int sim_rm(const char*);
+extern int sim_cp(const char*, const char*, const char*);
+extern int sim_rm(const char*, const char*);
 extern int sim_cd(const char*);
 extern int sim_mkdir(const char*);
 extern int sim_rmdir(const char*);
-extern int sim_incp(const char*, const char*);
-extern int sim_outcp(const char*, const char*);
+extern int sim_incp(const char*, const char*, const char*);
+extern int sim_outcp(const char*, const char*, const char*);
 extern int sim_df();
 extern int sim_load(const char*);
 extern int sim_fsck();
 extern int sim_corrupt();
-extern int sim_format(const char*, const char*);
+extern int sim_format(const char*, const char*, const char*, const char*);
 extern int sim_debug(const char*, const char*);
+extern int sim_compact(const char*);
+extern int sim_head(const char*, const char*);
+extern int sim_tail(const char*, const char*);
+extern int sim_open(const char*);
+extern int sim_close(const char*);
+extern int sim_read(const char*, const char*, const char*);
+extern int sim_write(const char*, const char*, const char*);
+extern int sim_seek(const char*, const char*, const char*);
+extern int sim_truncate(const char*, const char*);
+extern int sim_append(const char*, const char*);
+extern int sim_sync(const char*, const char*);
+extern int sim_ln(const char*, const char*);
+extern int sim_dedup();
+extern int sim_falloc(const char*, const char*);
+
+extern int reload_pwd();
 
 #endif
@@ -0,0 +1,45 @@
+#include <string.h>
+
+#include "fs_api.h"
+#include "fs_cache.h"
+#include "inode.h"
+
+#include "logger.h"
+#include "errors.h"
+
+
+/*
+ * Compact directory in filesystem -- move its items forward
+ * and release blocks, which are left empty at the end.
+ */
+int sim_compact(const char* path) {
+	log_info("compact: [%s]", path);
+
+	struct inode inode_dir = {0};
+
+	// CONTROL
+
+	// no path given -- compact actual directory
+	if (strlen(path) == 0) {
+		memcpy(&inode_dir, &inode_actual, sizeof(struct inode));
+	}
+	else if (get_inode(&inode_dir, path) == RETURN_FAILURE) {
+		goto fail;
+	}
+	if (inode_dir.inode_type != Inode_type_dirc) {
+		set_myerrno(Err_item_not_directory);
+		goto fail;
+	}
+
+	// COMPACT
+
+	if (compact_directory(&inode_dir) == RETURN_FAILURE) {
+		goto fail;
+	}
+
+	return RETURN_SUCCESS;
+
+fail:
+	log_warning("compact: unable to compact directory [%s]", path);
+	return RETURN_FAILURE;
+}
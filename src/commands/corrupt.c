@@ -17,15 +17,19 @@
 
 static ITERABLE(corrupt_items) {
 	size_t i, j;
-	struct directory_item block[sb.count_dir_items];
+	bool ret = false;
+	struct directory_item* block = alloc_dir_items();
 
-	for (i = 0; i < links_count; ++i) {
+	if (block == NULL)
+		return true;
+
+	for (i = 0; i < links_count && !ret; ++i) {
 		if (links[i] == FREE_LINK)
 			continue;
 
 		fs_read_directory_item(block, sb.count_dir_items, links[i]);
 
-		for (j = 0; j < sb.count_dir_items; ++j) {
+		for (j = 0; j < sb.count_dir_items && !ret; ++j) {
 			// delete other than dot and empty directories
 			if (strcmp(block[j].item_name, "") == 0
 					|| strcmp(block[j].item_name, ".") == 0
@@ -37,11 +41,12 @@ static ITERABLE(corrupt_items) {
 				block[j].id_inode = FREE_LINK;
 				strncpy(block[j].item_name, "", STRLEN_ITEM_NAME);
 				fs_write_directory_item(block, sb.count_dir_items, links[i]);
-				return true;
+				ret = true;
 			}
 		}
 	}
-	return false;
+	free(block);
+	return ret;
 }
 
 /*
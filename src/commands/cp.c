@@ -3,6 +3,7 @@
 #include <string.h>
 
 #include "fs_api.h"
+#include "fs_cache.h"
 #include "inode.h"
 #include "iteration_carry.h"
 #include "cmd_utils.h"
@@ -10,24 +11,169 @@
 #include "errors.h"
 #include "logger.h"
 
+#define CP_REFLINK		"--reflink"	// copy shares data blocks with source until one of them is written
+#define CP_RECURSIVE	"-r"		// directory is copied with its whole tree
+
+
+/*
+ * Copy data of file inode to new file inode without blocks and set its size.
+ * With reflink, data blocks are shared with the source instead.
+ */
+static int copy_file_data(const struct inode* inode_src, struct inode* inode_new, const bool is_reflink) {
+	// inline data are copied right away together with inode
+	if (isinline(inode_src)) {
+		return set_inline_data(inode_new, inline_data(inode_src), inode_src->file_size);
+	}
+	// data blocks are shared with source
+	if (is_reflink) {
+		if (share_links(inode_src, inode_new) == RETURN_FAILURE)
+			return RETURN_FAILURE;
+	}
+	// data blocks are copied with holes kept
+	else if (copy_data_sparse(inode_src, inode_new) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+
+	// blocks are copied or shared at the same positions, so compressed clusters are kept
+	inode_new->flags |= inode_src->flags & INODE_FLAG_COMPRESSED;
+	return update_size(inode_new, inode_src->file_size);
+}
 
 /*
- * Copy file in filesystem.
+ * Get index of first item in tree with the same file inode as item 'i',
+ * so hard links within the tree are copied as hard links too.
  */
-int sim_cp(const char* path_source, const char* path_destination) {
-	log_info("cp: [%s] [%s]", path_source, path_destination);
+static size_t find_copied_item(const struct tree_item* tree, const size_t i) {
+	size_t j;
+
+	if (tree[i].inode.inode_type != Inode_type_file || tree[i].inode.nlink <= 1) {
+		return i;
+	}
+	for (j = 0; j < i; ++j) {
+		if (tree[j].inode.id_inode == tree[i].inode.id_inode)
+			return j;
+	}
+	return i;
+}
+
+/*
+ * Copy directory tree to destination directory under given name. Tree is collected
+ * at first, so space for all its blocks is checked at once, then the directories
+ * are created and the files are copied, each right after its parent.
+ */
+static int copy_tree(const struct inode* inode_src, const struct inode* inode_dest,
+					 const char* name) {
+	size_t i, j, count = 0;
+	uint32_t count_blocks = 0;
+	uint32_t count_empty_blocks = 0;
+	uint32_t* ids_new = NULL;			// ids of copies of items in tree
+	struct tree_item* tree = NULL;
+	struct inode inode_new = {0};
+	struct inode inode_parent = {0};
+	struct carry_dir_item carry_dir = {0};
+
+	if (collect_tree(inode_src, &tree, &count) == RETURN_FAILURE) {
+		goto fail;
+	}
+	if ((ids_new = malloc(count * sizeof(uint32_t))) == NULL) {
+		set_myerrno(Err_malloc);
+		goto fail;
+	}
+	// directory can't be copied into itself
+	for (i = 0; i < count; ++i) {
+		if (tree[i].inode.id_inode == inode_dest->id_inode) {
+			set_myerrno(Err_dir_arg_invalid);
+			goto fail;
+		}
+	}
+
+	// blocks of whole tree are counted, hard linked files only once
+	for (i = 0; i < count; ++i) {
+		if (!isinline(&tree[i].inode) && find_copied_item(tree, i) == i)
+			count_blocks += get_count_data_blocks(tree[i].inode.file_size);
+	}
+	count_empty_blocks = get_empty_fields_amount_data();
+	if (is_error()) { // error during malloc in 'get_empty_fields_amount_data()'
+		goto fail;
+	}
+	if (count_blocks > 0 && !is_enough_space(count_blocks, count_empty_blocks)) {
+		set_myerrno(Err_block_no_blocks);
+		goto fail;
+	}
+
+	for (i = 0; i < count; ++i) {
+		// copy of tree root is added to destination, the rest to copies of their parents
+		if (i == 0)
+			memcpy(&inode_parent, inode_dest, sizeof(struct inode));
+		else
+			fs_read_inode(&inode_parent, 1, ids_new[tree[i].parent]);
+
+		// hard link to already copied file
+		if ((j = find_copied_item(tree, i)) < i) {
+			fs_read_inode(&inode_new, 1, ids_new[j]);
+			inode_new.nlink++;
+			fs_write_inode(&inode_new, 1, inode_new.id_inode);
+		}
+		else if (tree[i].inode.inode_type == Inode_type_dirc) {
+			if (create_inode_directory(&inode_new, inode_parent.id_inode) == RETURN_FAILURE)
+				goto fail;
+		}
+		else if (create_inode_file(&inode_new) == RETURN_FAILURE) {
+			goto fail;
+		}
+		else if (copy_file_data(&tree[i].inode, &inode_new, false) == RETURN_FAILURE) {
+			free_inode_file(&inode_new);
+			goto fail;
+		}
 
+		carry_dir.id = inode_new.id_inode;
+		strncpy(carry_dir.name, i == 0 ? name : tree[i].name, STRLEN_ITEM_NAME);
+		if (add_to_parent(&inode_parent, &carry_dir) == RETURN_FAILURE) {
+			if (j < i) {
+				inode_new.nlink--;
+				fs_write_inode(&inode_new, 1, inode_new.id_inode);
+			}
+			else if (inode_new.inode_type == Inode_type_dirc)
+				free_inode_directory(&inode_new);
+			else
+				free_inode_file(&inode_new);
+			goto fail;
+		}
+		ids_new[i] = inode_new.id_inode;
+	}
+
+	free(ids_new);
+	free(tree);
+	return RETURN_SUCCESS;
+
+fail:
+	free(ids_new);
+	free(tree);
+	return RETURN_FAILURE;
+}
+
+/*
+ * Copy file in filesystem. With reflink option, data blocks are not copied,
+ * but shared with the source file and copied only when one of the files writes them.
+ * With recursive option, directory is copied with all its items.
+ */
+int sim_cp(const char* arg1, const char* arg2, const char* arg3) {
+	log_info("cp: [%s] [%s] [%s]", arg1, arg2, arg3);
+
+	// first argument is reflink or recursive option, paths are the next ones
+	bool is_reflink = strcmp(arg1, CP_REFLINK) == 0;
+	bool is_recursive = strcmp(arg1, CP_RECURSIVE) == 0;
+	const char* path_source = is_reflink || is_recursive ? arg2 : arg1;
+	const char* path_destination = is_reflink || is_recursive ? arg3 : arg2;
 	char dir_path_src[strlen(path_source) + 1];
 	char dir_name_src[STRLEN_ITEM_NAME] = {0};
 	char dir_path_dest[strlen(path_destination) + 1];
 	char dir_name_dest[STRLEN_ITEM_NAME] = {0};
-	uint32_t* links = NULL;
 	uint32_t count_blocks = 0;
 	uint32_t count_empty_blocks = 0;
 	struct inode inode_new = {0};		// new inode to copy data into
 	struct inode inode_src = {0};		// inode to copy
 	struct inode inode_dest = {0};		// destination directory of inode to copy
-	struct carry_copy carry_copy = {0};
 	struct carry_dir_item carry_dir = {0};
 
 	// CONTROL
@@ -36,6 +182,10 @@ int sim_cp(const char* path_source, const char* path_destination) {
 		set_myerrno(Err_arg_missing);
 		goto fail;
 	}
+	if (is_reflink && !(sb.features & FS_FEATURE_REFLINK)) {
+		set_myerrno(Err_fs_no_feature);
+		goto fail;
+	}
 	// get source's and destination's paths and names
 	if (split_path(path_source, dir_path_src, dir_name_src) == RETURN_FAILURE
 		|| split_path(path_destination, dir_path_dest, dir_name_dest) == RETURN_FAILURE) {
@@ -46,28 +196,28 @@ int sim_cp(const char* path_source, const char* path_destination) {
 	if (get_inode(&inode_src, path_source) == RETURN_FAILURE) {
 		goto fail;
 	}
-	// check if source inode is file
-	if (inode_src.inode_type != Inode_type_file) {
+	// check if source inode is file, directory is copied only recursively
+	if (inode_src.inode_type != Inode_type_file
+			&& !(is_recursive && inode_src.inode_type == Inode_type_dirc)) {
 		set_myerrno(Err_item_not_file);
 		goto fail;
 	}
 
-	// count of data blocks with data (only -- no deep blocks of indirect links)
-	count_blocks = get_count_data_blocks(inode_src.file_size);
-	// count of empty data blocks in filesystem
-	count_empty_blocks = get_empty_fields_amount_data();
-	if (is_error()) { // error during malloc in 'get_empty_fields_amount_data()'
-		goto fail;
-	}
-	// check enough blocks and space in filesystem
-	if (count_empty_blocks == 0 || !is_enough_space(count_blocks, count_empty_blocks)) {
-		set_myerrno(Err_block_no_blocks);
-		goto fail;
-	}
-
-	if ((links = malloc(count_blocks * sizeof(uint32_t))) == NULL) {
-		set_myerrno(Err_malloc);
-		goto fail;
+	// space for directory tree is checked, when the tree is collected
+	if (inode_src.inode_type == Inode_type_file) {
+		// count of data blocks with data (only -- no deep blocks of indirect links)
+		count_blocks = get_count_data_blocks(inode_src.file_size);
+		// count of empty data blocks in filesystem
+		count_empty_blocks = get_empty_fields_amount_data();
+		if (is_error()) { // error during malloc in 'get_empty_fields_amount_data()'
+			goto fail;
+		}
+		// check enough blocks and space in filesystem, shared blocks need only blocks with links
+		if (count_empty_blocks == 0
+				|| (!is_reflink && !is_enough_space(count_blocks, count_empty_blocks))) {
+			set_myerrno(Err_block_no_blocks);
+			goto fail;
+		}
 	}
 
 	// get last two inodes in path
@@ -95,47 +245,42 @@ int sim_cp(const char* path_source, const char* path_destination) {
 		goto fail;
 	}
 	// check if item exists in destination file already, if yes, then error
-	if (iterate_links(&inode_dest, &carry_dir, search_block_inode_id) != RETURN_FAILURE) {
+	if (item_exists(&inode_dest, carry_dir.name)) {
 		set_myerrno(Err_item_exists);
 		goto fail;
 	}
 
 	// COPY
 
+	// can be set during 'get_inode()', when checking if path exists
+	reset_myerrno();
+
+	if (inode_src.inode_type == Inode_type_dirc) {
+		if (copy_tree(&inode_src, &inode_dest, carry_dir.name) == RETURN_FAILURE)
+			goto fail;
+	}
 	// create inode to copy into
-	if (create_inode_file(&inode_new) == RETURN_FAILURE) {
+	else if (create_inode_file(&inode_new) == RETURN_FAILURE) {
 		goto fail;
 	}
-	if (create_empty_links(links, count_blocks, &inode_new) == RETURN_FAILURE) {
+	else if (copy_file_data(&inode_src, &inode_new, is_reflink) == RETURN_FAILURE) {
 		free_inode_file(&inode_new);
 		goto fail;
 	}
-
 	// add new inode to destination parent directory
-	carry_dir.id = inode_new.id_inode; // id of new copied file
-	if (add_to_parent(&inode_dest, &carry_dir) == RETURN_FAILURE) {
-		free_inode_file(&inode_new);
-		goto fail;
-	}
-
-	carry_copy.dest_links = links;
-	carry_copy.links_count = count_blocks;
-
-	// copy date from source inode to newly created inode -- use newly created links in the inode
-	if (iterate_links(&inode_src, &carry_copy, copy_data) == RETURN_FAILURE) {
-		free_inode_file(&inode_new);
-		goto fail;
+	else {
+		carry_dir.id = inode_new.id_inode; // id of new copied file
+		if (add_to_parent(&inode_dest, &carry_dir) == RETURN_FAILURE) {
+			free_inode_file(&inode_new);
+			goto fail;
+		}
 	}
-	update_size(&inode_new, inode_src.file_size);
 
-	free(links);
 	// can be set during 'get_inode()', when checking if path exists
 	reset_myerrno();
 	return RETURN_SUCCESS;
 
 fail:
-	if (links != NULL)
-		free(links);
-	log_warning("cp: unable to copy file [%s] [%s]", path_source, path_destination);
+	log_warning("cp: unable to copy file [%s] [%s] [%s]", arg1, arg2, arg3);
 	return RETURN_FAILURE;
 }
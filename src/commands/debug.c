@@ -16,29 +16,56 @@ static int print_links(const char* type, const uint32_t* links, const size_t lin
 	return 0;
 }
 
+static int print_extents(const char* type, const struct inode* inode_item) {
+	size_t i, count = 0;
+	struct extent* extents = get_extents(inode_item, &count);
+
+	// each extent as [logical block] first block-last block
+	printf("%s", type);
+	for (i = 0; i < count; ++i) {
+		printf(" [%d] %d-%d", extents[i].logical, extents[i].start,
+			   extents[i].start + extents[i].length - 1);
+	}
+	puts("");
+	if (extents)
+		free(extents);
+	return 0;
+}
+
 static void inode(const uint32_t id) {
 	struct inode inode_item;
 	fs_read_inode(&inode_item, 1, id);
 	printf(" type: %s\n", inode_item.inode_type == Inode_type_dirc ? "directory"
 						  : inode_item.inode_type == Inode_type_file ? "file" : "free");
-	printf(" size: %d B = %.2f kB = %.2f MB\n",
-		   inode_item.file_size,
+	printf(" size: %llu B = %.2f kB = %.2f MB\n",
+		   (unsigned long long) inode_item.file_size,
 		   (double) inode_item.file_size / 1024,
 		   (double) inode_item.file_size / 1024 / 1024);
 	printf(" inode id: %d\n", inode_item.id_inode);
-	print_links(" direct links:", inode_item.direct, COUNT_DIRECT_LINKS);
-	print_links(" indrct links lvl 1:", inode_item.indirect_1, COUNT_INDIRECT_LINKS_1);
-	print_links(" indrct links lvl 2:", inode_item.indirect_2, COUNT_INDIRECT_LINKS_2);
+	printf(" flags: %#x\n", inode_item.flags);
+	if (isinline(&inode_item)) {
+		print_links(" inline data:", inode_item.direct, INODE_INLINE_SIZE / sizeof(uint32_t));
+	} else if (isextent(&inode_item)) {
+		print_extents(" extents:", &inode_item);
+		printf(" extent block: %d\n", extent_block(&inode_item));
+	} else {
+		print_links(" direct links:", inode_item.direct, COUNT_DIRECT_LINKS);
+		print_links(" indrct links lvl 1:", inode_item.indirect_1, COUNT_INDIRECT_LINKS_1);
+		print_links(" indrct links lvl 2:", inode_item.indirect_2, COUNT_INDIRECT_LINKS_2);
+	}
 }
 
 static void block_dirs(const uint32_t id) {
-	struct directory_item block[sb.count_dir_items];
+	struct directory_item* block = alloc_dir_items();
+	if (block == NULL)
+		return;
 	fs_read_directory_item(block, sb.count_dir_items, id);
 	for (size_t i = 0; i < sb.count_dir_items; ++i) {
 		if (strcmp(block[i].item_name, "") != 0) {
 			printf("%d\t%s\n", block[i].id_inode, block[i].item_name);
 		}
 	}
+	free(block);
 }
 
 static void block_data(const uint32_t id) {
@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#include "fs_api.h"
+#include "fs_cache.h"
+#include "inode.h"
+
+#include "errors.h"
+#include "logger.h"
+
+#define DEDUP_INODES_BATCH	256		// count of inodes read at once
+
+
+/*
+ * Rescan data of all files in filesystem and share identical data blocks,
+ * so the duplicate ones are released. Blocks are indexed on the way,
+ * so later written blocks can be shared with them too.
+ */
+int sim_dedup() {
+	log_info("dedup");
+
+	size_t i, j, batch;
+	int64_t released = 0, ret = 0;
+	uint32_t count_blocks = 0;
+	struct inode inodes[DEDUP_INODES_BATCH];
+
+	if (!(sb.features & FS_FEATURE_DEDUP) || !(sb.features & FS_FEATURE_REFLINK)) {
+		set_myerrno(Err_fs_no_feature);
+		goto fail;
+	}
+
+	for (i = 0; i < sb.block_count; i += batch) {
+		batch = sb.block_count - i < DEDUP_INODES_BATCH ? sb.block_count - i : DEDUP_INODES_BATCH;
+		fs_read_inode(inodes, batch, i + 1);
+
+		for (j = 0; j < batch; ++j) {
+			if (inodes[j].inode_type != Inode_type_file)
+				continue;
+			if ((ret = dedup_file(&inodes[j])) == RETURN_FAILURE) {
+				file_reload_all();
+				goto fail;
+			}
+			count_blocks += get_count_data_blocks(inodes[j].file_size);
+			released += ret;
+		}
+	}
+	// blocks of open files could be moved
+	file_reload_all();
+
+	printf("dedup: %lld of %u blocks released\n", (long long) released, count_blocks);
+	log_info("dedup: [%lld] of [%u] blocks released", (long long) released, count_blocks);
+	return RETURN_SUCCESS;
+
+fail:
+	log_warning("dedup: unable to deduplicate data blocks");
+	return RETURN_FAILURE;
+}
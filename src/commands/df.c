@@ -7,31 +7,30 @@
 #include "logger.h"
 
 #define b2mb(b)	((b)/1024.0f/1024.0f)
+#define DF_INODES_BATCH		1024	// count of inodes read at once
 
 
 int sim_df() {
 	log_info("df");
 
 	int ret = RETURN_FAILURE;
-	size_t i;
+	size_t i, j, batch;
 	size_t free_inodes_fields = 0;
 	size_t free_block_fields = 0;
 	size_t inodes_free = 0;
 	size_t inodes_file = 0;
 	size_t inodes_dirc = 0;
-	size_t used_space = 0;
-	size_t total_space = sb.block_count * sb.block_size;
+	uint64_t used_space = 0;
+	uint64_t total_space = (uint64_t) sb.block_count * sb.block_size;
 	bool* bitmap_inodes = malloc(sb.block_count);
 	bool* bitmap_blocks = malloc(sb.block_count);
-	// with bigger filesystem size (>4 GB) and bigger inodes,
-	// this should be rewritten to iteration with caching the inodes
-	struct inode* inodes = malloc(sb.block_count * sizeof(struct inode));
+	// filesystem can be bigger than memory, so inodes are read by batches
+	struct inode* inodes = malloc(DF_INODES_BATCH * sizeof(struct inode));
 
 	if (inodes && bitmap_inodes && bitmap_blocks) {
 		// read whole bitmaps and all inodes
 		read_whole_bitmap_inodes(bitmap_inodes);
 		read_whole_bitmap_data(bitmap_blocks);
-		fs_read_inode(inodes, sb.block_count, 1);
 
 		for (i = 0; i < sb.block_count; ++i) {
 			// BITMAPS
@@ -39,17 +38,24 @@ int sim_df() {
 				free_inodes_fields++;
 			if (bitmap_blocks[i])
 				free_block_fields++;
+		}
+
+		for (i = 0; i < sb.block_count; i += batch) {
+			batch = sb.block_count - i < DF_INODES_BATCH ? sb.block_count - i : DF_INODES_BATCH;
+			fs_read_inode(inodes, batch, i + 1);
 
 			// INODES
-			if (inodes[i].inode_type == Inode_type_free)
-				inodes_free++;
-			else if (inodes[i].inode_type == Inode_type_file)
-				inodes_file++;
-			else if (inodes[i].inode_type == Inode_type_dirc)
-				inodes_dirc++;
+			for (j = 0; j < batch; ++j) {
+				if (inodes[j].inode_type == Inode_type_free)
+					inodes_free++;
+				else if (inodes[j].inode_type == Inode_type_file)
+					inodes_file++;
+				else if (inodes[j].inode_type == Inode_type_dirc)
+					inodes_dirc++;
+			}
 		}
 
-		used_space = (sb.block_count - free_block_fields) * sb.block_size;
+		used_space = (uint64_t) (sb.block_count - free_block_fields) * sb.block_size;
 
 		printf("GENERAL:\n"
 			   " Size:\t%u MB\n Used:\t%.1f MB\n Avail:\t%.1f MB\n Use:\t%.1f %%\n",
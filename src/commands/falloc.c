@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "cmd_utils.h"
+#include "fs_api.h"
+#include "inode.h"
+
+#include "errors.h"
+#include "logger.h"
+
+
+/*
+ * Reserve data blocks for first SIZE bytes of file, so later writes don't allocate
+ * and the file gets contiguous blocks. File is created, if it does not exist yet.
+ * Size of file is not changed.
+ */
+int sim_falloc(const char* path, const char* size_str) {
+	log_info("falloc: [%s] [%s]", path, size_str);
+
+	uint64_t size = 0;
+	struct inode inode_target = {0};
+
+	// CONTROL
+
+	if (strlen(path) == 0) {
+		set_myerrno(Err_arg_missing);
+		goto fail;
+	}
+	if (parse_offset(size_str, &size) == RETURN_FAILURE) {
+		goto fail;
+	}
+	if (get_inode(&inode_target, path) == RETURN_FAILURE) {
+		// file does not exist, so it is created
+		reset_myerrno();
+		if (create_file(&inode_target, path) == RETURN_FAILURE) {
+			goto fail;
+		}
+	}
+	if (inode_target.inode_type != Inode_type_file) {
+		set_myerrno(Err_item_not_file);
+		goto fail;
+	}
+
+	// PREALLOCATE
+
+	if (preallocate_file(&inode_target, size) == RETURN_FAILURE) {
+		goto fail;
+	}
+	return RETURN_SUCCESS;
+
+fail:
+	log_warning("falloc: unable to preallocate file [%s] [%s]", path, size_str);
+	return RETURN_FAILURE;
+}
@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "fs_api.h"
 #include "fs_cache.h"
@@ -13,15 +14,31 @@
 #include "errors.h"
 
 // --- FILESYSTEM CONFIG
-#define FS_SIZE_MAX				4095	// maximal filesystem size in MB (because using 32b ints)
-#define FS_BLOCK_SIZE			1024	// filesystem block size in bytes B
-#define PERCENTAGE				0.95	// percentage of space for data in filesystem
+#define FS_SIZE_MAX				UINT32_MAX	// maximal filesystem size in MB (size is stored in MB in 32b)
+#define FS_BLOCK_COUNT_MAX		INT32_MAX	// maximal count of data blocks (ids of blocks and inodes are 32b)
+#define FS_BLOCK_SIZE			1024	// default filesystem block size in bytes B
+#define FS_BLOCK_SIZE_MIN		512		// minimal filesystem block size in bytes B
+#define FS_BLOCK_SIZE_MAX		65536	// maximal filesystem block size in bytes B
 #define CACHE_SIZE				131072	// cache size for fwriting and freading (128 kB) TODO 1 MB with malloc?
+#define FS_FEATURES				(FS_FEATURE_INLINE_DATA | FS_FEATURE_DIR_VARLEN \
+								| FS_FEATURE_EXTENTS | FS_FEATURE_REFLINK \
+								| FS_FEATURE_COMPRESSION \
+								| FS_FEATURE_64BIT)	// features of new filesystem
+#define FORMAT_OPTION			"--"		// prefix of options, which turn features on or off
+#define FORMAT_OPTION_DELIM		","			// options are given in one argument
+#define FORMAT_DEDUP			"--dedup"	// identical data blocks are shared (FS_FEATURE_DEDUP)
+#define FORMAT_NO_INLINE		"--no-inline"	// no data are stored inline (FS_FEATURE_INLINE_DATA)
+#define FORMAT_NO_VARLEN		"--no-varlen"	// directory items have fixed length (FS_FEATURE_DIR_VARLEN)
+#define FORMAT_NO_EXTENTS		"--no-extents"	// files are mapped by links (FS_FEATURE_EXTENTS)
+#define FORMAT_NO_COMPRESS		"--no-compress"	// files can't be compressed (FS_FEATURE_COMPRESSION)
 // --- FILESYSTEM CONFIG
 
 #define LOG_DATETIME_LENGTH_	25
 #define isnegnum(cha)			(cha[0] == '-')
 #define isinrange(n)			((n) > 0 && (n) <= FS_SIZE_MAX)
+#define isblocksize(n)			((n) >= FS_BLOCK_SIZE_MIN && (n) <= FS_BLOCK_SIZE_MAX && ((n) & ((n) - 1)) == 0)
+#define isreflink()				(sb.features & FS_FEATURE_REFLINK)
+#define isdedup()				((sb.features & FS_FEATURE_DEDUP) && isreflink())
 
 extern FILE* filesystem;
 
@@ -86,40 +103,142 @@ static int parse_filesystem_size(const char* num_str, uint32_t* size) {
 	return RETURN_SUCCESS;
 
 fail:
-	fprintf(stderr, "! use size range from 1 to %d [MB].\n", FS_SIZE_MAX);
+	fprintf(stderr, "! use size range from 1 to %u [MB].\n", FS_SIZE_MAX);
 	return RETURN_FAILURE;
 }
 
-static int init_superblock(const int size, const uint32_t block_cnt) {
+static int parse_block_size(const char* num_str, uint32_t* block_size) {
+	long num = 0;
+
+	// default block size, when none is given
+	if (strlen(num_str) == 0) {
+		*block_size = FS_BLOCK_SIZE;
+		return RETURN_SUCCESS;
+	}
+	if (!isnumeric(num_str)) {
+		set_myerrno(Err_fs_size_nan);
+		goto fail;
+	}
+
+	reset_myerrno();
+	num = strtol(num_str, NULL, 10);
+
+	if (is_error() || !isblocksize(num)) {
+		set_myerrno(Err_fs_block_size);
+		goto fail;
+	}
+
+	*block_size = (uint32_t) num;
+	return RETURN_SUCCESS;
+
+fail:
+	fprintf(stderr, "! use block size, which is power of 2 from %d to %d [B].\n",
+			FS_BLOCK_SIZE_MIN, FS_BLOCK_SIZE_MAX);
+	return RETURN_FAILURE;
+}
+
+/*
+ * Get features of new filesystem from options separated by commas.
+ * Features are turned on or off by the options, other features are on.
+ */
+static int parse_features(const char* options, uint32_t* features) {
+	char options_copy[strlen(options) + 1];
+	char* option = NULL;
+
+	*features = FS_FEATURES;
+	strcpy(options_copy, options);
+
+	for (option = strtok(options_copy, FORMAT_OPTION_DELIM); option != NULL;
+			option = strtok(NULL, FORMAT_OPTION_DELIM)) {
+		if (strcmp(option, FORMAT_DEDUP) == 0)
+			*features |= FS_FEATURE_DEDUP;
+		else if (strcmp(option, FORMAT_NO_INLINE) == 0)
+			*features &= ~FS_FEATURE_INLINE_DATA;
+		else if (strcmp(option, FORMAT_NO_VARLEN) == 0)
+			*features &= ~FS_FEATURE_DIR_VARLEN;
+		else if (strcmp(option, FORMAT_NO_EXTENTS) == 0)
+			*features &= ~FS_FEATURE_EXTENTS;
+		else if (strcmp(option, FORMAT_NO_COMPRESS) == 0)
+			*features &= ~FS_FEATURE_COMPRESSION;
+		else {
+			set_myerrno(Err_arg_invalid);
+			goto fail;
+		}
+	}
+	return RETURN_SUCCESS;
+
+fail:
+	fprintf(stderr, "! use options %s, %s, %s, %s, %s separated by '%s'.\n",
+			FORMAT_DEDUP, FORMAT_NO_INLINE, FORMAT_NO_VARLEN, FORMAT_NO_EXTENTS,
+			FORMAT_NO_COMPRESS, FORMAT_OPTION_DELIM);
+	return RETURN_FAILURE;
+}
+
+/*
+ * Get count of data blocks, so whole filesystem fits to given size. Each data block
+ * has its fields in bitmaps, its inode and its entries in optional regions.
+ */
+static uint64_t get_block_count(const uint32_t fs_size, const uint32_t block_size) {
+	size_t per_block = block_size + 2 * sizeof(bool) + sizeof(struct inode);
+	size_t fixed = sizeof(struct superblock);
+
+	if (isreflink())
+		per_block += sizeof(uint16_t);
+	if (isdedup()) {
+		per_block += sizeof(struct dedup_entry) + sizeof(uint32_t);
+		fixed += DEDUP_PROBES * sizeof(struct dedup_entry);
+	}
+	return (mb2b(fs_size) - fixed) / per_block;
+}
+
+static int init_superblock(const uint32_t size, const uint32_t block_size, const uint32_t block_cnt) {
+	uint64_t max_file_size = 0;
 	char datetime[LOG_DATETIME_LENGTH_] = {0};
 	get_datetime(datetime);
 
 	printf("init: superblock.. ");
 
 	// inode bitmap is after superblock
-	uint32_t addr_bm_in = sizeof(struct superblock);
+	uint64_t addr_bm_in = sizeof(struct superblock);
 	// data bitmap is after inode bitmap
-	uint32_t addr_bm_dat = addr_bm_in + block_cnt;
-	// inodes are after data bitmap
-	uint32_t addr_in = addr_bm_dat + block_cnt;
+	uint64_t addr_bm_dat = addr_bm_in + block_cnt;
+	// reference counts of data blocks are after data bitmap
+	uint64_t addr_rc = addr_bm_dat + block_cnt;
+	// index of data blocks by hash and slots of blocks in it are after reference counts
+	uint64_t addr_dd_in = addr_rc + (isreflink() ? (uint64_t) block_cnt * sizeof(uint16_t) : 0);
+	uint64_t addr_dd_sl = addr_dd_in + (isdedup() ? ((uint64_t) block_cnt + DEDUP_PROBES) * sizeof(struct dedup_entry) : 0);
+	// inodes are after the index, if there is any
+	uint64_t addr_in = addr_dd_sl + (isdedup() ? (uint64_t) block_cnt * sizeof(uint32_t) : 0);
 	// data are at the end of filesystem -- there is unused space between inodes and data
-	uint32_t addr_dat = addr_in + block_cnt * sizeof(struct inode);
+	uint64_t addr_dat = addr_in + (uint64_t) block_cnt * sizeof(struct inode);
 
 	// init superblock variables
-	strncpy(sb.signature, "kmat95", sizeof(sb.signature) - 1);
+	strncpy(sb.signature, FS_SIGNATURE, sizeof(sb.signature) - 1);
 	sprintf(sb.volume_descriptor, "%s, made by matenestor", datetime);
 	sb.disk_size = size;
-	sb.block_size = FS_BLOCK_SIZE;
+	sb.block_size = block_size;
 	sb.block_count = block_cnt;
 	sb.count_links = sb.block_size / sizeof(uint32_t);
-	sb.count_dir_items = sb.block_size / sizeof(struct directory_item);
+	// with variable-length records, count of items depends on length of their names
+	if (sb.features & FS_FEATURE_DIR_VARLEN)
+		sb.count_dir_items = sb.block_size / DIR_RECORD_MIN;
+	else
+		sb.count_dir_items = sb.block_size / sizeof(struct directory_record);
 	sb.addr_bm_inodes = addr_bm_in;
 	sb.addr_bm_data = addr_bm_dat;
 	sb.addr_inodes = addr_in;
 	sb.addr_data = addr_dat;
-	sb.max_file_size = COUNT_DIRECT_LINKS * FS_BLOCK_SIZE
-						+ COUNT_INDIRECT_LINKS_1 * FS_BLOCK_SIZE * sb.count_links
-						+ COUNT_INDIRECT_LINKS_2 * FS_BLOCK_SIZE * sb.count_links * sb.count_links;
+	sb.addr_refcounts = addr_rc;
+	sb.addr_dedup_index = addr_dd_in;
+	sb.addr_dedup_slots = addr_dd_sl;
+	max_file_size = (uint64_t) block_size * (COUNT_DIRECT_LINKS
+						+ (uint64_t) COUNT_INDIRECT_LINKS_1 * sb.count_links
+						+ (uint64_t) COUNT_INDIRECT_LINKS_2 * sb.count_links * sb.count_links);
+	// file mapped by extents is limited only by size of data part
+	if (sb.features & FS_FEATURE_EXTENTS) {
+		max_file_size = (uint64_t) block_cnt * block_size;
+	}
+	sb.max_file_size = max_file_size;
 
 	// write superblock to file
 	fs_write_superblock(&sb);
@@ -152,6 +271,24 @@ static int init_bitmap(const size_t block_cnt) {
 	return RETURN_SUCCESS;
 }
 
+static int init_zeros(const char* name, const size_t length) {
+	size_t i, batch;
+	size_t loops = length / CACHE_SIZE;
+	char zeros[CACHE_SIZE] = {0};
+
+	printf("init: %s.. ", name);
+
+	for (i = 0; i <= loops; ++i) {
+		batch = i < loops ? CACHE_SIZE : length % CACHE_SIZE;
+		format_write_char(zeros, batch);
+	}
+
+	fs_flush();
+	puts("done");
+
+	return RETURN_SUCCESS;
+}
+
 static int init_inodes(const size_t block_cnt) {
 	size_t i, j;
 	// how many inodes can be read into 'CACHE_SIZE'
@@ -172,6 +309,8 @@ static int init_inodes(const size_t block_cnt) {
 	inode_init.id_inode = FREE_LINK;
 	inode_init.inode_type = Inode_type_free;
 	inode_init.file_size = 0;
+	inode_init.flags = 0;
+	inode_init.nlink = 0;
 	for (i = 0; i < COUNT_DIRECT_LINKS; ++i) {
 		inode_init.direct[i] = FREE_LINK;
 	}
@@ -207,26 +346,16 @@ static int init_inodes(const size_t block_cnt) {
 }
 
 static int init_blocks(const uint32_t fs_size) {
-	size_t i, batch;
-	// how much bytes is missing till end of filesystem
-	// after meta part -- empty space part + data part
-	uint64_t remaining_part = mb2b(fs_size) - ftell(filesystem);
-	size_t loops = remaining_part / CACHE_SIZE;
-	// helper array to be filled from
-	char zeros[CACHE_SIZE] = {0};
-	// for printing percentage, so it doesn't look like nothing is happening
-	size_t percent5 = loops / 20 + 1;
-
-	// fill rest of filesystem with batches of zeros
-	for (i = 0; i <= loops; ++i) {
-		batch = i < loops ? CACHE_SIZE : remaining_part % CACHE_SIZE;
-		format_write_char(zeros, batch);
+	printf("init: data blocks.. ");
 
-		if (i % percent5 == 0)
-			printf("\rinit: data blocks.. %d %%", (int) (((float) i / loops)*100));
-	}
+	// rest of filesystem -- empty space part + data part -- is extended with zeros,
+	// so volume bigger than memory or free disk space is formatted at once
 	fs_flush();
-	puts("\rinit: data blocks.. done");
+	if (ftruncate(fileno(filesystem), (off_t) mb2b(fs_size)) != 0) {
+		set_myerrno(Err_fs_size_sys_range);
+		return RETURN_FAILURE;
+	}
+	puts("done");
 
 	return RETURN_SUCCESS;
 }
@@ -234,14 +363,18 @@ static int init_blocks(const uint32_t fs_size) {
 static int init_root() {
 	struct inode inode_root = {0};
 	// root inode has id=1 and is on filesystem index=1 (0 is nothing)
-	struct directory_item dir_root[sb.count_dir_items];
+	struct directory_item* dir_root = alloc_dir_items();
 
+	if (dir_root == NULL) {
+		return RETURN_FAILURE;
+	}
 	printf("init: root.. ");
 
 	// root inode
 	fs_read_inode(&inode_root, 1, ROOT_ID);
 	inode_root.inode_type = Inode_type_dirc;
-	inode_root.file_size = FS_BLOCK_SIZE;
+	inode_root.file_size = sb.block_size;
+	inode_root.nlink = 1;
 	inode_root.direct[0] = ROOT_ID;
 	// root directory
 	init_empty_dir_block(dir_root, ROOT_ID, ROOT_ID);
@@ -255,35 +388,68 @@ static int init_root() {
 
 	// cache root inode to simulation cache
 	memcpy(&inode_actual, &inode_root, sizeof(struct inode));
+	free(dir_root);
 	puts("done");
 
 	return RETURN_SUCCESS;
 }
 
-int sim_format(const char* fs_size_str, const char* path) {
+/*
+ * Format filesystem of given size. Block size is optional, so dedup option
+ * can be given in its place too.
+ */
+int sim_format(const char* fs_size_str, const char* arg2, const char* arg3, const char* path) {
 	int ret = RETURN_FAILURE;
-	// necessary step with double type variable for precision
-	double dt_percentage = 0;
-	uint32_t block_cnt = 0, fs_size = 0;
-
-	log_info("Formatting filesystem [path: %s] [size: %s]", path, fs_size_str);
-
-	if (parse_filesystem_size(fs_size_str, &fs_size) == RETURN_SUCCESS) {
+	// options may be given instead of block size
+	bool is_options = strncmp(arg2, FORMAT_OPTION, strlen(FORMAT_OPTION)) == 0;
+	const char* block_size_str = is_options ? arg3 : arg2;
+	const char* options = is_options ? arg2 : arg3;
+	uint32_t fs_size = 0, block_size = 0, features = 0, features_old = 0;
+	uint64_t block_cnt = 0;
+
+	log_info("Formatting filesystem [path: %s] [size: %s] [block size: %s] [options: %s]",
+			 path, fs_size_str, block_size_str, options);
+
+	if (parse_filesystem_size(fs_size_str, &fs_size) == RETURN_SUCCESS
+			&& parse_block_size(block_size_str, &block_size) == RETURN_SUCCESS
+			&& parse_features(options, &features) == RETURN_SUCCESS) {
+		// layout of filesystem depends on its features, so they are set at first
+		features_old = sb.features;
+		sb.features = features;
 		// Count of blocks in data blocks part is equal to bitmaps sizes and count of inodes.
-		// 'fs_size' is in MB, 'block_size' is in B, data part is 100*'PERCENTAGE' % of whole filesystem
-		dt_percentage = mb2b(fs_size) * PERCENTAGE;
-		block_cnt = (uint32_t) (dt_percentage / FS_BLOCK_SIZE);
-
-		if ((filesystem = fopen(path, "wb+")) != NULL) {
-			init_superblock(fs_size, block_cnt);
+		// 'fs_size' is in MB, 'block_size' is in B, data part is the rest after all metadata
+		block_cnt = get_block_count(fs_size, block_size);
+
+		// ids of blocks are 32b, so bigger filesystem needs bigger blocks
+		if (block_cnt > FS_BLOCK_COUNT_MAX) {
+			sb.features = features_old;		// loaded filesystem is kept
+			set_myerrno(Err_fs_size_sim_range);
+			fprintf(stderr, "! use bigger block size for this filesystem size.\n");
+			log_error("Simulation error while formatting: %s", my_strerror(my_errno));
+		}
+		else if ((filesystem = fopen(path, "wb+")) != NULL) {
+			file_close_all();
+			fs_reset_link_cache();
+			init_superblock(fs_size, block_size, block_cnt);
 			init_bitmap(block_cnt); // inodes
 			init_bitmap(block_cnt); // data blocks
+			// no block is shared, nor indexed
+			if (isreflink())
+				init_zeros("reference counts", block_cnt * sizeof(uint16_t));
+			if (isdedup()) {
+				init_zeros("dedup index", (block_cnt + DEDUP_PROBES) * sizeof(struct dedup_entry));
+				init_zeros("dedup slots", block_cnt * sizeof(uint32_t));
+			}
 			init_inodes(block_cnt);
-			init_blocks(fs_size);
+			if (init_blocks(fs_size) == RETURN_FAILURE) {
+				log_error("Simulation error while formatting: %s", my_strerror(my_errno));
+				return ret;
+			}
 			init_root();
 
-			printf("format: filesystem formatted, size: %d MB\n", fs_size);
-			log_info("format: Filesystem [%s] with size [%d MB] formatted.", path, fs_size);
+			printf("format: filesystem formatted, size: %u MB, block size: %u B\n", fs_size, block_size);
+			log_info("format: Filesystem [%s] with size [%u MB] and block size [%u B] formatted.",
+					 path, fs_size, block_size);
 			ret = RETURN_SUCCESS;
 		}
 	} else {
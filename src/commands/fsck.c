@@ -16,7 +16,7 @@
 
 
 static void generete_name(char* dest) {
-	for (size_t i = 0; i < STRLEN_ITEM_NAME - 1; ++i) {
+	for (size_t i = 0; i < STRLEN_RECORD_NAME - 1; ++i) {
 		dest[i] = CHARS[rand() % CHARS_AMOUNT];
 	}
 }
@@ -55,12 +55,40 @@ static int save_lost_inodes(struct inode* inode_lost_found, struct carry_fsck* c
 			if (add_to_parent(inode_lost_found, &carry_dir) == RETURN_FAILURE) {
 				return RETURN_FAILURE;
 			}
+			carry_fsck->nlinks[i]++;
 		}
 	}
 
 	return RETURN_SUCCESS;
 }
 
+/*
+ * Compare link counts of file inodes with counts of directory items found linking them
+ * and repair the wrong ones. Returns count of repaired inodes.
+ */
+static int repair_link_counts(const struct carry_fsck* carry_fsck) {
+	size_t i;
+	int repaired = 0;
+	struct inode inode_check = {0};
+
+	for (i = 0; i < sb.block_count; ++i) {
+		// inode is free
+		if (carry_fsck->nlinks[i] == 0)
+			continue;
+
+		fs_read_inode(&inode_check, 1, i + 1);
+		if (inode_check.inode_type != Inode_type_file || inode_check.nlink == carry_fsck->nlinks[i])
+			continue;
+
+		log_warning("fsck: inode [%d] has link count [%d], but [%d] links found",
+					inode_check.id_inode, inode_check.nlink, carry_fsck->nlinks[i]);
+		inode_check.nlink = carry_fsck->nlinks[i];
+		fs_write_inode(&inode_check, 1, inode_check.id_inode);
+		repaired++;
+	}
+	return repaired;
+}
+
 /*
  * Check filesystem consistency.
  */
@@ -68,13 +96,16 @@ int sim_fsck() {
 	log_info("fsck");
 
 	int active = 0;
+	int repaired = 0;
 	struct inode inode_root = {0};
 	struct inode inode_lost_found = {0};
 	struct carry_fsck carry_fsck = {0};
 	struct carry_dir_item carry_dir = {0};
 	bool* inode_ids = NULL;
+	uint32_t* nlinks = NULL;
 
-	if ((inode_ids = calloc(sb.block_count, sizeof(uint32_t))) == NULL) {
+	if ((inode_ids = calloc(sb.block_count, sizeof(uint32_t))) == NULL
+			|| (nlinks = calloc(sb.block_count, sizeof(uint32_t))) == NULL) {
 		set_myerrno(Err_malloc);
 		goto fail;
 	}
@@ -84,6 +115,7 @@ int sim_fsck() {
 	}
 
 	carry_fsck.inode_ids = inode_ids;
+	carry_fsck.nlinks = nlinks;
 	carry_fsck.active = active;
 
 	// load root inode and start iterating
@@ -124,6 +156,12 @@ int sim_fsck() {
 		puts("Filesystem status is OK. No lost inodes found.");
 	}
 
+	// hard links are checked, when all directory items are found
+	if ((repaired = repair_link_counts(&carry_fsck)) > 0) {
+		printf("Link counts are REPAIRED. Amount of repaired inodes = %d.\n", repaired);
+	}
+
+	free(nlinks);
 	free(inode_ids);
 	return RETURN_SUCCESS;
 
@@ -131,6 +169,8 @@ corrupted:
 	printf("Filesystem status is CORRUPTED. Unable to create '"LOST_FOUND"' directory. "
 		   "Amount of lost inodes = %d.\n", carry_fsck.active);
 fail:
+	if (nlinks)
+		free(nlinks);
 	if (inode_ids)
 		free(inode_ids);
 	log_warning("fsck: unable to check filesystem consistency");
@@ -0,0 +1,48 @@
+#include <string.h>
+
+#include "cmd_utils.h"
+#include "fs_api.h"
+#include "inode.h"
+
+#include "errors.h"
+#include "logger.h"
+
+#define HEAD_DEFAULT_BYTES	1024	// count of bytes printed, when no count is given
+
+
+/*
+ * Print first bytes of file from filesystem to standard output.
+ */
+int sim_head(const char* path_source, const char* count_str) {
+	log_info("head: [%s] [%s]", path_source, count_str);
+
+	uint32_t count = HEAD_DEFAULT_BYTES;
+	struct inode inode_source = {0};
+
+	// CONTROL
+
+	if (strlen(path_source) == 0) {
+		set_myerrno(Err_arg_missing);
+		goto fail;
+	}
+	if (strlen(count_str) > 0 && parse_number(count_str, &count) == RETURN_FAILURE) {
+		goto fail;
+	}
+	if (get_inode(&inode_source, path_source) == RETURN_FAILURE) {
+		goto fail;
+	}
+	if (inode_source.inode_type != Inode_type_file) {
+		set_myerrno(Err_item_not_file);
+		goto fail;
+	}
+
+	// PRINT
+
+	cat_data_range(&inode_source, 0, count);
+
+	return RETURN_SUCCESS;
+
+fail:
+	log_warning("head: unable to print file [%s]", path_source);
+	return RETURN_FAILURE;
+}
@@ -1,4 +1,7 @@
 #include <sys/stat.h>
+#include <dirent.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -6,30 +9,1039 @@
 
 #include "fs_api.h"
 #include "fs_cache.h"
+#include "fs_prompt.h"
 #include "inode.h"
 #include "cmd_utils.h"
+#include "tar_header.h"
 
 #include "logger.h"
 #include "errors.h"
 
+#define INCP_COMPRESS	"--compress"	// data of file are stored compressed
+#define INCP_STDIN		"-"				// data are read from standard input
+#define INCP_RECURSIVE	"-r"			// directory is copied with its whole tree
+#define INCP_TAR		"--tar"			// items of tar archive are copied into directory
+
+#define TAR_EXTENDED_MAX	(1 << 20)	// biggest extended header or long name, which is read
+
+// item of directory tree in system, parent is always before its children
+struct host_item {
+	char* path;							// path of item in system
+	uint32_t parent;					// index of parent item, root item is its own parent
+	bool is_dir;
+	uint64_t size;						// size of file
+	char name[STRLEN_ITEM_NAME];		// name of item in its directory
+};
+
+// item of tar archive, values of its extended headers are applied already
+struct tar_item {
+	char typeflag;
+	uint64_t size;
+	bool has_size;						// size was given by extended header
+	char* path;
+	char* linkpath;						// target of hard link
+};
+
+extern size_t stream_incp(char* buffer, const size_t count, FILE* stream);
+
+static const char tar_zeros[TAR_BLOCK] = {0};
+
+
+/*
+ * In-copy data of system file to file inode without blocks. Blocks are allocated
+ * by runs, as the data are read, so length of the data doesn't have to be known
+ * in advance. Size of file is set at end of data, small data are moved inline then.
+ * Blocks created so far are released on failure, so the file stays empty.
+ * At most 'limit' bytes are read. Returns count of read bytes, or 'RETURN_FAILURE'.
+ */
+static int64_t incp_data_stream(struct inode* inode_target, FILE* file, const bool is_compress,
+								const uint64_t limit) {
+	uint64_t size = 0;
+	char data[INODE_INLINE_SIZE] = {0};
+
+	if ((is_compress ? incp_data_compressed(inode_target, file, limit, &size)
+					 : incp_data_sparse(inode_target, file, limit, &size)) == RETURN_FAILURE) {
+		free_all_links(inode_target);
+		update_size(inode_target, 0);
+		return RETURN_FAILURE;
+	}
+	update_size(inode_target, size);
+
+	if (fits_inline(size)) {
+		read_file_data(inode_target, data, 0, size);
+		if (set_inline_data(inode_target, data, size) == RETURN_FAILURE)
+			return RETURN_FAILURE;
+	}
+	return (int64_t) size;
+}
+
+/*
+ * In-copy data of system file to existing file with preallocated blocks. Data are written
+ * over the reserved blocks from start of file, only missing blocks are created. Old data
+ * behind the new end are zeroed, so the blocks stay reserved as unwritten ones.
+ * File is emptied on failure. At most 'limit' bytes are read.
+ * Returns count of read bytes, or 'RETURN_FAILURE'.
+ */
+static int64_t incp_data_prealloc(struct inode* inode_target, FILE* file, const uint64_t limit) {
+	uint32_t i, id_block;
+	uint64_t size = 0;
+	uint64_t size_old = inode_target->file_size;
+	size_t read = 0;
+	size_t in_block = 0;
+	size_t buffer_size = sb.count_links * sb.block_size;
+	char* buffer = NULL;
+
+	if ((buffer = malloc(buffer_size)) == NULL) {
+		set_myerrno(Err_malloc);
+		return RETURN_FAILURE;
+	}
+
+	while (size < limit
+			&& (read = stream_incp(buffer, limit - size < buffer_size ? limit - size : buffer_size,
+								   file)) > 0) {
+		if (write_file_data(inode_target, buffer, size, read) == RETURN_FAILURE)
+			goto fail;
+		size += read;
+	}
+
+	// mapped blocks behind new end are cleared, holes of old data stay holes
+	for (i = size / sb.block_size; i < get_count_data_blocks(size_old); ++i) {
+		if (bmap(inode_target, i) == FREE_LINK)
+			continue;
+		// block shared with other file is copied at first
+		if (create_links_at(&id_block, i, 1, inode_target) == RETURN_FAILURE)
+			goto fail;
+		in_block = i == size / sb.block_size ? size % sb.block_size : 0;
+		fs_read_data(buffer, sb.block_size, id_block);
+		memset(buffer + in_block, '\0', sb.block_size - in_block);
+		fs_write_data(buffer, sb.block_size, id_block);
+	}
+	update_size(inode_target, size);
+
+	free(buffer);
+	return (int64_t) size;
+
+fail:
+	free(buffer);
+	free_all_links(inode_target);
+	update_size(inode_target, 0);
+	return RETURN_FAILURE;
+}
+
+// ---------- RECURSIVE -------------------------------------------------------
+
+static void free_host_tree(struct host_item* tree, const size_t count) {
+	size_t i;
+
+	for (i = 0; i < count; ++i) {
+		free(tree[i].path);
+	}
+	free(tree);
+}
+
+/*
+ * Append item of system directory tree, array of items grows twice bigger, when it is full.
+ */
+static int append_host_item(struct host_item** tree, size_t* count, size_t* capacity,
+							const char* path, const uint32_t parent, const char* name) {
+	struct stat st = {0};
+	struct host_item* tree_new = NULL;
+	struct host_item* item = NULL;
+
+	// links are not followed, so the tree has no cycles, other special files are skipped too
+	if (lstat(path, &st) == -1) {
+		set_myerrno(Err_os_open_file);
+		return RETURN_FAILURE;
+	}
+	if (!S_ISDIR(st.st_mode) && !S_ISREG(st.st_mode)) {
+		log_warning("incp: skipping special file [%s]", path);
+		return RETURN_SUCCESS;
+	}
+	if (strlen(name) > get_max_name_length()) {
+		set_myerrno(Err_item_name_long);
+		return RETURN_FAILURE;
+	}
+
+	if (*count == *capacity) {
+		*capacity = *capacity > 0 ? 2 * *capacity : sb.count_dir_items;
+		if ((tree_new = realloc(*tree, *capacity * sizeof(struct host_item))) == NULL) {
+			set_myerrno(Err_malloc);
+			return RETURN_FAILURE;
+		}
+		*tree = tree_new;
+	}
+	item = &(*tree)[*count];
+	if ((item->path = strdup(path)) == NULL) {
+		set_myerrno(Err_malloc);
+		return RETURN_FAILURE;
+	}
+	item->parent = parent;
+	item->is_dir = S_ISDIR(st.st_mode);
+	item->size = item->is_dir ? 0 : (uint64_t) st.st_size;
+	strncpy(item->name, name, STRLEN_ITEM_NAME - 1);
+	item->name[STRLEN_ITEM_NAME - 1] = '\0';
+	(*count)++;
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Collect all items of system directory tree in breadth-first order.
+ * First item is the root itself with given name. Returned array has to be freed.
+ */
+static int scan_host_tree(const char* path_root, const char* name,
+						  struct host_item** tree, size_t* count) {
+	size_t i, capacity = 0;
+	DIR* dir = NULL;
+	struct dirent* entry = NULL;
+	char* path = NULL;
+
+	*tree = NULL;
+	*count = 0;
+	if (append_host_item(tree, count, &capacity, path_root, 0, name) == RETURN_FAILURE) {
+		goto fail;
+	}
+
+	// tree grows behind the directory, which is being read
+	for (i = 0; i < *count; ++i) {
+		if (!(*tree)[i].is_dir)
+			continue;
+		if ((dir = opendir((*tree)[i].path)) == NULL) {
+			set_myerrno(Err_os_open_file);
+			log_error("Unable to open system directory [%s].", (*tree)[i].path);
+			goto fail;
+		}
+		while ((entry = readdir(dir)) != NULL) {
+			if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+				continue;
+
+			if ((path = malloc(strlen((*tree)[i].path) + strlen(entry->d_name) + 2)) == NULL) {
+				set_myerrno(Err_malloc);
+				goto fail;
+			}
+			sprintf(path, "%s/%s", (*tree)[i].path, entry->d_name);
+			if (append_host_item(tree, count, &capacity, path, i, entry->d_name) == RETURN_FAILURE) {
+				goto fail;
+			}
+			free(path);
+			path = NULL;
+		}
+		closedir(dir);
+		dir = NULL;
+	}
+	return RETURN_SUCCESS;
+
+fail:
+	if (dir != NULL)
+		closedir(dir);
+	free(path);
+	free_host_tree(*tree, *count);
+	*tree = NULL;
+	*count = 0;
+	return RETURN_FAILURE;
+}
+
+/*
+ * Remove root of copied tree from destination directory and release the items
+ * copied so far. Error, which stopped the copy, is kept.
+ */
+static void remove_copied_tree(const struct inode* inode_dest, const uint32_t id_root,
+							   const char* name) {
+	size_t count = 0;
+	enum error_ error = my_errno;
+	struct inode inode_parent = {0};
+	struct inode inode_root = {0};
+	struct tree_item* tree = NULL;
+	struct carry_dir_item carry_dir = {0};
+
+	memcpy(&inode_parent, inode_dest, sizeof(struct inode));
+	fs_read_inode(&inode_root, 1, id_root);
+	carry_dir.id = id_root;
+	strncpy(carry_dir.name, name, STRLEN_ITEM_NAME - 1);
+
+	if (remove_from_parent(&inode_parent, &carry_dir) == RETURN_SUCCESS
+			&& collect_tree(&inode_root, &tree, &count) == RETURN_SUCCESS) {
+		free_tree(tree, count);
+		free(tree);
+	}
+	set_myerrno(error);
+}
+
+/*
+ * Copy system directory tree to destination directory under given name. The tree
+ * is scanned at first, so space for all its files is checked at once, then the
+ * directories are created and the files are copied, each right after its parent.
+ * When the copy fails partway, items copied so far are removed again.
+ */
+static int incp_tree(const char* path_source, const char* name, const struct inode* inode_dest) {
+	size_t i, count = 0, count_copied = 0;
+	uint32_t count_blocks = 0;
+	uint32_t count_empty_blocks = 0;
+	uint32_t* ids_new = NULL;			// ids of created items
+	FILE* f_source = NULL;
+	struct host_item* tree = NULL;
+	struct inode inode_new = {0};
+	struct inode inode_parent = {0};
+	struct carry_dir_item carry_dir = {0};
+
+	if (scan_host_tree(path_source, name, &tree, &count) == RETURN_FAILURE) {
+		goto fail;
+	}
+	if ((ids_new = malloc(count * sizeof(uint32_t))) == NULL) {
+		set_myerrno(Err_malloc);
+		goto fail;
+	}
+
+	// data blocks of all files, directories get a block for their items
+	for (i = 0; i < count; ++i) {
+		if (tree[i].size > sb.max_file_size) {
+			set_myerrno(Err_os_file_too_big);
+			goto fail;
+		}
+		if (tree[i].is_dir)
+			count_blocks += 1;
+		else if (!fits_inline(tree[i].size))
+			count_blocks += get_count_data_blocks(tree[i].size);
+	}
+	count_empty_blocks = get_empty_fields_amount_data();
+	if (is_error()) { // error during malloc in 'get_empty_fields_amount_data()'
+		goto fail;
+	}
+	if (!is_enough_space(count_blocks, count_empty_blocks)) {
+		set_myerrno(Err_block_no_blocks);
+		goto fail;
+	}
+
+	for (i = 0; i < count; ++i) {
+		// copy of tree root is added to destination, the rest to their parents
+		if (i == 0)
+			memcpy(&inode_parent, inode_dest, sizeof(struct inode));
+		else
+			fs_read_inode(&inode_parent, 1, ids_new[tree[i].parent]);
+
+		if (tree[i].is_dir) {
+			if (create_inode_directory(&inode_new, inode_parent.id_inode) == RETURN_FAILURE)
+				goto fail;
+		}
+		else {
+			if ((f_source = fopen(tree[i].path, "rb")) == NULL) {
+				set_myerrno(Err_os_open_file);
+				log_error("Unable to open system file [%s].", tree[i].path);
+				goto fail;
+			}
+			if (create_inode_file(&inode_new) == RETURN_FAILURE) {
+				goto fail;
+			}
+			if (fits_inline(tree[i].size)) {
+				incp_data_inline(&inode_new, f_source);
+			}
+			else if (incp_data_stream(&inode_new, f_source, false, UINT64_MAX) == RETURN_FAILURE) {
+				free_inode_file(&inode_new);
+				goto fail;
+			}
+			fclose(f_source);
+			f_source = NULL;
+		}
+
+		carry_dir.id = inode_new.id_inode;
+		strncpy(carry_dir.name, tree[i].name, STRLEN_ITEM_NAME);
+		if (add_to_parent(&inode_parent, &carry_dir) == RETURN_FAILURE) {
+			if (tree[i].is_dir)
+				free_inode_directory(&inode_new);
+			else
+				free_inode_file(&inode_new);
+			goto fail;
+		}
+		ids_new[i] = inode_new.id_inode;
+		count_copied++;
+	}
+
+	free(ids_new);
+	free_host_tree(tree, count);
+	return RETURN_SUCCESS;
+
+fail:
+	if (f_source != NULL)
+		fclose(f_source);
+	// root of the copy is in destination already, so no partial tree is left
+	if (count_copied > 0)
+		remove_copied_tree(inode_dest, ids_new[0], tree[0].name);
+	free(ids_new);
+	free_host_tree(tree, count);
+	return RETURN_FAILURE;
+}
+
+/*
+ * Copy system directory to simulation filesystem -- into existing directory
+ * 'path_target', or as new directory 'path_target'.
+ */
+static int incp_directory(const char* path_source, const char* path_target) {
+	char host_path[strlen(path_source) + 1];
+	char host_name[strlen(path_source) + 1];
+	char dir_path[strlen(path_target) + 1];
+	char dir_name[STRLEN_ITEM_NAME] = {0};
+	const char* name = NULL;
+	struct inode inode_dest = {0};
+
+	if (split_path(path_target, dir_path, dir_name) == RETURN_FAILURE
+			|| split_path(path_source, host_path, host_name) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+	// 1: last element in path is directory, where the tree is copied to
+	if (get_inode(&inode_dest, path_target) != RETURN_FAILURE) {
+		name = host_name;
+	}
+	// 2: last element in path is name of copied directory
+	else if (get_inode(&inode_dest, dir_path) != RETURN_FAILURE) {
+		name = dir_name;
+	}
+	// loading failed -- destination path doesn't exist
+	else {
+		return RETURN_FAILURE;
+	}
+
+	if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0 || strcmp(name, SEPARATOR) == 0) {
+		set_myerrno(Err_dir_arg_invalid);
+		return RETURN_FAILURE;
+	}
+	if (inode_dest.inode_type != Inode_type_dirc || item_exists(&inode_dest, name)) {
+		set_myerrno(Err_item_exists);
+		return RETURN_FAILURE;
+	}
+	// can be set during 'get_inode()', when checking if path exists
+	reset_myerrno();
+
+	return incp_tree(path_source, name, &inode_dest);
+}
+
+// ---------- TAR -------------------------------------------------------------
+
+/*
+ * Read exactly 'size' bytes of archive, data are dropped, when no buffer is given.
+ * Archive can be a pipe, so it is always read, never seeked.
+ */
+static int tar_read(char* buffer, uint64_t size, FILE* archive) {
+	size_t to_read = 0;
+	char skip[TAR_BLOCK];
+
+	while (size > 0) {
+		to_read = size < TAR_BLOCK ? size : TAR_BLOCK;
+		if (stream_incp(buffer != NULL ? buffer : skip, to_read, archive) != to_read) {
+			set_myerrno(Err_archive_invalid);
+			log_error("Unexpected end of tar archive.");
+			return RETURN_FAILURE;
+		}
+		if (buffer != NULL)
+			buffer += to_read;
+		size -= to_read;
+	}
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Skip padding of zeros behind 'size' bytes of data up to the next block of archive.
+ */
+static int tar_read_padding(const uint64_t size, FILE* archive) {
+	return size % TAR_BLOCK != 0 ? tar_read(NULL, TAR_BLOCK - size % TAR_BLOCK, archive)
+								 : RETURN_SUCCESS;
+}
+
+/*
+ * Parse numeric field of header -- octal number ended by space or '\0',
+ * or big endian binary number (base-256), when its first bit is set.
+ */
+static int tar_parse_number(const char* field, const size_t length, uint64_t* value) {
+	size_t i = 0;
+
+	*value = 0;
+	if ((unsigned char) field[0] & 0x80) {
+		// negative numbers are not valid sizes
+		if ((unsigned char) field[0] & 0x40)
+			goto fail;
+		*value = (unsigned char) field[0] & 0x3f;
+		for (i = 1; i < length; ++i) {
+			if (*value > (UINT64_MAX >> 8))
+				goto fail;
+			*value = (*value << 8) | (unsigned char) field[i];
+		}
+		return RETURN_SUCCESS;
+	}
+
+	while (i < length && field[i] == ' ')
+		++i;
+	for (; i < length && field[i] >= '0' && field[i] <= '7'; ++i) {
+		*value = (*value << 3) | (uint64_t) (field[i] - '0');
+	}
+	if (i < length && field[i] != ' ' && field[i] != '\0')
+		goto fail;
+	return RETURN_SUCCESS;
+
+fail:
+	set_myerrno(Err_archive_invalid);
+	return RETURN_FAILURE;
+}
+
+/*
+ * Verify checksum of header, which is computed with its own field filled by spaces.
+ * Old archivers summed signed chars, so both sums are accepted.
+ */
+static bool tar_check_header(const struct tar_header* header) {
+	size_t i;
+	uint64_t stored = 0;
+	long sum = 0, sum_signed = 0;
+	const char* bytes = (const char*) header;
+
+	if (tar_parse_number(header->chksum, sizeof(header->chksum), &stored) == RETURN_FAILURE)
+		return false;
+	for (i = 0; i < sizeof(struct tar_header); ++i) {
+		if (i >= offsetof(struct tar_header, chksum)
+				&& i < offsetof(struct tar_header, chksum) + sizeof(header->chksum)) {
+			sum += ' ';
+			sum_signed += ' ';
+		} else {
+			sum += (unsigned char) bytes[i];
+			sum_signed += (signed char) bytes[i];
+		}
+	}
+	return (uint64_t) sum == stored || (uint64_t) sum_signed == stored;
+}
+
+/*
+ * Read data of extended header or GNU long name into new string, which has to be freed.
+ */
+static int tar_read_string(const uint64_t size, FILE* archive, char** value) {
+	if (size > TAR_EXTENDED_MAX) {
+		set_myerrno(Err_archive_invalid);
+		return RETURN_FAILURE;
+	}
+	if ((*value = calloc(size + 1, sizeof(char))) == NULL) {
+		set_myerrno(Err_malloc);
+		return RETURN_FAILURE;
+	}
+	if (tar_read(*value, size, archive) == RETURN_FAILURE
+			|| tar_read_padding(size, archive) == RETURN_FAILURE) {
+		free(*value);
+		*value = NULL;
+		return RETURN_FAILURE;
+	}
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Replace value of string by copy of given one, previous value is freed.
+ */
+static int tar_set_string(char** value, const char* source, const size_t length) {
+	free(*value);
+	if ((*value = strndup(source, length)) == NULL) {
+		set_myerrno(Err_malloc);
+		return RETURN_FAILURE;
+	}
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Apply records 'length key=value\n' of extended (pax) header to next item of archive.
+ * Only path, link path and size are used, other keys are ignored.
+ */
+static int tar_parse_pax(const char* records, const uint64_t size, struct tar_item* item) {
+	const char* record = records;
+	const char* key = NULL;
+	const char* value = NULL;
+	char* end = NULL;
+	unsigned long long length = 0;
+
+	while (record < records + size) {
+		length = strtoull(record, &end, 10);
+		if (length == 0 || *end != ' ' || record + length > records + size
+				|| record[length - 1] != '\n') {
+			set_myerrno(Err_archive_invalid);
+			return RETURN_FAILURE;
+		}
+		key = end + 1;
+		if ((value = memchr(key, '=', record + length - key)) == NULL) {
+			set_myerrno(Err_archive_invalid);
+			return RETURN_FAILURE;
+		}
+		++value;
+
+		if (strncmp(key, "path=", 5) == 0) {
+			if (tar_set_string(&item->path, value, record + length - 1 - value) == RETURN_FAILURE)
+				return RETURN_FAILURE;
+		}
+		else if (strncmp(key, "linkpath=", 9) == 0) {
+			if (tar_set_string(&item->linkpath, value, record + length - 1 - value) == RETURN_FAILURE)
+				return RETURN_FAILURE;
+		}
+		else if (strncmp(key, "size=", 5) == 0) {
+			item->size = strtoull(value, NULL, 10);
+			item->has_size = true;
+		}
+		record += length;
+	}
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Read headers of next item of archive, including extended headers and GNU long names
+ * before it. Returns 'RETURN_FAILURE' with no error set at end of archive.
+ */
+static int tar_read_item(FILE* archive, struct tar_item* item) {
+	size_t read = 0;
+	uint64_t size = 0;
+	char* value = NULL;
+	struct tar_header header;
+
+	while (true) {
+		// end of archive is marked by zero block, missing one is tolerated
+		if ((read = stream_incp((char*) &header, TAR_BLOCK, archive)) == 0
+				|| (read == TAR_BLOCK && memcmp(&header, tar_zeros, TAR_BLOCK) == 0)) {
+			return RETURN_FAILURE;
+		}
+		if (read != TAR_BLOCK || !tar_check_header(&header)
+				|| tar_parse_number(header.size, sizeof(header.size), &size) == RETURN_FAILURE) {
+			set_myerrno(Err_archive_invalid);
+			log_error("Invalid header in tar archive.");
+			return RETURN_FAILURE;
+		}
+
+		switch (header.typeflag) {
+			// extended header of next item
+			case 'x':
+				if (tar_read_string(size, archive, &value) == RETURN_FAILURE
+						|| tar_parse_pax(value, size, item) == RETURN_FAILURE) {
+					free(value);
+					return RETURN_FAILURE;
+				}
+				free(value);
+				value = NULL;
+				break;
+			// GNU long name or long link name of next item
+			case 'L':
+			case 'K':
+				if (tar_read_string(size, archive, &value) == RETURN_FAILURE)
+					return RETURN_FAILURE;
+				if (header.typeflag == 'L') {
+					free(item->path);
+					item->path = value;
+				} else {
+					free(item->linkpath);
+					item->linkpath = value;
+				}
+				value = NULL;
+				break;
+			// global extended header applies to no particular item
+			case 'g':
+				if (tar_read(NULL, size, archive) == RETURN_FAILURE
+						|| tar_read_padding(size, archive) == RETURN_FAILURE)
+					return RETURN_FAILURE;
+				break;
+			default:
+				// values of extended headers take precedence
+				item->typeflag = header.typeflag;
+				if (!item->has_size)
+					item->size = size;
+				if (item->path == NULL) {
+					// path is split to prefix and name, when it is too long (ustar)
+					if ((value = calloc(TAR_PREFIX + TAR_NAME + 2, sizeof(char))) == NULL) {
+						set_myerrno(Err_malloc);
+						return RETURN_FAILURE;
+					}
+					if (memcmp(header.magic, "ustar", 5) == 0 && header.prefix[0] != '\0')
+						sprintf(value, "%.*s/", TAR_PREFIX, header.prefix);
+					strncat(value, header.name, TAR_NAME);
+					item->path = value;
+					value = NULL;
+				}
+				if (item->linkpath == NULL
+						&& tar_set_string(&item->linkpath, header.linkname, TAR_NAME) == RETURN_FAILURE)
+					return RETURN_FAILURE;
+				// old archivers marked directories only by '/' at end of name
+				if ((item->typeflag == '0' || item->typeflag == '\0') && strlen(item->path) > 0
+						&& item->path[strlen(item->path) - 1] == SEPARATOR[0])
+					item->typeflag = '5';
+				return RETURN_SUCCESS;
+		}
+	}
+}
+
+/*
+ * Release strings of archive item and clear it for the next one.
+ */
+static void tar_clear_item(struct tar_item* item) {
+	free(item->path);
+	free(item->linkpath);
+	memset(item, 0, sizeof(struct tar_item));
+}
+
+/*
+ * Normalize path of archive item relative to destination directory -- leading '/',
+ * empty and '.' elements are dropped. Path with '..' is refused, so items can't
+ * be written outside of the destination.
+ */
+static int tar_normalize_path(const char* path, char* normalized) {
+	const char* element = path;
+	size_t length = 0;
+
+	normalized[0] = '\0';
+	while (*element != '\0') {
+		length = strcspn(element, SEPARATOR);
+		if (length == 2 && strncmp(element, "..", 2) == 0) {
+			set_myerrno(Err_dir_arg_invalid);
+			return RETURN_FAILURE;
+		}
+		if (length > get_max_name_length()) {
+			set_myerrno(Err_item_name_long);
+			return RETURN_FAILURE;
+		}
+		if (length > 0 && !(length == 1 && element[0] == '.')) {
+			if (normalized[0] != '\0')
+				strcat(normalized, SEPARATOR);
+			strncat(normalized, element, length);
+		}
+		element += length;
+		if (*element != '\0')
+			++element;
+	}
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Get parent directory of archive item with normalized path relative to destination,
+ * missing directories on the path are created. Name of the item is returned in 'name'.
+ */
+static int tar_get_parent(const char* path_dest, const struct inode* inode_dest,
+						  const char* path, struct inode* inode_parent, char* name) {
+	char path_dir[strlen(path_dest) + strlen(path) + 2];
+	char* element = NULL;
+	char* separator = NULL;
+	struct inode inode_dir = {0};
+	struct carry_dir_item carry_dir = {0};
+
+	sprintf(path_dir, "%s%s%s", path_dest, SEPARATOR, path);
+	element = path_dir + strlen(path_dest) + 1;
+	// destination could change by previous items
+	fs_read_inode(inode_parent, 1, inode_dest->id_inode);
+
+	// directories of path are looked up one by one, the path is cut behind them
+	while ((separator = strchr(element, SEPARATOR[0])) != NULL) {
+		*separator = '\0';
+		if (get_inode(&inode_dir, path_dir) == RETURN_FAILURE) {
+			// can be set during 'get_inode()', when checking if directory exists
+			reset_myerrno();
+			if (create_inode_directory(&inode_dir, inode_parent->id_inode) == RETURN_FAILURE) {
+				return RETURN_FAILURE;
+			}
+			memset(&carry_dir, 0, sizeof(struct carry_dir_item));
+			carry_dir.id = inode_dir.id_inode;
+			strncpy(carry_dir.name, element, STRLEN_ITEM_NAME - 1);
+			if (add_to_parent(inode_parent, &carry_dir) == RETURN_FAILURE) {
+				free_inode_directory(&inode_dir);
+				return RETURN_FAILURE;
+			}
+		}
+		else if (inode_dir.inode_type != Inode_type_dirc) {
+			set_myerrno(Err_item_exists);
+			return RETURN_FAILURE;
+		}
+		*separator = SEPARATOR[0];
+		memcpy(inode_parent, &inode_dir, sizeof(struct inode));
+		element = separator + 1;
+	}
+	strncpy(name, element, STRLEN_ITEM_NAME - 1);
+	return RETURN_SUCCESS;
+}
+
+/*
+ * In-copy data of archive item to file. Existing file is rewritten.
+ * Data are read exactly up to the size of item, so the next header follows.
+ */
+static int tar_incp_file(struct inode* inode_parent, const char* name, const char* path_item,
+						 const struct tar_item* item, FILE* archive) {
+	int64_t read = 0;
+	char data[INODE_INLINE_SIZE] = {0};
+	struct inode inode_target = {0};
+	struct carry_dir_item carry_dir = {0};
+	bool is_new = !item_exists(inode_parent, name);
+
+	if (item->size > sb.max_file_size) {
+		set_myerrno(Err_os_file_too_big);
+		return RETURN_FAILURE;
+	}
+
+	if (!is_new) {
+		if (get_inode(&inode_target, path_item) == RETURN_FAILURE)
+			return RETURN_FAILURE;
+		if (inode_target.inode_type != Inode_type_file) {
+			set_myerrno(Err_item_not_file);
+			return RETURN_FAILURE;
+		}
+		// preallocated blocks are kept for the new data, the others are released
+		if (!isprealloc(&inode_target)) {
+			free_all_links(&inode_target);
+			update_size(&inode_target, 0);
+		}
+	}
+	else if (create_inode_file(&inode_target) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+
+	// small file is stored inline, blocks of the others are allocated by runs
+	if (isprealloc(&inode_target)) {
+		if ((read = incp_data_prealloc(&inode_target, archive, item->size)) == RETURN_FAILURE)
+			goto fail;
+	}
+	else if (fits_inline(item->size)) {
+		if (tar_read(data, item->size, archive) == RETURN_FAILURE
+				|| set_inline_data(&inode_target, data, item->size) == RETURN_FAILURE)
+			goto fail;
+		read = (int64_t) item->size;
+	}
+	else if ((read = incp_data_stream(&inode_target, archive, false, item->size)) == RETURN_FAILURE) {
+		goto fail;
+	}
+	if ((uint64_t) read != item->size) {
+		set_myerrno(Err_archive_invalid);
+		log_error("Unexpected end of tar archive.");
+		goto fail;
+	}
+
+	if (is_new) {
+		carry_dir.id = inode_target.id_inode;
+		strncpy(carry_dir.name, name, STRLEN_ITEM_NAME - 1);
+		if (add_to_parent(inode_parent, &carry_dir) == RETURN_FAILURE)
+			goto fail;
+	}
+	return tar_read_padding(item->size, archive);
+
+fail:
+	if (is_new)
+		free_inode_file(&inode_target);
+	return RETURN_FAILURE;
+}
+
+/*
+ * Create directory item of archive, existing directory is kept.
+ */
+static int tar_incp_directory(struct inode* inode_parent, const char* name, const char* path_item) {
+	struct inode inode_new = {0};
+	struct carry_dir_item carry_dir = {0};
+
+	if (item_exists(inode_parent, name)) {
+		if (get_inode(&inode_new, path_item) == RETURN_FAILURE)
+			return RETURN_FAILURE;
+		if (inode_new.inode_type != Inode_type_dirc) {
+			set_myerrno(Err_item_exists);
+			return RETURN_FAILURE;
+		}
+		return RETURN_SUCCESS;
+	}
+
+	if (create_inode_directory(&inode_new, inode_parent->id_inode) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+	carry_dir.id = inode_new.id_inode;
+	strncpy(carry_dir.name, name, STRLEN_ITEM_NAME - 1);
+	if (add_to_parent(inode_parent, &carry_dir) == RETURN_FAILURE) {
+		free_inode_directory(&inode_new);
+		return RETURN_FAILURE;
+	}
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Create hard link item of archive to file, which was copied from the archive before.
+ * Existing link to the same file is kept, so the archive can be copied again.
+ */
+static int tar_incp_link(struct inode* inode_parent, const char* name, const char* path_item,
+						 const char* path_target) {
+	struct inode inode_target = {0};
+	struct inode inode_item = {0};
+	struct carry_dir_item carry_dir = {0};
+
+	if (get_inode(&inode_target, path_target) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+	if (inode_target.inode_type != Inode_type_file) {
+		set_myerrno(Err_item_not_file);
+		return RETURN_FAILURE;
+	}
+	if (item_exists(inode_parent, name)) {
+		if (get_inode(&inode_item, path_item) == RETURN_FAILURE)
+			return RETURN_FAILURE;
+		if (inode_item.id_inode != inode_target.id_inode) {
+			set_myerrno(Err_item_exists);
+			return RETURN_FAILURE;
+		}
+		return RETURN_SUCCESS;
+	}
+
+	carry_dir.id = inode_target.id_inode;
+	strncpy(carry_dir.name, name, STRLEN_ITEM_NAME - 1);
+	if (add_to_parent(inode_parent, &carry_dir) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+	// files created before link counts were tracked have count 0, but one link
+	inode_target.nlink = (inode_target.nlink > 0 ? inode_target.nlink : 1) + 1;
+	fs_write_inode(&inode_target, 1, inode_target.id_inode);
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Copy items of tar archive into existing directory of simulation filesystem.
+ * Archive is read in one pass, so it can come from a pipe -- data of files are
+ * written right into the image with blocks allocated by runs, as they are read.
+ * Missing directories on paths of items are created, existing files are rewritten.
+ * Symbolic links and special files are skipped. Archive '-' is standard input.
+ */
+static int incp_tar(const char* path_archive, const char* path_dest) {
+	bool is_stdin = strcmp(path_archive, INCP_STDIN) == 0;
+	size_t length = 0;
+	char* path = NULL;					// normalized path of item
+	char* path_item = NULL;				// path of item in filesystem
+	char* path_link = NULL;				// path of hard link target in filesystem
+	char name[STRLEN_ITEM_NAME] = {0};
+	char skip[TAR_BLOCK];
+	FILE* archive = NULL;
+	struct inode inode_dest = {0};
+	struct inode inode_parent = {0};
+	struct tar_item item = {0};
+
+	if (get_inode(&inode_dest, path_dest) == RETURN_FAILURE) {
+		goto fail;
+	}
+	if (inode_dest.inode_type != Inode_type_dirc) {
+		set_myerrno(Err_item_not_directory);
+		goto fail;
+	}
+	if (is_stdin) {
+		archive = stdin;
+	}
+	else if ((archive = fopen(path_archive, "rb")) == NULL) {
+		set_myerrno(Err_os_open_file);
+		log_error("Unable to open system file [%s].", path_archive);
+		goto fail;
+	}
+	// can be set during 'get_inode()', end of archive is told from error by it
+	reset_myerrno();
+
+	while (tar_read_item(archive, &item) != RETURN_FAILURE) {
+		length = strlen(path_dest) + strlen(item.path) + strlen(item.linkpath) + 2;
+		if ((path = malloc(length)) == NULL || (path_item = malloc(length)) == NULL
+				|| (path_link = malloc(length)) == NULL) {
+			set_myerrno(Err_malloc);
+			goto fail;
+		}
+		if (tar_normalize_path(item.path, path) == RETURN_FAILURE) {
+			log_error("Invalid path of item in tar archive [%s].", item.path);
+			goto fail;
+		}
+		sprintf(path_item, "%s%s%s", path_dest, SEPARATOR, path);
+
+		// destination directory itself has no parent, it is only kept
+		if (path[0] == '\0') {
+			if (item.typeflag != '5') {
+				set_myerrno(Err_archive_invalid);
+				goto fail;
+			}
+		}
+		else if (tar_get_parent(path_dest, &inode_dest, path, &inode_parent, name) == RETURN_FAILURE) {
+			goto fail;
+		}
+
+		switch (item.typeflag) {
+			case '5':
+				if ((path[0] != '\0' && tar_incp_directory(&inode_parent, name, path_item) == RETURN_FAILURE)
+						|| tar_read(NULL, item.size, archive) == RETURN_FAILURE
+						|| tar_read_padding(item.size, archive) == RETURN_FAILURE)
+					goto fail;
+				break;
+			// regular and contiguous files
+			case '0':
+			case '7':
+			case '\0':
+				if (tar_incp_file(&inode_parent, name, path_item, &item, archive) == RETURN_FAILURE)
+					goto fail;
+				break;
+			case '1':
+				if (tar_normalize_path(item.linkpath, path) == RETURN_FAILURE) {
+					log_error("Invalid link of item in tar archive [%s].", item.linkpath);
+					goto fail;
+				}
+				sprintf(path_link, "%s%s%s", path_dest, SEPARATOR, path);
+				if (tar_incp_link(&inode_parent, name, path_item, path_link) == RETURN_FAILURE)
+					goto fail;
+				break;
+			default:
+				log_warning("incp: skipping item [%s] of type [%c]", item.path, item.typeflag);
+				if (tar_read(NULL, item.size, archive) == RETURN_FAILURE
+						|| tar_read_padding(item.size, archive) == RETURN_FAILURE)
+					goto fail;
+				break;
+		}
+
+		tar_clear_item(&item);
+		free(path);
+		free(path_item);
+		free(path_link);
+		path = path_item = path_link = NULL;
+	}
+	// end of archive is also reached on invalid header
+	if (is_error()) {
+		goto fail;
+	}
+
+	// rest of standard input is consumed, as with in-copy of other data from it
+	if (is_stdin) {
+		while (stream_incp(skip, TAR_BLOCK, archive) > 0)
+			;
+		clearerr(stdin);
+	}
+	else {
+		fclose(archive);
+	}
+	return RETURN_SUCCESS;
+
+fail:
+	tar_clear_item(&item);
+	free(path);
+	free(path_item);
+	free(path_link);
+	if (is_stdin)
+		clearerr(stdin);
+	else if (archive != NULL)
+		fclose(archive);
+	return RETURN_FAILURE;
+}
+
+// ---------- COMMAND ---------------------------------------------------------
 
 /*
  * Copy file from normal filesystem into simulation filesystem.
+ * With compress option, data are compressed by clusters of blocks.
+ * Source '-' is standard input. Data of pipes and other streams are copied,
+ * until they end, their size is not checked in advance.
+ * With recursive option, directory is copied with its whole tree.
+ * With tar option, items of tar archive are copied into existing directory.
  */
-int sim_incp(const char* path_source, const char* path_target) {
-	log_info("incp: [%s] [%s]", path_source, path_target);
+int sim_incp(const char* arg1, const char* arg2, const char* arg3) {
+	log_info("incp: [%s] [%s] [%s]", arg1, arg2, arg3);
 
+	// first argument is compress, recursive or tar option, paths are the next ones
+	bool is_compress = strcmp(arg1, INCP_COMPRESS) == 0;
+	bool is_recursive = strcmp(arg1, INCP_RECURSIVE) == 0;
+	bool is_tar = strcmp(arg1, INCP_TAR) == 0;
+	const char* path_source = is_compress || is_recursive || is_tar ? arg2 : arg1;
+	const char* path_target = is_compress || is_recursive || is_tar ? arg3 : arg2;
+	bool is_stdin = strcmp(path_source, INCP_STDIN) == 0;
+	bool is_stream = is_stdin;		// length of data is unknown until their end
 	struct stat st = {0};
 	FILE* f_source = NULL;
 	uint32_t count_blocks = 0;
-	uint32_t count_existing_block = 0;
 	uint32_t count_empty_blocks = 0;
-	uint32_t* links = NULL;
+	uint32_t count_prealloc = 0;
 	char dir_path[strlen(path_target) + 1];
 	char dir_name[STRLEN_ITEM_NAME] = {0};
 	struct inode inode_target = {0};
 	struct inode inode_parent = {0};
-	struct carry_stream carry_stream = {0};
 	struct carry_dir_item carry_dir = {0};
 
 	// CONTROL
@@ -38,42 +1050,77 @@ int sim_incp(const char* path_source, const char* path_target) {
 		set_myerrno(Err_arg_missing);
 		goto fail;
 	}
+	if (is_compress && !(sb.features & FS_FEATURE_COMPRESSION)) {
+		set_myerrno(Err_fs_no_feature);
+		goto fail;
+	}
 	if (split_path(path_target, dir_path, dir_name) == RETURN_FAILURE) {
 		goto fail;
 	}
+	// archive is read as it comes, its items are checked one by one
+	if (is_tar) {
+		if (incp_tar(path_source, path_target) == RETURN_FAILURE) {
+			goto fail;
+		}
+		return RETURN_SUCCESS;
+	}
+	if (is_stdin) {
+		f_source = stdin;
+	}
 	// 'path_source' file exists in OS
-	if (access(path_source, F_OK) != 0) {
+	else if (access(path_source, F_OK) != 0) {
 		set_myerrno(Err_item_not_exists);
 		goto fail;
 	}
-	// open file to load data from
-	if (stat(path_source, &st) == -1
-			|| (f_source = fopen(path_source, "rb")) == NULL) {
+	// open file to load data from, directory is read by items
+	else if (stat(path_source, &st) == -1
+			|| (!S_ISDIR(st.st_mode) && (f_source = fopen(path_source, "rb")) == NULL)) {
 		set_myerrno(Err_os_open_file);
 		log_error("Unable to open system file [%s].", path_source);
 		goto fail;
 	}
-	// count of data blocks with data (only -- no deep blocks of indirect links)
-	count_blocks = get_count_data_blocks(st.st_size);
-	if (count_blocks >= sb.block_count
-		|| count_blocks * sb.block_size > sb.max_file_size) {
-		set_myerrno(Err_os_file_too_big);
-		goto fail;
-	}
-	// count of empty data blocks in filesystem
-	count_empty_blocks = get_empty_fields_amount_data();
-	if (is_error()) { // error during malloc in 'get_empty_fields_amount_data()'
-		goto fail;
+	// directory is copied only recursively
+	else if (S_ISDIR(st.st_mode)) {
+		if (!is_recursive) {
+			set_myerrno(Err_item_not_file);
+			goto fail;
+		}
+		if (incp_directory(path_source, path_target) == RETURN_FAILURE) {
+			goto fail;
+		}
+		return RETURN_SUCCESS;
 	}
-	// check enough blocks and space in filesystem
-	if (count_empty_blocks == 0 || !is_enough_space(count_blocks, count_empty_blocks)) {
-		set_myerrno(Err_block_no_blocks);
-		goto fail;
+	// size of pipe or device is not known, space is checked as the data come
+	else if (!S_ISREG(st.st_mode)) {
+		is_stream = true;
 	}
 
-	if ((links = malloc(count_blocks * sizeof(uint32_t))) == NULL) {
-		set_myerrno(Err_malloc);
-		goto fail;
+	if (!is_stream) {
+		// count of data blocks with data (only -- no deep blocks of indirect links)
+		count_blocks = get_count_data_blocks(st.st_size);
+		if (count_blocks >= sb.block_count
+			|| (uint64_t) st.st_size > sb.max_file_size) {
+			set_myerrno(Err_os_file_too_big);
+			goto fail;
+		}
+		// blocks preallocated in existing target are rewritten, only the rest is needed
+		if (!is_compress && get_inode(&inode_target, path_target) != RETURN_FAILURE
+				&& inode_target.inode_type == Inode_type_file && isprealloc(&inode_target)) {
+			count_prealloc = get_count_mapped_blocks(&inode_target);
+			count_blocks -= count_blocks > count_prealloc ? count_prealloc : count_blocks;
+		}
+		reset_myerrno();
+		// count of empty data blocks in filesystem
+		count_empty_blocks = get_empty_fields_amount_data();
+		if (is_error()) { // error during malloc in 'get_empty_fields_amount_data()'
+			goto fail;
+		}
+		// check enough blocks and space in filesystem
+		if (count_blocks > 0
+				&& (count_empty_blocks == 0 || !is_enough_space(count_blocks, count_empty_blocks))) {
+			set_myerrno(Err_block_no_blocks);
+			goto fail;
+		}
 	}
 
 	// IN-COPY
@@ -86,61 +1133,68 @@ int sim_incp(const char* path_source, const char* path_target) {
 			goto fail;
 		}
 
-		// current amount of data block, that inode is pointing at
-		count_existing_block = get_count_data_blocks(inode_target.file_size);
-
-		// create missing blocks
-		if (count_blocks > count_existing_block) {
-			create_empty_links(links, count_blocks - count_existing_block, &inode_target);
+		// preallocated blocks are kept and the data are written into them
+		if (isprealloc(&inode_target) && !is_compress) {
+			if (incp_data_prealloc(&inode_target, f_source, UINT64_MAX) == RETURN_FAILURE) {
+				goto fail;
+			}
 		}
-		// remove additional blocks
-		else if (count_blocks < count_existing_block) {
-			free_amount_of_links(&inode_target, count_existing_block - count_blocks);
+		// small file is rewritten inline, possible links are freed
+		else if (!is_stream && fits_inline(st.st_size)) {
+			incp_data_inline(&inode_target, f_source);
+		}
+		// blocks of the file are released and the data are written again,
+		// so zero blocks of the new data become holes
+		else {
+			free_all_links(&inode_target);
+			update_size(&inode_target, 0);
+			if (incp_data_stream(&inode_target, f_source, is_compress, UINT64_MAX) == RETURN_FAILURE) {
+				goto fail;
+			}
 		}
-
-		// rewrite
-		carry_stream.file = f_source;
-		iterate_links(&inode_target, &carry_stream, incp_data);
-		update_size(&inode_target, st.st_size);
 	}
 	// create inode to copy file into, exists in filesystem
 	else if (create_inode_file(&inode_target) != RETURN_FAILURE) {
-		// create links in new inode to data blocks
-		if (create_empty_links(links, count_blocks, &inode_target) == RETURN_FAILURE) {
+		// copy data, small file needs no blocks
+		if (!is_stream && fits_inline(st.st_size)) {
+			incp_data_inline(&inode_target, f_source);
+		}
+		else if (incp_data_stream(&inode_target, f_source, is_compress, UINT64_MAX) == RETURN_FAILURE) {
 			free_inode_file(&inode_target);
 			goto fail;
 		}
+
 		// get parent of new file -- its path is new file's 'dir_path'
 		if (get_inode(&inode_parent, dir_path) == RETURN_FAILURE) {
+			free_inode_file(&inode_target);
 			goto fail;
 		}
 		// add new inode to parent
 		carry_dir.id = inode_target.id_inode;
 		strncpy(carry_dir.name, dir_name, strlen(dir_name));
 		if (add_to_parent(&inode_parent, &carry_dir) == RETURN_FAILURE) {
-			free_inode_directory(&inode_target);
+			free_inode_file(&inode_target);
 			goto fail;
 		}
-
-		// copy data
-		incp_data_inplace(links, count_blocks, f_source);
-		update_size(&inode_target, st.st_size);
 	}
 	else {
 		goto fail;
 	}
 
-	free(links);
-	fclose(f_source);
+	// standard input stays open, so the simulation can read commands after end of data
+	if (is_stdin)
+		clearerr(stdin);
+	else
+		fclose(f_source);
 	// can be set during 'get_inode()', when checking if file exists
 	reset_myerrno();
 	return RETURN_SUCCESS;
 
 fail:
-	if (links != NULL)
-		free(links);
-	if (f_source != NULL)
+	if (is_stdin)
+		clearerr(stdin);
+	else if (f_source != NULL)
 		fclose(f_source);
-	log_warning("incp: unable to incopy file [%s] [%s]", path_source, path_target);
+	log_warning("incp: unable to incopy file [%s] [%s] [%s]", arg1, arg2, arg3);
 	return RETURN_FAILURE;
 }
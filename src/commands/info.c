@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -19,6 +20,22 @@ static int print_links(const char* type, const uint32_t* links, const size_t lin
 	return 0;
 }
 
+static int print_extents(const char* type, const struct inode* inode_item) {
+	size_t i, count = 0;
+	struct extent* extents = get_extents(inode_item, &count);
+
+	// each extent as [logical block] first block-last block
+	printf("%s", type);
+	for (i = 0; i < count; ++i) {
+		printf(" [%d] %d-%d", extents[i].logical, extents[i].start,
+			   extents[i].start + extents[i].length - 1);
+	}
+	puts("");
+	if (extents)
+		free(extents);
+	return 0;
+}
+
 /*
  * Print information about given inode.
  */
@@ -31,14 +48,30 @@ int sim_info(const char* item) {
 	if (strlen(item) > 0) {
 		if (get_inode(&inode_item, item) != RETURN_FAILURE) {
 			printf(" type: %s\n", inode_item.inode_type == Inode_type_dirc ? "directory" : "file");
-			printf(" size: %d B = %.2f kB = %.2f MB\n",
-						inode_item.file_size,
+			printf(" size: %llu B = %.2f kB = %.2f MB\n",
+						(unsigned long long) inode_item.file_size,
 						(double) inode_item.file_size / 1024,
 						(double) inode_item.file_size / 1024 / 1024);
 			printf(" inode id: %d\n", inode_item.id_inode);
-			print_links(" direct links:", inode_item.direct, COUNT_DIRECT_LINKS);
-			print_links(" indirect links lvl 1:", inode_item.indirect_1, COUNT_INDIRECT_LINKS_1);
-			print_links(" indirect links lvl 2:", inode_item.indirect_2, COUNT_INDIRECT_LINKS_2);
+			printf(" hard links: %d\n", inode_item.nlink);
+			if (iscompressed(&inode_item)) {
+				printf(" compressed by clusters of %d blocks\n", COMPRESS_CLUSTER);
+			}
+			if (isprealloc(&inode_item)
+					&& get_count_mapped_blocks(&inode_item) > get_count_data_blocks(inode_item.file_size)) {
+				printf(" preallocated blocks behind end of file: %u\n", get_count_mapped_blocks(&inode_item)
+					   - get_count_data_blocks(inode_item.file_size));
+			}
+			if (isinline(&inode_item)) {
+				puts(" inline data, no links");
+			} else if (isextent(&inode_item)) {
+				print_extents(" extents:", &inode_item);
+				printf(" extent block: %d\n", extent_block(&inode_item));
+			} else {
+				print_links(" direct links:", inode_item.direct, COUNT_DIRECT_LINKS);
+				print_links(" indirect links lvl 1:", inode_item.indirect_1, COUNT_INDIRECT_LINKS_1);
+				print_links(" indirect links lvl 2:", inode_item.indirect_2, COUNT_INDIRECT_LINKS_2);
+			}
 
 			ret = RETURN_SUCCESS;
 		}
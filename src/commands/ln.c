@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "fs_api.h"
+#include "inode.h"
+#include "iteration_carry.h"
+#include "cmd_utils.h"
+
+#include "errors.h"
+#include "logger.h"
+
+
+/*
+ * Create hard link to file -- new directory item pointing to the same inode,
+ * so the file is visible at both paths without copying its data.
+ */
+int sim_ln(const char* path_target, const char* path_link) {
+	log_info("ln: [%s] [%s]", path_target, path_link);
+
+	char dir_path_target[strlen(path_target) + 1];
+	char dir_name_target[STRLEN_ITEM_NAME] = {0};
+	char dir_path_link[strlen(path_link) + 1];
+	char dir_name_link[STRLEN_ITEM_NAME] = {0};
+	struct inode inode_target = {0};	// inode to link
+	struct inode inode_dest = {0};		// destination directory of new link
+	struct carry_dir_item carry_dir = {0};
+
+	// CONTROL
+
+	if (strlen(path_target) == 0 || strlen(path_link) == 0) {
+		set_myerrno(Err_arg_missing);
+		goto fail;
+	}
+	// get target's and link's paths and names
+	if (split_path(path_target, dir_path_target, dir_name_target) == RETURN_FAILURE
+		|| split_path(path_link, dir_path_link, dir_name_link) == RETURN_FAILURE) {
+		goto fail;
+	}
+
+	// get target inode
+	if (get_inode(&inode_target, path_target) == RETURN_FAILURE) {
+		goto fail;
+	}
+	// only files can be linked, so directories stay a tree
+	if (inode_target.inode_type != Inode_type_file) {
+		set_myerrno(Err_item_not_file);
+		goto fail;
+	}
+
+	// get last two inodes in path
+	// 1: last element in path is directory, where link will be created
+	if (get_inode(&inode_dest, path_link) != RETURN_FAILURE) {
+		strncpy(carry_dir.name, dir_name_target, STRLEN_ITEM_NAME); // name of link
+	}
+	// 2: last element in path is name of link
+	else if (get_inode(&inode_dest, dir_path_link) != RETURN_FAILURE) {
+		strncpy(carry_dir.name, dir_name_link, STRLEN_ITEM_NAME); // name of link
+	}
+	// loading failed -- destination path doesn't exist
+	else {
+		goto fail;
+	}
+
+	// destination inode must be directory, but if loaded 'inode_dest' is file,
+	// then some item already exists there
+	if (inode_dest.inode_type == Inode_type_file) {
+		set_myerrno(Err_item_exists);
+		goto fail;
+	}
+	// check if item exists in destination directory already
+	if (item_exists(&inode_dest, carry_dir.name)) {
+		set_myerrno(Err_item_exists);
+		goto fail;
+	}
+
+	// LINK
+
+	carry_dir.id = inode_target.id_inode;
+	if (add_to_parent(&inode_dest, &carry_dir) == RETURN_FAILURE) {
+		goto fail;
+	}
+
+	// files created before link counts were tracked have count 0, but one link
+	inode_target.nlink = (inode_target.nlink > 0 ? inode_target.nlink : 1) + 1;
+	fs_write_inode(&inode_target, 1, inode_target.id_inode);
+
+	// can be set during 'get_inode()', when checking if path exists
+	reset_myerrno();
+	return RETURN_SUCCESS;
+
+fail:
+	log_warning("ln: unable to link file [%s] [%s]", path_target, path_link);
+	return RETURN_FAILURE;
+}
@@ -11,22 +11,36 @@
 #define BUFFER_INPUT_LENGTH		2048
 
 
-int perform_command(const char* command, const char* arg1, const char* arg2) {
+int perform_command(const char* command, const char* arg1, const char* arg2, const char* arg3) {
 	// allowed commands
 	if (strcmp(command, CMD_PWD) == 0)		return sim_pwd();
-	if (strcmp(command, CMD_CAT) == 0)		return sim_cat(arg1);
-	if (strcmp(command, CMD_LS) == 0)		return sim_ls(arg1);
+	if (strcmp(command, CMD_CAT) == 0)		return sim_cat(arg1, arg2, arg3);
+	if (strcmp(command, CMD_LS) == 0)		return sim_ls(arg1, arg2);
 	if (strcmp(command, CMD_INFO) == 0)		return sim_info(arg1);
 	if (strcmp(command, CMD_MV) == 0)		return sim_mv(arg1, arg2);
-	if (strcmp(command, CMD_CP) == 0)		return sim_cp(arg1, arg2);
-	if (strcmp(command, CMD_RM) == 0)		return sim_rm(arg1);
+	if (strcmp(command, CMD_CP) == 0)		return sim_cp(arg1, arg2, arg3);
+	if (strcmp(command, CMD_RM) == 0)		return sim_rm(arg1, arg2);
 	if (strcmp(command, CMD_CD) == 0)		return sim_cd(arg1);
 	if (strcmp(command, CMD_MKDIR) == 0)	return sim_mkdir(arg1);
 	if (strcmp(command, CMD_RMDIR) == 0)	return sim_rmdir(arg1);
-	if (strcmp(command, CMD_INCP) == 0)		return sim_incp(arg1, arg2);
-	if (strcmp(command, CMD_OUTCP) == 0)	return sim_outcp(arg1, arg2);
+	if (strcmp(command, CMD_INCP) == 0)		return sim_incp(arg1, arg2, arg3);
+	if (strcmp(command, CMD_OUTCP) == 0)	return sim_outcp(arg1, arg2, arg3);
 	if (strcmp(command, CMD_DF) == 0)		return sim_df();
 	if (strcmp(command, CMD_FSCK) == 0)		return sim_fsck();
+	if (strcmp(command, CMD_COMPACT) == 0)	return sim_compact(arg1);
+	if (strcmp(command, CMD_HEAD) == 0)		return sim_head(arg1, arg2);
+	if (strcmp(command, CMD_TAIL) == 0)		return sim_tail(arg1, arg2);
+	if (strcmp(command, CMD_OPEN) == 0)		return sim_open(arg1);
+	if (strcmp(command, CMD_CLOSE) == 0)	return sim_close(arg1);
+	if (strcmp(command, CMD_READ) == 0)		return sim_read(arg1, arg2, arg3);
+	if (strcmp(command, CMD_WRITE) == 0)	return sim_write(arg1, arg2, arg3);
+	if (strcmp(command, CMD_SEEK) == 0)		return sim_seek(arg1, arg2, arg3);
+	if (strcmp(command, CMD_TRUNCATE) == 0)	return sim_truncate(arg1, arg2);
+	if (strcmp(command, CMD_APPEND) == 0)	return sim_append(arg1, arg2);
+	if (strcmp(command, CMD_SYNC) == 0)		return sim_sync(arg1, arg2);
+	if (strcmp(command, CMD_LN) == 0)		return sim_ln(arg1, arg2);
+	if (strcmp(command, CMD_DEDUP) == 0)	return sim_dedup();
+	if (strcmp(command, CMD_FALLOC) == 0)	return sim_falloc(arg1, arg2);
 
 	// forbidden or unknown commands
 	if (strcmp(command, CMD_CORRUPT) == 0
@@ -55,6 +69,7 @@ int sim_load(const char* path) {
 	char command[BUFFER_INPUT_LENGTH] = {0};
 	char arg1[BUFFER_INPUT_LENGTH] = {0};
 	char arg2[BUFFER_INPUT_LENGTH] = {0};
+	char arg3[BUFFER_INPUT_LENGTH] = {0};
 
 	if (strlen(path) == 0) {
 		set_myerrno(Err_arg_missing);
@@ -67,19 +82,21 @@ int sim_load(const char* path) {
 
 	// read lines from file
 	while (getline(&line, &len, fp) != -1) {
-		if (sscanf(line, "%s %s %s", command, arg1, arg2) > 0) {
+		if (sscanf(line, "%s %s %s %s", command, arg1, arg2, arg3) > 0) {
 			// in case some word is longer than BUFFER_INPUT_LENGTH
 			command[BUFFER_INPUT_LENGTH - 1] = '\0';
 			arg1[BUFFER_INPUT_LENGTH - 1] = '\0';
 			arg2[BUFFER_INPUT_LENGTH - 1] = '\0';
+			arg3[BUFFER_INPUT_LENGTH - 1] = '\0';
 
-			printf("performing: %s %s %s\n", command, arg1, arg2);
-			ret = perform_command(command, arg1, arg2);
+			printf("performing: %s %s %s %s\n", command, arg1, arg2, arg3);
+			ret = perform_command(command, arg1, arg2, arg3);
 			printf("...%s\n", ret == RETURN_SUCCESS ? "OK" : "FAIL");
 
 			memset(command, '\0', sizeof(command));
 			memset(arg1, '\0', sizeof(arg1));
 			memset(arg2, '\0', sizeof(arg2));
+			memset(arg3, '\0', sizeof(arg3));
 		}
 	}
 
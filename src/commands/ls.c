@@ -1,21 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "fs_api.h"
 #include "fs_cache.h"
+#include "fs_prompt.h"
 #include "inode.h"
 #include "iteration_carry.h"
 
 #include "logger.h"
 #include "errors.h"
 
+#define LS_SORT_NAME	"-n"	// sort items by name
+#define LS_SORT_SIZE	"-s"	// sort items by size, biggest first
+
+struct ls_item {
+	const char* name;
+	enum item inode_type;
+	uint64_t file_size;
+};
+
+
+/*
+ * Transform number to human readable form and choose correct unit for it.
+ */
+static float human_readable(char* unit, const uint64_t file_size_) {
+	static short loop;
+	static float file_size;
+	static char units[][3] = {"B ", "KB", "MB", "GB"};
+
+	loop = 0;
+	file_size = file_size_;
+
+	while (file_size > 1023.9f) {
+		file_size /= 1024.0f;
+		++loop;
+	}
+	strncpy(unit, units[loop], 3);
+	return file_size;
+}
+
+static int compare_name(const void* a, const void* b) {
+	return strcmp(((const struct ls_item*) a)->name, ((const struct ls_item*) b)->name);
+}
+
+static int compare_size(const void* a, const void* b) {
+	const struct ls_item* item_a = (const struct ls_item*) a;
+	const struct ls_item* item_b = (const struct ls_item*) b;
+	return (item_a->file_size < item_b->file_size) - (item_a->file_size > item_b->file_size);
+}
+
+/*
+ * List all items in given directory inode. Directory items are collected at first,
+ * then their inodes are read at once in sorted order and only then the items are printed.
+ */
+static int list_items(const struct inode* inode_ls, int (*compare)(const void*, const void*)) {
+	size_t i, count = 0;
+	char unit[3] = {0};
+	float file_size = 0;
+	uint32_t* ids = NULL;
+	struct inode* inodes = NULL;
+	struct ls_item* items = NULL;
+	struct carry_items carry = {0};
+
+	if (iterate_links(inode_ls, &carry, collect_items) != RETURN_FAILURE) {
+		goto fail; // error during mallocation
+	}
+
+	// +1, so even for directory without items is something allocated
+	ids = malloc((carry.count + 1) * sizeof(uint32_t));
+	inodes = malloc((carry.count + 1) * sizeof(struct inode));
+	items = malloc((carry.count + 1) * sizeof(struct ls_item));
+	if (ids == NULL || inodes == NULL || items == NULL) {
+		set_myerrno(Err_malloc);
+		goto fail;
+	}
+
+	// dot directories are not listed
+	for (i = 0; i < carry.count; ++i) {
+		if (strcmp(carry.items[i].item_name, ".") == 0
+				|| strcmp(carry.items[i].item_name, "..") == 0)
+			continue;
+		items[count].name = carry.items[i].item_name;
+		ids[count++] = carry.items[i].id_inode;
+	}
+
+	// read inodes in directory, so it is possible to print
+	// their size and if item is file or directory
+	if (load_inodes(inodes, ids, count) == RETURN_FAILURE) {
+		goto fail;
+	}
+	for (i = 0; i < count; ++i) {
+		items[i].inode_type = inodes[i].inode_type;
+		items[i].file_size = inodes[i].file_size;
+	}
+
+	if (compare != NULL) {
+		qsort(items, count, sizeof(struct ls_item), compare);
+	}
+
+	for (i = 0; i < count; ++i) {
+		file_size = human_readable(unit, items[i].file_size);
+
+		if (items[i].inode_type == Inode_type_file) {
+			printf("- %6.1f%s\t%s\n", file_size, unit, items[i].name);
+		}
+		else if (items[i].inode_type == Inode_type_dirc) {
+			printf("d %6.1f%s\t%s%s\n", file_size, unit, items[i].name, SEPARATOR);
+		}
+	}
+
+	free(items);
+	free(inodes);
+	free(ids);
+	free(carry.items);
+	return RETURN_SUCCESS;
+
+fail:
+	if (items)
+		free(items);
+	if (inodes)
+		free(inodes);
+	if (ids)
+		free(ids);
+	if (carry.items)
+		free(carry.items);
+	return RETURN_FAILURE;
+}
 
 /*
  * 	Get inode from given path and list all items inside.
+ * 	Items are listed in directory order, or sorted by name or size with option.
  */
-int sim_ls(const char* path) {
+int sim_ls(const char* arg1, const char* arg2) {
+	const char* path = arg1;
+	int (*compare)(const void*, const void*) = NULL;
 	struct inode inode_ls = {0};
 
-	log_info("ls: [%s]", path);
+	log_info("ls: [%s] [%s]", arg1, arg2);
+
+	// first argument is sort option, path is the second one
+	if (strcmp(arg1, LS_SORT_NAME) == 0) {
+		compare = compare_name;
+		path = arg2;
+	}
+	else if (strcmp(arg1, LS_SORT_SIZE) == 0) {
+		compare = compare_size;
+		path = arg2;
+	}
 
 	// no path given -- list actual directory
 	if (strlen(path) == 0) {
@@ -28,7 +160,10 @@ int sim_ls(const char* path) {
 
 	switch (inode_ls.inode_type) {
 		case Inode_type_dirc:
-			iterate_links(&inode_ls, NULL, list_items);
+			if (list_items(&inode_ls, compare) == RETURN_FAILURE) {
+				log_warning("ls: unable to list [%s]", path);
+				return RETURN_FAILURE;
+			}
 			break;
 
 		case Inode_type_file:
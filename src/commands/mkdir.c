@@ -39,8 +39,12 @@ int sim_mkdir(const char* path) {
 		set_myerrno(Err_item_exists);
 		goto fail;
 	}
-	// check space for in parent for new subdirectory
-	if (iterate_links(&inode_parent, NULL, has_space_for_dir) == RETURN_FAILURE) {
+	carry.id = FREE_LINK;
+	strncpy(carry.name, dir_name, strlen(dir_name));
+
+	// check space for in parent for new subdirectory, inline parent is empty
+	if (!isinline(&inode_parent)
+			&& iterate_links(&inode_parent, &carry, has_space_for_dir) == RETURN_FAILURE) {
 		set_myerrno(Err_dir_full);
 		goto fail;
 	}
@@ -53,7 +57,6 @@ int sim_mkdir(const char* path) {
 	}
 
 	carry.id = inode_new_dir.id_inode;
-	strncpy(carry.name, dir_name, strlen(dir_name));
 
 	if (add_to_parent(&inode_parent, &carry) == RETURN_FAILURE) {
 		free_inode_directory(&inode_new_dir);
@@ -5,6 +5,7 @@
 #include "inode.h"
 #include "iteration_carry.h"
 #include "cmd_utils.h"
+#include "commands.h"
 
 #include "errors.h"
 #include "logger.h"
@@ -62,7 +63,7 @@ int sim_mv(const char* path_source, const char* path_destination) {
 		goto fail;
 	}
 	// else it is really a directory, so check if item exists in destination already
-	if (iterate_links(&inode_dest, &carry_dir, search_block_inode_id) != RETURN_FAILURE) {
+	if (item_exists(&inode_dest, carry_dir.name)) {
 		set_myerrno(Err_item_exists);
 		goto fail;
 	}
@@ -76,7 +77,16 @@ int sim_mv(const char* path_source, const char* path_destination) {
 	}
 	// delete moved record from former place
 	strncpy(carry_dir.name, dir_name_src, STRLEN_ITEM_NAME);
-	iterate_links(&inode_src_parent, &carry_dir, delete_block_item);
+	remove_from_parent(&inode_src_parent, &carry_dir);
+
+	if (inode_src.inode_type == Inode_type_dirc) {
+		// moved directory has new parent
+		if (inode_dest.id_inode != inode_src_parent.id_inode) {
+			set_parent_inode_id(&inode_src, inode_dest.id_inode);
+		}
+		// moved directory might be on path to working directory, so its name there is changed
+		reload_pwd();
+	}
 
 	// can be set during 'get_inode()', when checking if file exists
 	reset_myerrno();
@@ -0,0 +1,43 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "cmd_utils.h"
+#include "fs_api.h"
+#include "inode.h"
+
+#include "errors.h"
+#include "logger.h"
+
+
+/*
+ * Open file in filesystem and print descriptor of its handle.
+ * File is created, if it does not exist yet.
+ */
+int sim_open(const char* path) {
+	log_info("open: [%s]", path);
+
+	int fd = RETURN_FAILURE;
+	struct inode inode_new = {0};
+
+	if (strlen(path) == 0) {
+		set_myerrno(Err_arg_missing);
+		goto fail;
+	}
+	if (get_inode(&inode_new, path) == RETURN_FAILURE) {
+		// file does not exist, so it is created
+		reset_myerrno();
+		if (create_file(&inode_new, path) == RETURN_FAILURE) {
+			goto fail;
+		}
+	}
+	if ((fd = file_open(path)) == RETURN_FAILURE) {
+		goto fail;
+	}
+
+	printf("%d\n", fd);
+	return RETURN_SUCCESS;
+
+fail:
+	log_warning("open: unable to open file [%s]", path);
+	return RETURN_FAILURE;
+}
@@ -1,23 +1,403 @@
+#include <sys/stat.h>
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "fs_api.h"
+#include "fs_cache.h"
 #include "inode.h"
-#include "iteration_carry.h"
+#include "cmd_utils.h"
+#include "tar_header.h"
 
 #include "logger.h"
 #include "errors.h"
 
+#define OUTCP_RECURSIVE	"-r"		// directory is copied with its whole tree
+#define OUTCP_TAR		"--tar"		// directory tree is written to tar archive
+#define OUTCP_STDOUT	"-"			// archive is written to standard output
+
+extern size_t stream_outcp(const char* buffer, const size_t count, FILE* stream);
+
+static const char tar_zeros[TAR_BLOCK] = {0};
+
+// file of tree with id of its first data block, files are read in order of their blocks
+struct block_order {
+	uint32_t id_block;
+	uint32_t index;
+};
+
+
+static int compare_block_order(const void* a, const void* b) {
+	const struct block_order* order_a = (const struct block_order*) a;
+	const struct block_order* order_b = (const struct block_order*) b;
+
+	if (order_a->id_block != order_b->id_block)
+		return (order_a->id_block > order_b->id_block) - (order_a->id_block < order_b->id_block);
+	return (order_a->index > order_b->index) - (order_a->index < order_b->index);
+}
+
+/*
+ * Get index of first item in tree with the same file inode as item 'i',
+ * so hard links within the tree are written as hard links too.
+ */
+static uint32_t find_linked_item(const struct tree_item* tree, const uint32_t i) {
+	uint32_t j;
+
+	if (tree[i].inode.nlink <= 1) {
+		return i;
+	}
+	for (j = 0; j < i; ++j) {
+		if (tree[j].inode.id_inode == tree[i].inode.id_inode)
+			return j;
+	}
+	return i;
+}
+
+/*
+ * Get order of files of tree by their first data blocks, so the filesystem is read
+ * mostly forward. Files without blocks and starting with hole are the last ones.
+ * Returned array has to be freed.
+ */
+static struct block_order* sort_files(const struct tree_item* tree, const size_t count,
+									  size_t* count_files) {
+	size_t i;
+	struct block_order* order = malloc((count + 1) * sizeof(struct block_order));
+
+	if (order == NULL) {
+		set_myerrno(Err_malloc);
+		return NULL;
+	}
+	*count_files = 0;
+	for (i = 0; i < count; ++i) {
+		if (tree[i].inode.inode_type != Inode_type_file)
+			continue;
+
+		order[*count_files].index = i;
+		order[*count_files].id_block = isinline(&tree[i].inode) || tree[i].inode.file_size == 0
+									   ? FREE_LINK : bmap(&tree[i].inode, 0);
+		if (order[*count_files].id_block == FREE_LINK)
+			order[*count_files].id_block = UINT32_MAX;
+		(*count_files)++;
+	}
+	qsort(order, *count_files, sizeof(struct block_order), compare_block_order);
+	return order;
+}
+
+/*
+ * Get paths of all items of tree, each is path of its parent and its name.
+ * Path of root item is given. Returned array and its paths have to be freed.
+ */
+static char** get_tree_paths(const struct tree_item* tree, const size_t count, const char* path_root) {
+	size_t i;
+	char** paths = calloc(count, sizeof(char*));
+
+	if (paths == NULL || (paths[0] = strdup(path_root)) == NULL) {
+		free(paths);
+		set_myerrno(Err_malloc);
+		return NULL;
+	}
+	for (i = 1; i < count; ++i) {
+		if ((paths[i] = malloc(strlen(paths[tree[i].parent]) + strlen(tree[i].name) + 2)) == NULL) {
+			set_myerrno(Err_malloc);
+			break;
+		}
+		// items of root directory of archive have no prefix
+		if (strlen(paths[tree[i].parent]) == 0)
+			strcpy(paths[i], tree[i].name);
+		else
+			sprintf(paths[i], "%s/%s", paths[tree[i].parent], tree[i].name);
+	}
+	if (i < count) {
+		for (i = 0; i < count; ++i)
+			free(paths[i]);
+		free(paths);
+		return NULL;
+	}
+	return paths;
+}
+
+static void free_tree_paths(char** paths, const size_t count) {
+	size_t i;
+
+	if (paths == NULL)
+		return;
+	for (i = 0; i < count; ++i) {
+		free(paths[i]);
+	}
+	free(paths);
+}
+
+// ---------- RECURSIVE -------------------------------------------------------
+
+/*
+ * Copy directory tree to system directory 'path_target', which is created, if it
+ * doesn't exist. Directories are created at first, then files are copied in order
+ * of their first blocks. Hard links within the tree stay hard links, if possible.
+ */
+static int outcp_tree(const struct inode* inode_source, const char* path_target) {
+	size_t i, j, count = 0, count_files = 0;
+	char** paths = NULL;
+	struct stat st = {0};
+	FILE* f_target = NULL;
+	struct tree_item* tree = NULL;
+	struct block_order* order = NULL;
+
+	if (collect_tree(inode_source, &tree, &count) == RETURN_FAILURE
+			|| (paths = get_tree_paths(tree, count, path_target)) == NULL
+			|| (order = sort_files(tree, count, &count_files)) == NULL) {
+		goto fail;
+	}
+
+	// directories are created in the order of tree, so parent exists before its items
+	for (i = 0; i < count; ++i) {
+		if (tree[i].inode.inode_type != Inode_type_dirc)
+			continue;
+		if (mkdir(paths[i], 0755) != 0
+				&& (errno != EEXIST || stat(paths[i], &st) != 0 || !S_ISDIR(st.st_mode))) {
+			set_myerrno(Err_os_open_file);
+			log_error("Unable to create system directory [%s].", paths[i]);
+			goto fail;
+		}
+	}
+
+	for (i = 0; i < count_files; ++i) {
+		// hard link is tried at first, the data are copied, if it fails
+		if ((j = find_linked_item(tree, order[i].index)) != order[i].index) {
+			unlink(paths[order[i].index]);
+			if (link(paths[j], paths[order[i].index]) == 0)
+				continue;
+		}
+		if ((f_target = fopen(paths[order[i].index], "wb")) == NULL) {
+			set_myerrno(Err_os_open_file);
+			log_error("Unable to open system file [%s].", paths[order[i].index]);
+			goto fail;
+		}
+		if (isinline(&tree[order[i].index].inode)) {
+			outcp_data_inline(&tree[order[i].index].inode, f_target);
+		} else if (outcp_data_sparse(&tree[order[i].index].inode, f_target) == RETURN_FAILURE) {
+			goto fail;
+		}
+		fclose(f_target);
+		f_target = NULL;
+	}
+
+	free(order);
+	free_tree_paths(paths, count);
+	free(tree);
+	return RETURN_SUCCESS;
+
+fail:
+	if (f_target != NULL)
+		fclose(f_target);
+	free(order);
+	free_tree_paths(paths, count);
+	free(tree);
+	return RETURN_FAILURE;
+}
+
+// ---------- TAR -------------------------------------------------------------
+
+/*
+ * Write padding of zeros behind 'size' bytes of data, so the archive stays aligned to its blocks.
+ */
+static void tar_write_padding(const uint64_t size, FILE* archive) {
+	if (size % TAR_BLOCK != 0) {
+		stream_outcp(tar_zeros, TAR_BLOCK - size % TAR_BLOCK, archive);
+	}
+}
+
+/*
+ * Append record of extended (pax) header 'length key=value\n',
+ * where length is length of the whole record.
+ */
+static size_t tar_pax_record(char* records, const char* key, const char* value) {
+	size_t length = strlen(key) + strlen(value) + 3;	// space, '=' and '\n'
+	size_t digits = 1;
+
+	// length counts its own digits too
+	while (snprintf(NULL, 0, "%zu", length + digits) > (int) digits) {
+		++digits;
+	}
+	return sprintf(records, "%zu %s=%s\n", length + digits, key, value);
+}
+
+/*
+ * Write header of one item of archive. Path, which doesn't fit into name and prefix
+ * of header, long link name or big size are stored in extended (pax) header before it.
+ */
+static void tar_write_header(FILE* archive, const char* path, const char typeflag,
+							 const uint64_t size, const char* linkname) {
+	size_t i, length = strlen(path);
+	size_t split = 0;				// path is split to prefix and name at this '/'
+	unsigned int sum = 0;
+	char* records = NULL;
+	size_t length_records = 0;
+	char size_str[24] = {0};
+	struct tar_header header;
+
+	// first separator, behind which the rest of path fits into name
+	if (length > TAR_NAME) {
+		for (i = length - TAR_NAME - 1; i < length && i <= TAR_PREFIX; ++i) {
+			if (path[i] == '/') {
+				split = i;
+				break;
+			}
+		}
+	}
+
+	if ((length > TAR_NAME && split == 0) || strlen(linkname) > TAR_NAME || size > TAR_SIZE_MAX) {
+		// each record is at most its key, value and 30 chars for length and separators
+		if ((records = malloc(length + strlen(linkname) + 3 * 30)) != NULL) {
+			if (length > TAR_NAME && split == 0)
+				length_records += tar_pax_record(records + length_records, "path", path);
+			if (strlen(linkname) > TAR_NAME)
+				length_records += tar_pax_record(records + length_records, "linkpath", linkname);
+			if (size > TAR_SIZE_MAX) {
+				snprintf(size_str, sizeof(size_str), "%llu", (unsigned long long) size);
+				length_records += tar_pax_record(records + length_records, "size", size_str);
+			}
+			tar_write_header(archive, "PaxHeader", 'x', length_records, "");
+			stream_outcp(records, length_records, archive);
+			tar_write_padding(length_records, archive);
+			free(records);
+		} else {
+			log_warning("outcp: header of [%s] is cut", path);
+		}
+	}
+
+	memset(&header, '\0', sizeof(struct tar_header));
+	if (split > 0) {
+		memcpy(header.prefix, path, split);
+		strncpy(header.name, path + split + 1, TAR_NAME);
+	} else {
+		strncpy(header.name, path, TAR_NAME);
+	}
+	strncpy(header.linkname, linkname, TAR_NAME);
+	snprintf(header.mode, sizeof(header.mode), "%07o", typeflag == '5' ? 0755 : 0644);
+	snprintf(header.uid, sizeof(header.uid), "%07o", 0);
+	snprintf(header.gid, sizeof(header.gid), "%07o", 0);
+	snprintf(header.size, sizeof(header.size), "%011llo",
+			 (unsigned long long) (size > TAR_SIZE_MAX ? 0 : size));
+	snprintf(header.mtime, sizeof(header.mtime), "%011o", 0);
+	header.typeflag = typeflag;
+	memcpy(header.magic, "ustar", 6);
+	memcpy(header.version, "00", 2);
+
+	// checksum is counted with its own field filled with spaces
+	memset(header.chksum, ' ', sizeof(header.chksum));
+	for (i = 0; i < sizeof(struct tar_header); ++i) {
+		sum += ((unsigned char*) &header)[i];
+	}
+	snprintf(header.chksum, sizeof(header.chksum), "%06o", sum);
+	header.chksum[7] = ' ';
+
+	stream_outcp((const char*) &header, sizeof(struct tar_header), archive);
+}
+
+/*
+ * Write all data of file to archive, holes are written as zeros.
+ */
+static int tar_write_data(const struct inode* inode_source, FILE* archive) {
+	size_t read = 0;
+	size_t chunk = sb.count_links * sb.block_size;
+	uint64_t offset = 0;
+	char* buffer = NULL;
+
+	if ((buffer = malloc(chunk)) == NULL) {
+		set_myerrno(Err_malloc);
+		return RETURN_FAILURE;
+	}
+	while ((read = read_file_data(inode_source, buffer, offset, chunk)) > 0) {
+		stream_outcp(buffer, read, archive);
+		offset += read;
+	}
+	tar_write_padding(inode_source->file_size, archive);
+
+	free(buffer);
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Write directory tree to tar archive. Directories are written at first,
+ * then files in order of their first blocks. Hard links within the tree
+ * are stored as links to the first written item of the file.
+ */
+static int outcp_tar(const struct inode* inode_source, const char* name, FILE* archive) {
+	size_t i, j, count = 0, count_files = 0;
+	char* path = NULL;
+	char** paths = NULL;
+	struct tree_item* tree = NULL;
+	struct block_order* order = NULL;
+
+	if (collect_tree(inode_source, &tree, &count) == RETURN_FAILURE
+			|| (paths = get_tree_paths(tree, count, name)) == NULL
+			|| (order = sort_files(tree, count, &count_files)) == NULL) {
+		goto fail;
+	}
+
+	// directory items of archive end with separator, root of filesystem has no item
+	for (i = 0; i < count; ++i) {
+		if (tree[i].inode.inode_type != Inode_type_dirc || strlen(paths[i]) == 0)
+			continue;
+		if ((path = malloc(strlen(paths[i]) + 2)) == NULL) {
+			set_myerrno(Err_malloc);
+			goto fail;
+		}
+		sprintf(path, "%s/", paths[i]);
+		tar_write_header(archive, path, '5', 0, "");
+		free(path);
+	}
+
+	for (i = 0; i < count_files; ++i) {
+		if ((j = find_linked_item(tree, order[i].index)) != order[i].index) {
+			tar_write_header(archive, paths[order[i].index], '1', 0, paths[j]);
+			continue;
+		}
+		tar_write_header(archive, paths[order[i].index], '0', tree[order[i].index].inode.file_size, "");
+		if (tar_write_data(&tree[order[i].index].inode, archive) == RETURN_FAILURE) {
+			goto fail;
+		}
+	}
+
+	// archive ends with two blocks of zeros
+	stream_outcp(tar_zeros, TAR_BLOCK, archive);
+	stream_outcp(tar_zeros, TAR_BLOCK, archive);
+
+	free(order);
+	free_tree_paths(paths, count);
+	free(tree);
+	return RETURN_SUCCESS;
+
+fail:
+	free(order);
+	free_tree_paths(paths, count);
+	free(tree);
+	return RETURN_FAILURE;
+}
+
+// ---------- COMMAND ---------------------------------------------------------
 
 /*
  * Copy file from simulation filesystem outside to normal filesystem.
+ * With recursive option, directory is copied with all its items to system directory.
+ * With tar option, file or directory tree is written to tar archive,
+ * archive '-' is standard output.
  */
-int sim_outcp(const char* path_source, const char* path_target) {
-	log_info("outcp: [%s] [%s]", path_source, path_target);
+int sim_outcp(const char* arg1, const char* arg2, const char* arg3) {
+	log_info("outcp: [%s] [%s] [%s]", arg1, arg2, arg3);
 
+	// first argument is recursive or tar option, paths are the next ones
+	bool is_recursive = strcmp(arg1, OUTCP_RECURSIVE) == 0;
+	bool is_tar = strcmp(arg1, OUTCP_TAR) == 0;
+	const char* path_source = is_recursive || is_tar ? arg2 : arg1;
+	const char* path_target = is_recursive || is_tar ? arg3 : arg2;
+	bool is_stdout = is_tar && strcmp(path_target, OUTCP_STDOUT) == 0;
+	char dir_path[strlen(path_source) + 1];
+	char dir_name[STRLEN_ITEM_NAME] = {0};
 	struct inode inode_source = {0};
 	FILE* f_target = NULL;
-	struct carry_stream carry = {0};
 
 	// CONTROL
 
@@ -25,31 +405,58 @@ int sim_outcp(const char* path_source, const char* path_target) {
 		set_myerrno(Err_arg_missing);
 		goto fail;
 	}
+	if (split_path(path_source, dir_path, dir_name) == RETURN_FAILURE) {
+		goto fail;
+	}
 	if (get_inode(&inode_source, path_source) == RETURN_FAILURE) {
 		goto fail;
 	}
-	if (inode_source.inode_type != Inode_type_file) {
+	// directory is copied only recursively or to archive
+	if (inode_source.inode_type != Inode_type_file
+			&& !((is_recursive || is_tar) && inode_source.inode_type == Inode_type_dirc)) {
 		set_myerrno(Err_item_not_file);
 		goto fail;
 	}
-	if ((f_target = fopen(path_target, "wb")) == NULL) {
+
+	// OUT-COPY
+
+	if (is_recursive && inode_source.inode_type == Inode_type_dirc) {
+		if (outcp_tree(&inode_source, path_target) == RETURN_FAILURE)
+			goto fail;
+		return RETURN_SUCCESS;
+	}
+
+	if (is_stdout) {
+		f_target = stdout;
+	}
+	else if ((f_target = fopen(path_target, "wb")) == NULL) {
 		set_myerrno(Err_os_open_file);
 		log_error("Unable to open system file [%s].", path_target);
 		goto fail;
 	}
 
-	// OUT-COPY
-
-	carry.file = f_target;
-	carry.data_count = inode_source.file_size;
-	iterate_links(&inode_source, &carry, outcp_data);
+	// items of archive are named from the copied item, root of filesystem has no name
+	if (is_tar) {
+		if (outcp_tar(&inode_source, inode_source.id_inode == ROOT_ID ? "" : dir_name,
+					  f_target) == RETURN_FAILURE)
+			goto fail;
+	}
+	// inline data are stored in inode itself
+	else if (isinline(&inode_source)) {
+		outcp_data_inline(&inode_source, f_target);
+	} else if (outcp_data_sparse(&inode_source, f_target) == RETURN_FAILURE) {
+		goto fail;
+	}
 
-	fclose(f_target);
+	if (is_stdout)
+		fflush(stdout);
+	else
+		fclose(f_target);
 	return RETURN_SUCCESS;
 
 fail:
-	if (f_target != NULL)
+	if (f_target != NULL && !is_stdout)
 		fclose(f_target);
-	log_warning("outcp: unable to outcopy file [%s] [%s]", path_source, path_target);
+	log_warning("outcp: unable to outcopy file [%s] [%s] [%s]", arg1, arg2, arg3);
 	return RETURN_FAILURE;
 }
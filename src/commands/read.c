@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cmd_utils.h"
+#include "fs_api.h"
+
+#include "errors.h"
+#include "logger.h"
+
+
+/*
+ * Read bytes from open file and print them to standard output. Data are read
+ * from position of handle, which is moved, or from given offset (position is kept).
+ */
+int sim_read(const char* fd_str, const char* length_str, const char* offset_str) {
+	log_info("read: [%s] [%s] [%s]", fd_str, length_str, offset_str);
+
+	uint32_t fd = 0;
+	uint32_t length = 0;
+	uint64_t offset = 0;
+	int64_t read = 0;
+	char* buffer = NULL;
+
+	if (parse_number(fd_str, &fd) == RETURN_FAILURE
+			|| parse_number(length_str, &length) == RETURN_FAILURE) {
+		goto fail;
+	}
+	if (strlen(offset_str) > 0 && parse_offset(offset_str, &offset) == RETURN_FAILURE) {
+		goto fail;
+	}
+	// +1, so even for zero length is something allocated
+	if ((buffer = malloc(length + 1)) == NULL) {
+		set_myerrno(Err_malloc);
+		goto fail;
+	}
+
+	read = strlen(offset_str) > 0 ? file_pread((int) fd, buffer, length, offset)
+								  : file_read((int) fd, buffer, length);
+	if (read == RETURN_FAILURE) {
+		goto fail;
+	}
+	fwrite(buffer, sizeof(char), (size_t) read, stdout);
+	putchar('\n');
+
+	free(buffer);
+	return RETURN_SUCCESS;
+
+fail:
+	if (buffer)
+		free(buffer);
+	log_warning("read: unable to read [%s]", fd_str);
+	return RETURN_FAILURE;
+}
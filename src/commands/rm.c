@@ -1,25 +1,36 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "fs_api.h"
+#include "fs_cache.h"
 #include "iteration_carry.h"
 #include "cmd_utils.h"
 
 #include "errors.h"
 #include "logger.h"
 
+#define RM_RECURSIVE	"-r"	// directory is removed with its whole tree
+
 
 /*
- * Remove file from filesystem.
+ * Remove file from filesystem. File with more hard links
+ * is only unlinked from the directory.
+ * With recursive option, directory is removed with all its items.
  */
-int sim_rm(const char* path) {
-	log_info("rm: [%s]", path);
+int sim_rm(const char* arg1, const char* arg2) {
+	log_info("rm: [%s] [%s]", arg1, arg2);
 
+	// first argument is recursive option, path is the next one
+	bool is_recursive = strcmp(arg1, RM_RECURSIVE) == 0;
+	const char* path = is_recursive ? arg2 : arg1;
+	size_t i, count = 0;
 	char dir_path[strlen(path) + 1];
 	char dir_name[STRLEN_ITEM_NAME] = {0};
 	struct inode inode_rm = {0};
 	struct inode inode_parent = {0};
 	struct carry_dir_item carry = {0};
+	struct tree_item* tree = NULL;
 
 	// CONTROL
 
@@ -34,10 +45,29 @@ int sim_rm(const char* path) {
 	if (get_inode_wparent(&inode_rm, &inode_parent, path) == RETURN_FAILURE) {
 		goto fail;
 	}
-	if (inode_rm.inode_type != Inode_type_file) {
+	// directory is removed only recursively
+	if (inode_rm.inode_type != Inode_type_file
+			&& !(is_recursive && inode_rm.inode_type == Inode_type_dirc)) {
 		set_myerrno(Err_item_not_file);
 		goto fail;
 	}
+	if (inode_rm.inode_type == Inode_type_dirc) {
+		if (inode_rm.id_inode == ROOT_ID
+				|| strcmp(dir_name, ".") == 0 || strcmp(dir_name, "..") == 0) {
+			set_myerrno(Err_dir_arg_invalid);
+			goto fail;
+		}
+		if (collect_tree(&inode_rm, &tree, &count) == RETURN_FAILURE) {
+			goto fail;
+		}
+		// current directory can't be removed
+		for (i = 0; i < count; ++i) {
+			if (tree[i].inode.id_inode == inode_actual.id_inode) {
+				set_myerrno(Err_dir_arg_invalid);
+				goto fail;
+			}
+		}
+	}
 
 	// REMOVE
 
@@ -47,16 +77,22 @@ int sim_rm(const char* path) {
 	// delete record from parent
 	// if this fails, which should not, only record about the inode is deleted,
 	// so it is possible to retrieve it with command 'fsck' --> lost+found/
-	if (iterate_links(&inode_parent, &carry, delete_block_item) == RETURN_FAILURE) {
+	if (remove_from_parent(&inode_parent, &carry) == RETURN_FAILURE) {
 		goto fail;
 	}
-	if (free_inode_file(&inode_rm) == RETURN_FAILURE) {
+	if (inode_rm.inode_type == Inode_type_dirc) {
+		if (free_tree(tree, count) == RETURN_FAILURE)
+			goto fail;
+	}
+	else if (unlink_inode_file(&inode_rm) == RETURN_FAILURE) {
 		goto fail;
 	}
 
+	free(tree);
 	return RETURN_SUCCESS;
 
 fail:
-	log_warning("rm: unable to remove file [%s]", path);
+	free(tree);
+	log_warning("rm: unable to remove file [%s] [%s]", arg1, arg2);
 	return RETURN_FAILURE;
 }
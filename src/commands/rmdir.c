@@ -56,7 +56,7 @@ int sim_rmdir(const char* path) {
 	// delete record from parent
 	// if this fails, which should not, only record about the inode is deleted,
 	// so it is possible to retrieve it with command 'fsck' --> lost+found/
-	if (iterate_links(&inode_parent, &carry, delete_block_item) == RETURN_FAILURE) {
+	if (remove_from_parent(&inode_parent, &carry) == RETURN_FAILURE) {
 		goto fail;
 	}
 	// delete directory itself
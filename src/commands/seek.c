@@ -0,0 +1,54 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cmd_utils.h"
+#include "fs_api.h"
+
+#include "errors.h"
+#include "logger.h"
+
+#define SEEK_FROM_CUR	"cur"	// offset is relative to actual position
+#define SEEK_FROM_END	"end"	// offset is relative to end of file
+
+
+/*
+ * Move position of open file handle and print the new position.
+ * Offset is from start of file, or it may be negative relatively to actual position or end.
+ */
+int sim_seek(const char* fd_str, const char* offset_str, const char* whence_str) {
+	log_info("seek: [%s] [%s] [%s]", fd_str, offset_str, whence_str);
+
+	uint32_t fd = 0;
+	uint64_t offset = 0;
+	int whence = SEEK_SET;
+	int64_t position = 0;
+	bool is_negative = offset_str[0] == '-';
+
+	if (strcmp(whence_str, SEEK_FROM_CUR) == 0) {
+		whence = SEEK_CUR;
+	}
+	else if (strcmp(whence_str, SEEK_FROM_END) == 0) {
+		whence = SEEK_END;
+	}
+	else if (strlen(whence_str) > 0 || is_negative) {
+		set_myerrno(Err_dir_arg_invalid);
+		goto fail;
+	}
+
+	if (parse_number(fd_str, &fd) == RETURN_FAILURE
+			|| parse_offset(offset_str + is_negative, &offset) == RETURN_FAILURE) {
+		goto fail;
+	}
+
+	position = file_seek((int) fd, is_negative ? -(int64_t) offset : (int64_t) offset, whence);
+	if (position == RETURN_FAILURE) {
+		goto fail;
+	}
+	printf("%ld\n", (long) position);
+	return RETURN_SUCCESS;
+
+fail:
+	log_warning("seek: unable to seek [%s]", fd_str);
+	return RETURN_FAILURE;
+}
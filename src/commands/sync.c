@@ -0,0 +1,99 @@
+#include <sys/stat.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "fs_api.h"
+#include "fs_cache.h"
+#include "inode.h"
+#include "cmd_utils.h"
+
+#include "logger.h"
+#include "errors.h"
+
+
+/*
+ * Update file in simulation filesystem from file in normal filesystem.
+ * Unlike 'incp', only blocks, which differ from the system file, are written.
+ * File is created, if it does not exist.
+ */
+int sim_sync(const char* path_source, const char* path_target) {
+	log_info("sync: [%s] [%s]", path_source, path_target);
+
+	struct stat st = {0};
+	FILE* f_source = NULL;
+	int64_t written = 0;
+	uint32_t count_blocks = 0;
+	uint32_t count_existing_blocks = 0;
+	uint32_t count_empty_blocks = 0;
+	struct inode inode_target = {0};
+
+	// CONTROL
+
+	if (strlen(path_source) == 0 || strlen(path_target) == 0) {
+		set_myerrno(Err_arg_missing);
+		goto fail;
+	}
+	if (stat(path_source, &st) == -1
+			|| (f_source = fopen(path_source, "rb")) == NULL) {
+		set_myerrno(Err_os_open_file);
+		log_error("Unable to open system file [%s].", path_source);
+		goto fail;
+	}
+	count_blocks = get_count_data_blocks(st.st_size);
+	if (count_blocks >= sb.block_count
+		|| (uint64_t) st.st_size > sb.max_file_size) {
+		set_myerrno(Err_os_file_too_big);
+		goto fail;
+	}
+	if (get_inode(&inode_target, path_target) == RETURN_FAILURE) {
+		reset_myerrno();
+		if (create_file(&inode_target, path_target) == RETURN_FAILURE) {
+			goto fail;
+		}
+	}
+	if (inode_target.inode_type != Inode_type_file) {
+		set_myerrno(Err_item_not_file);
+		goto fail;
+	}
+	// blocks already in file are reused
+	if (!isinline(&inode_target)) {
+		count_existing_blocks = get_count_data_blocks(inode_target.file_size);
+	}
+	count_empty_blocks = get_empty_fields_amount_data();
+	if (is_error()) { // error during malloc in 'get_empty_fields_amount_data()'
+		goto fail;
+	}
+	if (count_blocks > count_existing_blocks
+			&& !is_enough_space(count_blocks - count_existing_blocks, count_empty_blocks)) {
+		set_myerrno(Err_block_no_blocks);
+		goto fail;
+	}
+
+	// SYNC
+
+	// small file is rewritten inline, possible links are freed
+	if (fits_inline(st.st_size)) {
+		incp_data_inline(&inode_target, f_source);
+	}
+	else {
+		// inline data are moved to blocks the usual way
+		if (isinline(&inode_target)) {
+			free_all_links(&inode_target);
+			update_size(&inode_target, 0);
+		}
+		if ((written = sync_data_sparse(&inode_target, f_source)) == RETURN_FAILURE) {
+			goto fail;
+		}
+		update_size(&inode_target, st.st_size);
+	}
+
+	log_info("sync: [%ld] of [%u] blocks written", (long) written, count_blocks);
+	fclose(f_source);
+	return RETURN_SUCCESS;
+
+fail:
+	if (f_source != NULL)
+		fclose(f_source);
+	log_warning("sync: unable to sync file [%s] [%s]", path_source, path_target);
+	return RETURN_FAILURE;
+}
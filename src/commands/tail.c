@@ -0,0 +1,52 @@
+#include <string.h>
+
+#include "cmd_utils.h"
+#include "fs_api.h"
+#include "inode.h"
+
+#include "errors.h"
+#include "logger.h"
+
+#define TAIL_DEFAULT_BYTES	1024	// count of bytes printed, when no count is given
+
+
+/*
+ * Print last bytes of file from filesystem to standard output.
+ * Only blocks at the end of file are read, no matter how big the file is.
+ */
+int sim_tail(const char* path_source, const char* count_str) {
+	log_info("tail: [%s] [%s]", path_source, count_str);
+
+	uint32_t count = TAIL_DEFAULT_BYTES;
+	struct inode inode_source = {0};
+
+	// CONTROL
+
+	if (strlen(path_source) == 0) {
+		set_myerrno(Err_arg_missing);
+		goto fail;
+	}
+	if (strlen(count_str) > 0 && parse_number(count_str, &count) == RETURN_FAILURE) {
+		goto fail;
+	}
+	if (get_inode(&inode_source, path_source) == RETURN_FAILURE) {
+		goto fail;
+	}
+	if (inode_source.inode_type != Inode_type_file) {
+		set_myerrno(Err_item_not_file);
+		goto fail;
+	}
+
+	// PRINT
+
+	if (count > inode_source.file_size) {
+		count = inode_source.file_size;
+	}
+	cat_data_range(&inode_source, inode_source.file_size - count, count);
+
+	return RETURN_SUCCESS;
+
+fail:
+	log_warning("tail: unable to print file [%s]", path_source);
+	return RETURN_FAILURE;
+}
@@ -0,0 +1,24 @@
+#include "cmd_utils.h"
+#include "fs_api.h"
+
+#include "errors.h"
+#include "logger.h"
+
+
+/*
+ * Change size of open file. File is cut, or extended with zeros.
+ */
+int sim_truncate(const char* fd_str, const char* size_str) {
+	log_info("truncate: [%s] [%s]", fd_str, size_str);
+
+	uint32_t fd = 0;
+	uint64_t size = 0;
+
+	if (parse_number(fd_str, &fd) == RETURN_FAILURE
+			|| parse_offset(size_str, &size) == RETURN_FAILURE
+			|| file_truncate((int) fd, size) == RETURN_FAILURE) {
+		log_warning("truncate: unable to truncate [%s]", fd_str);
+		return RETURN_FAILURE;
+	}
+	return RETURN_SUCCESS;
+}
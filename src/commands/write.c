@@ -0,0 +1,42 @@
+#include <string.h>
+
+#include "cmd_utils.h"
+#include "fs_api.h"
+
+#include "errors.h"
+#include "logger.h"
+
+
+/*
+ * Write text to open file. Text is written at position of handle, which is moved,
+ * or at given offset (position is kept).
+ */
+int sim_write(const char* fd_str, const char* text, const char* offset_str) {
+	log_info("write: [%s] [%s] [%s]", fd_str, text, offset_str);
+
+	uint32_t fd = 0;
+	uint64_t offset = 0;
+	int64_t written = 0;
+
+	if (parse_number(fd_str, &fd) == RETURN_FAILURE) {
+		goto fail;
+	}
+	if (strlen(text) == 0) {
+		set_myerrno(Err_arg_missing);
+		goto fail;
+	}
+	if (strlen(offset_str) > 0 && parse_offset(offset_str, &offset) == RETURN_FAILURE) {
+		goto fail;
+	}
+
+	written = strlen(offset_str) > 0 ? file_pwrite((int) fd, text, strlen(text), offset)
+									 : file_write((int) fd, text, strlen(text));
+	if (written == RETURN_FAILURE) {
+		goto fail;
+	}
+	return RETURN_SUCCESS;
+
+fail:
+	log_warning("write: unable to write to [%s]", fd_str);
+	return RETURN_FAILURE;
+}
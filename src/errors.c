@@ -54,6 +54,15 @@ const char* my_strerror(const enum error_ err) {
 		case Err_os_open_file:			return "couldn't open system file";
 		case Err_os_file_too_big:		return "system file is too big";
 		case Err_malloc:				return "not enough space for memory allocation";
+		case Err_arg_nan:				return "argument not a number";
+		case Err_fd_invalid:			return "bad file descriptor";
+		case Err_fd_limit:				return "too many open files";
+		case Err_fs_no_feature:			return "operation not supported by filesystem";
+		case Err_block_shares_limit:	return "data block shared too many times";
+		case Err_data_corrupted:		return "compressed data are corrupted";
+		case Err_fs_block_size:			return "block size out of range";
+		case Err_archive_invalid:		return "invalid tar archive";
+		case Err_arg_invalid:			return "invalid argument";
 		default:						return strerror(errno);
 	}
 }
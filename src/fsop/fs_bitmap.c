@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "fs_api.h"
 #include "fs_cache.h"
@@ -101,6 +102,59 @@ uint32_t allocate_bitmap_field_data() {
 	return index;
 }
 
+/*
+ * Search for run of empty data block bitmap fields. Run starting at 'goal' is preferred,
+ * so file can continue in its last run, then first run long enough for 'wanted' fields,
+ * then the longest run. Fields of found run, but at most 'wanted', are turned off.
+ * Returns id of first field of the run and its length in 'allocated', or 'FREE_LINK'.
+ */
+uint32_t allocate_bitmap_range_data(const uint32_t goal, const uint32_t wanted, uint32_t* allocated) {
+	size_t i, run;
+	size_t best = 0, best_length = 0;
+	bool* bitmap = malloc(sb.block_count);
+
+	*allocated = 0;
+	if (bitmap == NULL) {
+		set_myerrno(Err_malloc);
+		my_perror("System error");
+		return FREE_LINK;
+	}
+
+	fs_seek_bm_data(0);
+	fs_read_bool(bitmap, sb.block_count);
+
+	// run continuing at goal
+	if (goal != FREE_LINK && goal <= sb.block_count && bitmap[goal - 1]) {
+		best = goal - 1;
+		for (i = best; i < sb.block_count && bitmap[i] && best_length < wanted; ++i) {
+			++best_length;
+		}
+	}
+	// first long enough run, or the longest one
+	for (i = 0; i < sb.block_count && best_length < wanted; i += run + 1) {
+		for (run = 0; i + run < sb.block_count && bitmap[i + run]; ++run)
+			;
+		if (run > best_length) {
+			best = i;
+			best_length = run < wanted ? run : wanted;
+		}
+	}
+
+	if (best_length > 0) {
+		// --- turn off fields of the run at once
+		memset(bitmap, false, best_length);
+		fs_seek_bm_data(best);
+		fs_write_bool(bitmap, best_length);
+		*allocated = best_length;
+	} else {
+		set_myerrno(Err_block_no_blocks);
+		log_error("Out of data blocks.");
+	}
+	free(bitmap);
+
+	return best_length > 0 ? best + 1 : FREE_LINK;
+}
+
 /*
  * Wrapper function for releasing inode bitmap field.
  */
@@ -108,13 +162,55 @@ void free_bitmap_field_inode(int32_t id) {
 	bitmap_field_inodes_on(id - 1);
 }
 
+/*
+ * Release run of inode bitmap fields starting at given id.
+ */
+void free_bitmap_range_inode(const uint32_t id, const uint32_t length) {
+	size_t i;
+	bool* bitmap = malloc(length);
+
+	// releasing can't fail, so release fields one by one without memory
+	if (bitmap == NULL) {
+		for (i = 0; i < length; ++i) {
+			bitmap_field_inodes_on(id - 1 + i);
+		}
+		return;
+	}
+	memset(bitmap, true, length);
+	fs_seek_bm_inode(id - 1);
+	fs_write_bool(bitmap, length);
+	free(bitmap);
+}
+
 /*
  * Wrapper function for releasing data block bitmap field.
  */
 void free_bitmap_field_data(int32_t id) {
+	dedup_remove_blocks(id, 1);
 	bitmap_field_data_on(id - 1);
 }
 
+/*
+ * Release run of data block bitmap fields starting at given id.
+ */
+void free_bitmap_range_data(const uint32_t id, const uint32_t length) {
+	size_t i;
+	bool* bitmap = malloc(length);
+
+	dedup_remove_blocks(id, length);
+	// releasing can't fail, so release fields one by one without memory
+	if (bitmap == NULL) {
+		for (i = 0; i < length; ++i) {
+			bitmap_field_data_on(id - 1 + i);
+		}
+		return;
+	}
+	memset(bitmap, true, length);
+	fs_seek_bm_data(id - 1);
+	fs_write_bool(bitmap, length);
+	free(bitmap);
+}
+
 /*
  * Get amount of empty data blocks in filesystem.
  */
@@ -154,6 +250,93 @@ void read_whole_bitmap_data(bool* bitmap) {
 	fs_read_bool(bitmap, sb.block_count);
 }
 
+/*
+ * Get count of files sharing data block with given id besides its first owner.
+ * Without reflink feature, no block is shared.
+ */
+uint16_t get_block_shares(const uint32_t id) {
+	uint16_t shares = 0;
+
+	if (sb.features & FS_FEATURE_REFLINK) {
+		fs_read_refcount(&shares, 1, id);
+	}
+	return shares;
+}
+
+/*
+ * Add one reference to each of 'length' data blocks starting at given id.
+ * Nothing is changed, if any of the blocks can't be referenced more.
+ */
+int share_blocks(const uint32_t id, const uint32_t length) {
+	size_t i;
+	uint16_t* shares = NULL;
+
+	if (!(sb.features & FS_FEATURE_REFLINK)) {
+		set_myerrno(Err_fs_no_feature);
+		return RETURN_FAILURE;
+	}
+	if ((shares = malloc(length * sizeof(uint16_t))) == NULL) {
+		set_myerrno(Err_malloc);
+		return RETURN_FAILURE;
+	}
+
+	fs_read_refcount(shares, length, id);
+	for (i = 0; i < length; ++i) {
+		if (shares[i] == UINT16_MAX) {
+			set_myerrno(Err_block_shares_limit);
+			free(shares);
+			return RETURN_FAILURE;
+		}
+		++shares[i];
+	}
+	fs_write_refcount(shares, length, id);
+
+	free(shares);
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Drop one reference of each shared block of 'length' data blocks starting at given id.
+ * Blocks still used by other file are marked in 'is_shared' (if not NULL),
+ * so they are not released. Returns count of such blocks.
+ */
+size_t unshare_blocks(const uint32_t id, const uint32_t length, bool* is_shared) {
+	size_t i, count = 0;
+	uint16_t shares_one = 0;
+	uint16_t* shares = &shares_one;
+
+	if (!(sb.features & FS_FEATURE_REFLINK)) {
+		if (is_shared)
+			memset(is_shared, false, length);
+		return 0;
+	}
+	// single block is the common case, so don't allocate for it
+	if (length > 1 && (shares = malloc(length * sizeof(uint16_t))) == NULL) {
+		// dropping references can't fail, so drop them one by one without memory
+		for (i = 0; i < length; ++i) {
+			count += unshare_blocks(id + i, 1, is_shared ? &is_shared[i] : NULL);
+		}
+		return count;
+	}
+
+	fs_read_refcount(shares, length, id);
+	for (i = 0; i < length; ++i) {
+		if (is_shared)
+			is_shared[i] = shares[i] > 0;
+		if (shares[i] > 0) {
+			--shares[i];
+			++count;
+		}
+	}
+	if (count > 0) {
+		fs_write_refcount(shares, length, id);
+	}
+
+	if (shares != &shares_one)
+		free(shares);
+	return count;
+}
+
 // --- SPECIFIC FUNCTIONS FOR format.c
 
 void format_root_bm_off() {
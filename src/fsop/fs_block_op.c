@@ -1,8 +1,10 @@
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdint.h>
 #include <stddef.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "fs_api.h"
 #include "fs_cache.h"
@@ -24,22 +26,16 @@ enum search_for {
 };
 
 /*
- * Transform number to human readable form and choose correct unit for it.
+ * Allocate array for all directory items of one block. The array is on heap,
+ * because with big blocks there are too many items for stack.
  */
-static float human_readable(char* unit, const uint32_t file_size_) {
-	static short loop;
-	static float file_size;
-	static char units[][3] = {"B ", "KB", "MB", "GB"};
+struct directory_item* alloc_dir_items() {
+	struct directory_item* block = malloc(sb.count_dir_items * sizeof(struct directory_item));
 
-	loop = 0;
-	file_size = file_size_;
-
-	while (file_size > 1023.9f) {
-		file_size /= 1024.0f;
-		++loop;
+	if (block == NULL) {
+		set_myerrno(Err_malloc);
 	}
-	strncpy(unit, units[loop], 3);
-	return file_size;
+	return block;
 }
 
 /*
@@ -47,14 +43,18 @@ static float human_readable(char* unit, const uint32_t file_size_) {
  */
 int init_block_with_directories(const uint32_t id_block) {
 	size_t i;
-	struct directory_item block[sb.count_dir_items];
+	struct directory_item* block = alloc_dir_items();
 
+	if (block == NULL) {
+		return RETURN_FAILURE;
+	}
 	for (i = 0; i < sb.count_dir_items; i++) {
 	    block[i].id_inode = FREE_LINK;
 		strncpy(block[i].item_name, "", STRLEN_ITEM_NAME);
 	}
 
 	fs_write_directory_item(block, sb.count_dir_items, id_block);
+	free(block);
 	return RETURN_SUCCESS;
 }
 
@@ -97,7 +97,11 @@ static bool search_block(const enum search_for search, const uint32_t* links,
 	bool ret = false;
 	size_t i, j;
 	struct carry_dir_item* carry = (struct carry_dir_item*) p_carry;
-	struct directory_item block[sb.count_dir_items];
+	struct directory_item* block = alloc_dir_items();
+
+	if (block == NULL) {
+		return true;
+	}
 
 	// check every link to block with directory items
 	for (i = 0; i < links_count && !ret; ++i) {
@@ -128,6 +132,7 @@ static bool search_block(const enum search_for search, const uint32_t* links,
 			}
 		}
 	}
+	free(block);
 	return ret;
 }
 
@@ -150,26 +155,34 @@ ITERABLE(search_block_inode_name) {
  */
 ITERABLE(add_block_item) {
 	size_t i, j;
-	struct directory_item block[sb.count_dir_items];
+	bool ret = false;
+	struct directory_item* block = alloc_dir_items();
 	struct carry_dir_item* carry = (struct carry_dir_item*) p_carry;
 
-	for (i = 0; i < links_count; ++i) {
+	if (block == NULL) {
+		return true;
+	}
+
+	for (i = 0; i < links_count && !ret; ++i) {
 		if (links[i] == FREE_LINK)
 			continue;
 
 		fs_read_directory_item(block, sb.count_dir_items, links[i]);
+		if (!has_space_for_record(block, carry->name))
+			continue;
 
-		for (j = 0; j < sb.count_dir_items; ++j) {
+		for (j = 0; j < sb.count_dir_items && !ret; ++j) {
 			// empty place for new item record found
 			if (block[j].id_inode == FREE_LINK) {
 				block[j].id_inode = carry->id;
 				strncpy(block[j].item_name, carry->name, strlen(carry->name) + 1);
 				fs_write_directory_item(block, sb.count_dir_items, links[i]);
-				return true;
+				ret = true;
 			}
 		}
 	}
-	return false;
+	free(block);
+	return ret;
 }
 
 /*
@@ -177,27 +190,39 @@ ITERABLE(add_block_item) {
  */
 ITERABLE(delete_block_item) {
 	size_t i, j;
-	struct directory_item block[sb.count_dir_items];
+	bool ret = false;
+	struct directory_item* block = alloc_dir_items();
 	struct carry_dir_item* carry = (struct carry_dir_item*) p_carry;
 
-	for (i = 0; i < links_count; ++i) {
+	if (block == NULL) {
+		return true;
+	}
+
+	for (i = 0; i < links_count && !ret; ++i) {
 		if (links[i] == FREE_LINK)
 			continue;
 
 		fs_read_directory_item(block, sb.count_dir_items, links[i]);
 
-		for (j = 0; j < sb.count_dir_items; ++j) {
+		for (j = 0; j < sb.count_dir_items && !ret; ++j) {
 			// record with id to delete found
 			if (block[j].id_inode == carry->id
 					&& strcmp(block[j].item_name, carry->name) == 0) {
 				block[j].id_inode = FREE_LINK;
 				strncpy(block[j].item_name, "", STRLEN_ITEM_NAME);
 				fs_write_directory_item(block, sb.count_dir_items, links[i]);
-				return true;
+
+				// check, if the block may be released
+				carry->is_block_empty = true;
+				for (j = 0; j < sb.count_dir_items && carry->is_block_empty; ++j) {
+					carry->is_block_empty = (block[j].id_inode == FREE_LINK);
+				}
+				ret = true;
 			}
 		}
 	}
-	return false;
+	free(block);
+	return ret;
 }
 
 /*
@@ -205,59 +230,88 @@ ITERABLE(delete_block_item) {
  */
 ITERABLE(has_common_directories) {
 	size_t i, j;
-	struct directory_item block[sb.count_dir_items];
+	bool ret = false;
+	struct directory_item* block = alloc_dir_items();
 
-	for (i = 0; i < links_count; ++i) {
+	if (block == NULL) {
+		return true;
+	}
+
+	for (i = 0; i < links_count && !ret; ++i) {
 		if (links[i] == FREE_LINK)
 			continue;
 
 		fs_read_directory_item(block, sb.count_dir_items, links[i]);
 
-		for (j = 0; j < sb.count_dir_items; ++j) {
+		for (j = 0; j < sb.count_dir_items && !ret; ++j) {
 			// other directory than "." and ".." found == directory is not empty
-			if (strcmp(block[j].item_name, "") != 0
-					&& strcmp(block[j].item_name, ".") != 0
-					&& strcmp(block[j].item_name, "..") != 0) {
-				return true;
-			}
+			ret = strcmp(block[j].item_name, "") != 0
+				  && strcmp(block[j].item_name, ".") != 0
+				  && strcmp(block[j].item_name, "..") != 0;
 		}
 	}
-	return false;
+	free(block);
+	return ret;
 }
 
 /*
- * Check if there is space in directory inode for subdirectory record.
+ * Check if record of item with given name fits to directory block with given items.
  */
-ITERABLE(has_space_for_dir) {
-	size_t i, j;
-	struct directory_item block[sb.count_dir_items];
+bool has_space_for_record(const struct directory_item* block, const char* name) {
+	size_t i;
+	size_t used = dir_record_size(strlen(name));
+	bool is_varlen = (bool) (sb.features & FS_FEATURE_DIR_VARLEN);
 
-	for (i = 0; i < links_count; ++i) {
-		// empty link in inode == new link to empty block can be created
-		if (links[i] == FREE_LINK)
+	for (i = 0; i < sb.count_dir_items; ++i) {
+		if (block[i].id_inode != FREE_LINK) {
+			used += dir_record_size(strlen(block[i].item_name));
+		}
+		// with fixed size records, any empty record is space for new one
+		else if (!is_varlen) {
 			return true;
+		}
+	}
+	return (bool) (is_varlen && used <= sb.block_size);
+}
 
-		fs_read_directory_item(block, sb.count_dir_items, links[i]);
+/*
+ * Check if there is space in directory inode for subdirectory record with name in carry.
+ */
+ITERABLE(has_space_for_dir) {
+	size_t i;
+	bool ret = false;
+	struct directory_item* block = NULL;
+	struct carry_dir_item* carry = (struct carry_dir_item*) p_carry;
 
-		for (j = 0; j < sb.count_dir_items; ++j) {
-			// empty record found == space for new one
-			if (strcmp(block[j].item_name, "") == 0) {
-				return true;
-			}
+	for (i = 0; i < links_count && !ret; ++i) {
+		// empty link in inode == new link to empty block can be created
+		if (links[i] == FREE_LINK) {
+			ret = true;
+			break;
+		}
+		if (block == NULL && (block = alloc_dir_items()) == NULL) {
+			return false;
 		}
+
+		fs_read_directory_item(block, sb.count_dir_items, links[i]);
+		ret = has_space_for_record(block, carry->name);
 	}
-	return false;
+	free(block);
+	return ret;
 }
 
 /*
- * List all items in given blocks.
+ * Collect all items in given blocks to growing array in carry.
  */
-ITERABLE(list_items) {
+ITERABLE(collect_items) {
 	size_t i, j;
-	char unit[3] = {0};
-	float file_size = 0;
-	struct inode inode_ls = {0};
-	struct directory_item block[sb.count_dir_items];
+	struct directory_item* items_new = NULL;
+	struct directory_item* block = alloc_dir_items();
+	struct carry_items* carry = (struct carry_items*) p_carry;
+
+	if (block == NULL) {
+		return true;
+	}
 
 	for (i = 0; i < links_count; ++i) {
 		if (links[i] == FREE_LINK)
@@ -266,118 +320,342 @@ ITERABLE(list_items) {
 		fs_read_directory_item(block, sb.count_dir_items, links[i]);
 
 		for (j = 0; j < sb.count_dir_items; ++j) {
-			if (block[j].id_inode == FREE_LINK
-					|| strcmp(block[j].item_name, ".") == 0
-					|| strcmp(block[j].item_name, "..") == 0)
+			if (block[j].id_inode == FREE_LINK)
 				continue;
 
-			// read inodes in directory, so it is possible to print
-			// their size and if item is file or directory
-			fs_read_inode(&inode_ls, 1, block[j].id_inode);
-			file_size = human_readable(unit, inode_ls.file_size);
-
-			if (inode_ls.inode_type == Inode_type_file) {
-				printf("- %6.1f%s\t%s\n", file_size, unit, block[j].item_name);
-			}
-			else if (inode_ls.inode_type == Inode_type_dirc) {
-				printf("d %6.1f%s\t%s%s\n", file_size, unit, block[j].item_name, SEPARATOR);
+			// array is full, so make it twice bigger
+			if (carry->count == carry->capacity) {
+				carry->capacity = carry->capacity > 0 ? 2 * carry->capacity : sb.count_dir_items;
+				items_new = realloc(carry->items, carry->capacity * sizeof(struct directory_item));
+				if (items_new == NULL) {
+					set_myerrno(Err_malloc);
+					free(block);
+					return true;
+				}
+				carry->items = items_new;
 			}
+			memcpy(&carry->items[carry->count++], &block[j], sizeof(struct directory_item));
 		}
 	}
-	// always return false, so all links are iterated
+	free(block);
+	// return false, so all links are iterated
 	return false;
 }
 
 /*
- * In-copy inode data from system file.
+ * Collect all links to blocks in given order to growing array in carry.
  */
-ITERABLE(incp_data) {
-	bool ret = false;
-	size_t i, read;
-	char block[sb.block_size];
-	struct carry_stream* carry = (struct carry_stream*) p_carry;
+ITERABLE(collect_links) {
+	size_t i;
+	uint32_t* links_new = NULL;
+	struct carry_links* carry = (struct carry_links*) p_carry;
 
-	for (i = 0; i < links_count && !ret; ++i) {
+	for (i = 0; i < links_count; ++i) {
 		if (links[i] == FREE_LINK)
 			continue;
 
-		if (!feof(carry->file)) {
-			read = stream_incp(block, sb.block_size, carry->file);
-			// in case last block of data has smaller amount, fill rest with zeros
-			// and write, so there are no leftover data
-			if (read < sb.block_size) {
-				memset(block + read, '\0', sb.block_size - read);
-				ret = true;
+		// array is full, so make it twice bigger
+		if (carry->count == carry->capacity) {
+			carry->capacity = carry->capacity > 0 ? 2 * carry->capacity : sb.count_links;
+			links_new = realloc(carry->links, carry->capacity * sizeof(uint32_t));
+			if (links_new == NULL) {
+				set_myerrno(Err_malloc);
+				return true;
 			}
-			fs_write_data(block, sb.block_size, links[i]);
-		}
-		else {
-			// this else is probably redundant, since feof() is met,
-			// when fread() reads less than 'sb.block_size'
-			ret = true;
+			carry->links = links_new;
 		}
+		carry->links[carry->count++] = links[i];
 	}
-	return ret;
+	// return false, so all links are iterated
+	return false;
 }
 
 /*
- * In-copy data inplace, when there is access to data blocks directly via links.
+ * Check, if there are only zeros in given data block.
  */
-int incp_data_inplace(const uint32_t* links, const uint32_t links_count, FILE* file) {
-	size_t i;
-	size_t read = sb.block_size;
-	char block[sb.block_size];
+static bool is_block_zero(const char* block) {
+	return (bool) (block[0] == '\0' && memcmp(block, block + 1, sb.block_size - 1) == 0);
+}
 
-	for (i = 0; i < links_count; ++i) {
-		// because 'links_count' is calculated exactly according to
-		// size of given file, this should be always true
-		if (!feof(file)) {
-			read = stream_incp(block, sb.block_size, file);
-			fs_write_data(block, read, links[i]);
+/*
+ * Create blocks for run of file data at given logical block and write the data there.
+ * The run must be a hole in file. With deduplication, blocks identical to indexed ones
+ * are shared with them instead, in runs following in both file and filesystem,
+ * and the written blocks are indexed.
+ */
+static int write_data_run(struct inode* inode_target, const char* run,
+						  const uint32_t logical_block, const size_t count) {
+	size_t i, j, k, m;
+	bool is_dedup = (sb.features & FS_FEATURE_DEDUP) != 0;
+	uint32_t* links = NULL;
+	uint32_t* found = NULL;
+
+	// one array for both, there can be up to 'count_links' of blocks in run
+	if ((links = malloc(2 * (count + 1) * sizeof(uint32_t))) == NULL) {
+		set_myerrno(Err_malloc);
+		return RETURN_FAILURE;
+	}
+	found = links + count + 1;
+
+	// without dedup, blocks are neither looked up, nor indexed
+	for (i = 0; i < count; ++i) {
+		found[i] = is_dedup ? dedup_find_block(run + i * sb.block_size, FREE_LINK) : FREE_LINK;
+	}
+	for (i = 0; i < count; i = j) {
+		for (j = i + 1; found[i] != FREE_LINK && j < count && found[j] == found[j - 1] + 1; ++j)
+			;
+		if (found[i] == FREE_LINK)
+			continue;
+
+		// run is written as usual, when it can't be shared
+		if (share_blocks(found[i], j - i) == RETURN_FAILURE) {
+			memset(&found[i], FREE_LINK, (j - i) * sizeof(uint32_t));
+		}
+		else if (map_links_at(inode_target, logical_block + i, found[i], j - i) == RETURN_FAILURE) {
+			unshare_blocks(found[i], j - i, NULL);
+			memset(&found[i], FREE_LINK, (j - i) * sizeof(uint32_t));
+		}
+	}
+	reset_myerrno();
+
+	// rest of blocks is written between the shared ones
+	for (i = 0; i < count; i = j) {
+		for (j = i + 1; found[i] == FREE_LINK && j < count && found[j] == FREE_LINK; ++j)
+			;
+		if (found[i] != FREE_LINK)
+			continue;
+
+		if (create_links_at(links, logical_block + i, j - i, inode_target) == RETURN_FAILURE) {
+			free(links);
+			return RETURN_FAILURE;
+		}
+		// blocks following each other in filesystem are written at once
+		for (k = 0; k < j - i; k = m) {
+			for (m = k + 1; m < j - i && links[m] == links[m - 1] + 1; ++m)
+				;
+			fs_write_blocks(run + (i + k) * sb.block_size, m - k, links[k]);
 		}
+		for (k = 0; k < j - i && is_dedup; ++k) {
+			dedup_add_block(run + (i + k) * sb.block_size, links[k]);
+		}
+	}
+	free(links);
+	return RETURN_SUCCESS;
+}
+
+/*
+ * In-copy data of system file to file inode without blocks. Blocks with only zeros
+ * are not created, they are left as holes, other blocks are created in runs.
+ * Data are read until end of file or 'limit' bytes, their length is stored to 'size'.
+ */
+int incp_data_sparse(struct inode* inode_target, FILE* file, const uint64_t limit, uint64_t* size) {
+	size_t read = 0;
+	size_t to_read = 0;
+	size_t count = 0;			// count of blocks in run
+	uint32_t logical = 0;		// index of block in file
+	char* run = NULL;
+	char* block = NULL;
+
+	if ((run = malloc(sb.count_links * sb.block_size)) == NULL) {
+		set_myerrno(Err_malloc);
+		return RETURN_FAILURE;
 	}
 
-	// in case last block of data has smaller amount, fill rest with zeros
-	// and write, so there are no leftover data
-	// condition is not in loop, because it is sure, that it will be very last link,
-	// which will need this check... not like in 'incp_data', where is checked
-	// block of links, so 'i' is iterated further and index of last link could get lost
-	if (read < sb.block_size) {
+	*size = 0;
+	// blocks are read right behind the run, so they don't have to be copied there
+	while ((to_read = limit - *size < sb.block_size ? limit - *size : sb.block_size) > 0
+			&& (read = stream_incp((block = run + count * sb.block_size), to_read, file)) > 0) {
+		// length of streamed data is known only at their end
+		if ((*size += read) > sb.max_file_size) {
+			set_myerrno(Err_os_file_too_big);
+			goto fail;
+		}
+		// last block of data may be shorter, rest of it is filled with zeros
 		memset(block + read, '\0', sb.block_size - read);
-		fs_write_data(block, sb.block_size, links[i - 1]);
+
+		if (!is_block_zero(block)) {
+			count++;
+		}
+		// hole ends the run
+		else if (count > 0) {
+			if (write_data_run(inode_target, run, logical - count, count) == RETURN_FAILURE)
+				goto fail;
+			count = 0;
+		}
+		logical++;
+
+		if (count == sb.count_links) {
+			if (write_data_run(inode_target, run, logical - count, count) == RETURN_FAILURE)
+				goto fail;
+			count = 0;
+		}
 	}
+	if (count > 0 && write_data_run(inode_target, run, logical - count, count) == RETURN_FAILURE) {
+		goto fail;
+	}
+
+	free(run);
 	return RETURN_SUCCESS;
+
+fail:
+	free(run);
+	return RETURN_FAILURE;
 }
 
 /*
- * Out-copy inode data to system file.
+ * Update data of file inode from system file, so they are the same. Blocks of file
+ * are compared with the system file and only the different ones are written.
+ * Zero blocks become holes, missing blocks are created in runs and blocks behind
+ * end of the new data are released. Size of file is not changed.
+ * Returns count of written blocks, or 'RETURN_FAILURE'.
  */
-ITERABLE(outcp_data) {
-	bool ret = false;
-	size_t i;
-	size_t to_write = 0;
-	char block[sb.block_size];
-	struct carry_stream* carry = (struct carry_stream*) p_carry;
+int64_t sync_data_sparse(struct inode* inode_target, FILE* file) {
+	int64_t written = 0;
+	size_t read = 0;
+	size_t count = 0;			// count of blocks in run of new blocks
+	uint32_t logical = 0;		// index of block in file
+	uint32_t id_block = FREE_LINK;
+	uint32_t count_blocks = get_count_data_blocks(inode_target->file_size);
+	char* block = NULL;
+	char* run = NULL;
+	char* data = NULL;
+
+	// compressed data are written in place, so they are decompressed at first
+	if (expand_compressed_file(inode_target) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+	// block of file to compare is right behind the run
+	if ((run = malloc((sb.count_links + 1) * sb.block_size)) == NULL) {
+		set_myerrno(Err_malloc);
+		return RETURN_FAILURE;
+	}
+	block = run + sb.count_links * sb.block_size;
 
-	for (i = 0; i < links_count && carry->data_count > 0; ++i) {
-		if (links[i] == FREE_LINK)
-			continue;
+	// blocks are read right behind the run, so the new ones don't have to be copied there
+	while ((read = stream_incp((data = run + count * sb.block_size), sb.block_size, file)) > 0) {
+		// last block of data may be shorter, rest of it is filled with zeros
+		memset(data + read, '\0', sb.block_size - read);
+		id_block = logical < count_blocks ? bmap(inode_target, logical) : FREE_LINK;
 
-		// set amount of data necessary to write
-		if (carry->data_count > sb.block_size) {
-			to_write = sb.block_size;
-			carry->data_count -= sb.block_size;
+		// block is missing in file, it is created with run
+		if (id_block == FREE_LINK && !is_block_zero(data)) {
+			count++;
 		}
-		else {
-			to_write = carry->data_count;
-			carry->data_count = 0;
-			ret = true;
+		else if (count > 0) {
+			if (write_data_run(inode_target, run, logical - count, count) == RETURN_FAILURE)
+				goto fail;
+			written += count;
+			// block read behind the run is moved to its start
+			memmove(run, data, sb.block_size);
+			data = run;
+			count = 0;
 		}
 
-		fs_read_data(block, sb.block_size, links[i]);
-		stream_outcp(block, to_write, carry->file);
+		if (id_block != FREE_LINK) {
+			// zero block becomes hole
+			if (is_block_zero(data)) {
+				free_links_range(inode_target, logical, 1);
+			}
+			// only different block is written
+			else {
+				fs_read_data(block, sb.block_size, id_block);
+				if (memcmp(block, data, sb.block_size) != 0) {
+					// block shared with other file is copied at first
+					if (get_block_shares(id_block) > 0
+							&& create_links_at(&id_block, logical, 1, inode_target) == RETURN_FAILURE)
+						goto fail;
+					fs_write_data(data, sb.block_size, id_block);
+					written++;
+				}
+			}
+		}
+		logical++;
+
+		if (count == sb.count_links) {
+			if (write_data_run(inode_target, run, logical - count, count) == RETURN_FAILURE)
+				goto fail;
+			written += count;
+			count = 0;
+		}
 	}
-	return ret;
+	if (count > 0) {
+		if (write_data_run(inode_target, run, logical - count, count) == RETURN_FAILURE)
+			goto fail;
+		written += count;
+	}
+
+	// file was longer
+	if (count_blocks > logical) {
+		free_links_range(inode_target, logical, count_blocks - logical);
+	}
+
+	free(run);
+	return written;
+
+fail:
+	free(run);
+	return RETURN_FAILURE;
+}
+
+/*
+ * In-copy data inline to inode, when they are small enough to be stored in place of links.
+ */
+int incp_data_inline(struct inode* inode_target, FILE* file) {
+	size_t read = 0;
+	char data[INODE_INLINE_SIZE] = {0};
+
+	read = stream_incp(data, INODE_INLINE_SIZE, file);
+	return set_inline_data(inode_target, data, read);
+}
+
+/*
+ * Out-copy data of file inode to system file. Holes in file are not written,
+ * position in system file is moved over them instead, so the file is sparse too.
+ */
+int outcp_data_sparse(const struct inode* inode_source, FILE* file) {
+	size_t i, count_blocks = get_count_data_blocks(inode_source->file_size);
+	size_t to_write = 0;
+	uint32_t id_block = FREE_LINK;
+	char* block = NULL;
+
+	if (iscompressed(inode_source)) {
+		return outcp_data_compressed(inode_source, file);
+	}
+	if ((block = malloc(sb.block_size)) == NULL) {
+		set_myerrno(Err_malloc);
+		return RETURN_FAILURE;
+	}
+
+	for (i = 0; i < count_blocks; ++i) {
+		to_write = i + 1 < count_blocks ? sb.block_size
+										: inode_source->file_size - i * sb.block_size;
+
+		if ((id_block = bmap(inode_source, i)) == FREE_LINK) {
+			fseek(file, (long) to_write, SEEK_CUR);
+			continue;
+		}
+		fs_read_data(block, sb.block_size, id_block);
+		stream_outcp(block, to_write, file);
+	}
+	free(block);
+
+	// file ending with hole has to be extended to its size
+	if (count_blocks > 0 && id_block == FREE_LINK) {
+		fflush(file);
+		if (ftruncate(fileno(file), inode_source->file_size) != 0) {
+			set_myerrno(Err_os_open_file);
+			return RETURN_FAILURE;
+		}
+	}
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Out-copy inline data of inode to system file.
+ */
+int outcp_data_inline(const struct inode* inode_source, FILE* file) {
+	stream_outcp(inline_data(inode_source), inode_source->file_size, file);
+	return RETURN_SUCCESS;
 }
 
 /*
@@ -385,7 +663,12 @@ ITERABLE(outcp_data) {
  */
 ITERABLE(cat_data) {
 	size_t i;
-	char block[sb.block_size + 1];
+	char* block = NULL;
+
+	if ((block = malloc(sb.block_size + 1)) == NULL) {
+		set_myerrno(Err_malloc);
+		return true;
+	}
 	block[sb.block_size] = '\0';
 
 	for (i = 0; i < links_count; ++i) {
@@ -395,34 +678,83 @@ ITERABLE(cat_data) {
 		fs_read_data(block, sb.block_size, links[i]);
 		printf("%s", block);
 	}
+	free(block);
 	// always return false, so all links are iterated
 	return false;
 }
 
 /*
- * Copy data from one inode to another.
+ * Print inline data of inode.
  */
-ITERABLE(copy_data) {
-	bool ret = false;
-	size_t i;
-	char block[sb.block_size];
-	struct carry_copy* carry = (struct carry_copy*) p_carry;
+int cat_data_inline(const struct inode* inode_source) {
+	printf("%.*s", (int) inode_source->file_size, inline_data(inode_source));
+	return RETURN_SUCCESS;
+}
 
-	for (i = 0; i < links_count && carry->links_count > 0; ++i) {
-		if (links[i] == FREE_LINK)
-			continue;
+/*
+ * Print given range of file data. Only blocks in the range are read.
+ */
+int cat_data_range(const struct inode* inode_source, const uint64_t offset, const uint64_t length) {
+	size_t read = 0, chunk = 0;
+	uint64_t done = 0;
+	// compressed data are read by whole clusters, so each is decompressed once
+	size_t unit = iscompressed(inode_source) ? COMPRESS_CLUSTER * sb.block_size : sb.block_size;
+	char* block = NULL;
+
+	if ((block = malloc(unit)) == NULL) {
+		set_myerrno(Err_malloc);
+		return RETURN_FAILURE;
+	}
 
-		fs_read_data(block, sb.block_size, links[i]);
-		fs_write_data(block, sb.block_size, *(carry->dest_links));
-		// move pointer to another link
-		carry->dest_links++;
-		// decrement remaining links of data to copy
-		carry->links_count--;
+	// range is printed by units, so there is no need for buffer of its size
+	while (done < length) {
+		chunk = unit - (offset + done) % unit;
+		read = read_file_data(inode_source, block, offset + done,
+							  length - done < chunk ? length - done : chunk);
+		if (read == 0)
+			break;
+		stream_outcp(block, read, stdout);
+		done += read;
+	}
 
-		if (carry->links_count == 0)
-			ret = true;
+	free(block);
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Copy data of file inode to another file inode without blocks.
+ * Holes are kept, blocks of source are copied in runs.
+ */
+int copy_data_sparse(const struct inode* inode_source, struct inode* inode_target) {
+	size_t i, count = 0;
+	size_t count_blocks = get_count_data_blocks(inode_source->file_size);
+	uint32_t id_block = FREE_LINK;
+	char* run = NULL;
+
+	if ((run = malloc(sb.count_links * sb.block_size)) == NULL) {
+		set_myerrno(Err_malloc);
+		return RETURN_FAILURE;
 	}
-	return ret;
+
+	for (i = 0; i <= count_blocks; ++i) {
+		id_block = i < count_blocks ? bmap(inode_source, i) : FREE_LINK;
+		if (id_block != FREE_LINK) {
+			fs_read_data(run + count++ * sb.block_size, sb.block_size, id_block);
+		}
+
+		// run is ended with hole, end of file, or it is full
+		if ((id_block == FREE_LINK && count > 0) || count == sb.count_links) {
+			if (write_data_run(inode_target, run, i + (id_block != FREE_LINK) - count, count)
+					== RETURN_FAILURE) {
+				free(run);
+				return RETURN_FAILURE;
+			}
+			count = 0;
+		}
+	}
+
+	free(run);
+	return RETURN_SUCCESS;
 }
 
 /*
@@ -456,6 +788,11 @@ ITERABLE(filter_correct_ids) {
 				continue;
 			}
 
+			// hard linked inode is filtered out only once, but all its links are counted
+			if (carry->nlinks[block[j].id_inode - 1]++ > 0) {
+				continue;
+			}
+
 			// filter out inode which is not lost in filesystem
 			carry->inode_ids[block[j].id_inode - 1] = false;
 			carry->active--;
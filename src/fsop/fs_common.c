@@ -1,4 +1,5 @@
 #include <stdbool.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "fs_api.h"
@@ -23,11 +24,29 @@ int init_filesystem(const char* fsp, bool* is_formatted) {
 	if (access(fsp, F_OK) == 0) {
 		// filesystem is ready to be loaded
 		if ((filesystem = fopen(fsp, "rb+")) != NULL) {
+			file_close_all();
+			fs_reset_link_cache();
+			memset(&sb, 0, sizeof(struct superblock));
 			fs_read_superblock(&sb);				// cache super block
+
+			// signature is at start of superblock in every layout, so it is checked before
+			// the rest is trusted -- filesystem with 32b addresses has different layout
+			if (strncmp(sb.signature, FS_SIGNATURE, sizeof(sb.signature)) != 0
+					|| !(sb.features & FS_FEATURE_64BIT)) {
+				fclose(filesystem);
+				filesystem = NULL;
+				*is_formatted = false;
+				fprintf(stderr, "Filesystem [%s] has unsupported layout. "
+						"You can format it with command 'format <size>'.\n", fsp);
+
+				log_warning("Filesystem [%s] has unsupported layout.", fsp);
+				return RETURN_SUCCESS;
+			}
 			fs_read_inode(&inode_actual, 1, ROOT_ID);	// cache root inode
 
 			*is_formatted = true;
-			puts("Filesystem loaded successfully.");
+			// status of loading goes to stderr, so output of commands can be piped
+			fputs("Filesystem loaded successfully.\n", stderr);
 
 			log_info("Filesystem [%s] loaded.", fsp);
 			ret = RETURN_SUCCESS;
@@ -44,8 +63,8 @@ int init_filesystem(const char* fsp, bool* is_formatted) {
 	// else notify about possible formatting
 	else {
 		*is_formatted = false;
-		puts("No filesystem with this name found. "
-	   		"You can format one with command 'format <size>'.");
+		fputs("No filesystem with this name found. "
+			  "You can format one with command 'format <size>'.\n", stderr);
 
 		log_info("Filesystem [%s] not found.", fsp);
 		ret = RETURN_SUCCESS;
@@ -55,6 +74,8 @@ int init_filesystem(const char* fsp, bool* is_formatted) {
 
 void close_filesystem() {
 	if (filesystem != NULL) {
+		file_close_all();
+		fs_reset_link_cache();
 		fclose(filesystem);
 		log_info("Filesystem closed.");
 	}
@@ -64,7 +85,7 @@ void close_filesystem() {
  * Get count of data blocks in filesystem, which is needed,
  * in order to create new file inode.
  */
-uint32_t get_count_data_blocks(const off_t file_size) {
+uint32_t get_count_data_blocks(const uint64_t file_size) {
 	if (file_size % sb.block_size == 0)
 		return file_size / sb.block_size;
 	else
@@ -82,21 +103,37 @@ bool is_enough_space(const uint32_t count_blocks, const uint32_t count_empty_blo
 	uint32_t c_blocks = count_blocks;
 	size_t addition = 0;	// additional deep blocks for indirect links
 
+	// blocks with extents are needed only for fragmented files, their creation may fail later
+	if (sb.features & FS_FEATURE_EXTENTS) {
+		return (bool) (count_blocks <= count_empty_blocks);
+	}
+
 	for (i = 0; i < COUNT_DIRECT_LINKS && c_blocks > 0; ++i) {
 		c_blocks -= 1;
 	}
+	// count is cut at zero, with big blocks one block of links covers many data blocks
 	for (i = 0; i < COUNT_INDIRECT_LINKS_1 && c_blocks > 0; ++i) {
 		addition += 1;
-		c_blocks -= sb.count_links;
+		c_blocks -= c_blocks < sb.count_links ? c_blocks : sb.count_links;
 	}
 	for (i = 0; i < COUNT_INDIRECT_LINKS_2 && c_blocks > 0; ++i) {
 		addition += 1;
 
 		for (j = 0; j < sb.count_links && c_blocks > 0; ++j) {
 			addition += 1;
-			c_blocks -= sb.count_links;
+			c_blocks -= c_blocks < sb.count_links ? c_blocks : sb.count_links;
 		}
 	}
 
 	return (bool) (count_blocks + addition <= count_empty_blocks);
 }
+
+/*
+ * Get maximal length of item name, which depends on format of directory records.
+ */
+size_t get_max_name_length() {
+	if (sb.features & FS_FEATURE_DIR_VARLEN)
+		return STRLEN_ITEM_NAME - 1;
+	else
+		return STRLEN_RECORD_NAME - 1;
+}
@@ -0,0 +1,480 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "fs_api.h"
+#include "fs_cache.h"
+#include "inode.h"
+
+#include "errors.h"
+#include "logger.h"
+
+#define LZ_HASH_BITS		12		// size of table of last positions of 4 B sequences
+#define LZ_MIN_MATCH		4		// shortest match, which is encoded
+#define LZ_MAX_OFFSET		0xFFFF	// offset of match is stored in 2 B
+#define CLUSTER_HEADER		sizeof(uint32_t)	// length of compressed data in cluster
+
+// system io
+extern size_t stream_incp(char* buffer, const size_t count, FILE* stream);
+extern size_t stream_outcp(const char* buffer, const size_t count, FILE* stream);
+
+// how cluster of compressed file is stored
+enum cluster_type {
+	cluster_hole,		// all blocks are missing, cluster is zeros
+	cluster_raw,		// all blocks are present and not compressed
+	cluster_packed,		// compressed data in first blocks, last block is missing
+};
+
+
+// ---------- CODEC -----------------------------------------------------------
+
+/*
+ * Data are compressed to sequences of LZ4 like format: token with length of literals
+ * (high 4 bits) and length of match (low 4 bits, minus 'LZ_MIN_MATCH'), then
+ * literals, 2 B offset of match back in data (little endian). Length 15 is extended
+ * with following bytes, until byte is not 255. The last sequence has only literals.
+ */
+
+static uint32_t lz_hash(const unsigned char* p) {
+	uint32_t v = p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24;
+	return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/*
+ * Put extension of length, which did not fit to the token. Returns false, if output is full.
+ */
+static bool lz_put_length(unsigned char* dst, size_t* op, const size_t capacity, size_t length) {
+	for (; length >= 255; length -= 255) {
+		if (*op >= capacity)
+			return false;
+		dst[(*op)++] = 255;
+	}
+	if (*op >= capacity)
+		return false;
+	dst[(*op)++] = (unsigned char) length;
+	return true;
+}
+
+/*
+ * Put one sequence -- literals and match with given offset, match may be empty.
+ * Returns false, if output is full.
+ */
+static bool lz_put_sequence(unsigned char* dst, size_t* op, const size_t capacity,
+							const unsigned char* literals, const size_t count_literals,
+							const size_t offset, const size_t length_match) {
+	size_t token_op = (*op)++;
+	size_t match = length_match > 0 ? length_match - LZ_MIN_MATCH : 0;
+
+	if (token_op >= capacity)
+		return false;
+	dst[token_op] = (unsigned char) ((count_literals < 15 ? count_literals : 15) << 4
+									 | (match < 15 ? match : 15));
+
+	if (count_literals >= 15 && !lz_put_length(dst, op, capacity, count_literals - 15))
+		return false;
+	if (*op + count_literals > capacity)
+		return false;
+	memcpy(dst + *op, literals, count_literals);
+	*op += count_literals;
+
+	// the last sequence has no match
+	if (length_match == 0)
+		return true;
+
+	if (*op + 2 > capacity)
+		return false;
+	dst[(*op)++] = offset & 0xFF;
+	dst[(*op)++] = offset >> 8;
+	return match < 15 || lz_put_length(dst, op, capacity, match - 15);
+}
+
+/*
+ * Compress data to given buffer of given capacity.
+ * Returns length of compressed data, or 0, if they don't fit to the buffer.
+ */
+static size_t lz_compress(const char* source, const size_t length, char* target, const size_t capacity) {
+	size_t ip = 0, anchor = 0, op = 0;
+	size_t ref = 0, length_match = 0;
+	uint32_t h = 0;
+	const unsigned char* src = (const unsigned char*) source;
+	unsigned char* dst = (unsigned char*) target;
+	uint32_t table[1 << LZ_HASH_BITS] = {0};
+
+	while (ip + LZ_MIN_MATCH <= length) {
+		h = lz_hash(src + ip);
+		ref = table[h];
+		table[h] = ip;
+
+		if (ref >= ip || ip - ref > LZ_MAX_OFFSET || memcmp(src + ref, src + ip, LZ_MIN_MATCH) != 0) {
+			ip++;
+			continue;
+		}
+		for (length_match = LZ_MIN_MATCH;
+			 ip + length_match < length && src[ref + length_match] == src[ip + length_match];
+			 ++length_match)
+			;
+
+		if (!lz_put_sequence(dst, &op, capacity, src + anchor, ip - anchor, ip - ref, length_match))
+			return 0;
+		ip += length_match;
+		anchor = ip;
+	}
+
+	if (!lz_put_sequence(dst, &op, capacity, src + anchor, length - anchor, 0, 0))
+		return 0;
+	return op;
+}
+
+/*
+ * Read extension of length from compressed data. Returns false, if data end.
+ */
+static bool lz_get_length(const unsigned char* src, size_t* ip, const size_t length, size_t* value) {
+	unsigned char byte;
+
+	do {
+		if (*ip >= length)
+			return false;
+		byte = src[(*ip)++];
+		*value += byte;
+	} while (byte == 255);
+	return true;
+}
+
+/*
+ * Decompress data to buffer of exactly 'length_target' bytes.
+ * Returns false, if the data are corrupted.
+ */
+static bool lz_decompress(const char* source, const size_t length, char* target, const size_t length_target) {
+	size_t ip = 0, op = 0;
+	size_t count_literals = 0, length_match = 0, offset = 0;
+	unsigned char token;
+	const unsigned char* src = (const unsigned char*) source;
+	unsigned char* dst = (unsigned char*) target;
+
+	while (ip < length) {
+		token = src[ip++];
+
+		count_literals = token >> 4;
+		if (count_literals == 15 && !lz_get_length(src, &ip, length, &count_literals))
+			return false;
+		if (ip + count_literals > length || op + count_literals > length_target)
+			return false;
+		memcpy(dst + op, src + ip, count_literals);
+		ip += count_literals;
+		op += count_literals;
+
+		// the last sequence has only literals
+		if (ip == length)
+			break;
+
+		if (ip + 2 > length)
+			return false;
+		offset = src[ip] | src[ip + 1] << 8;
+		ip += 2;
+		length_match = token & 0x0F;
+		if (length_match == 15 && !lz_get_length(src, &ip, length, &length_match))
+			return false;
+		length_match += LZ_MIN_MATCH;
+		if (offset == 0 || offset > op || op + length_match > length_target)
+			return false;
+
+		// match can overlap with itself, so it is copied by bytes
+		for (; length_match > 0; --length_match, ++op) {
+			dst[op] = dst[op - offset];
+		}
+	}
+	return op == length_target;
+}
+
+// ---------- CLUSTERS --------------------------------------------------------
+
+/*
+ * Get count of blocks in cluster starting at given logical block,
+ * the last cluster of file may be shorter.
+ */
+static uint32_t cluster_length(const struct inode* inode_source, const uint32_t first) {
+	uint32_t count_blocks = get_count_data_blocks(inode_source->file_size);
+	return count_blocks - first < COMPRESS_CLUSTER ? count_blocks - first : COMPRESS_CLUSTER;
+}
+
+/*
+ * Read cluster of compressed file starting at given logical block to buffer
+ * for whole cluster. 'packed' is buffer of the same size for compressed data.
+ * Returns how the cluster is stored, or 'RETURN_FAILURE', if its data are corrupted.
+ */
+static int read_cluster_(const struct inode* inode_source, const uint32_t first,
+						 char* cluster, char* packed) {
+	size_t i;
+	uint32_t length = cluster_length(inode_source, first);
+	uint32_t length_packed = 0;
+	uint32_t id_block = FREE_LINK;
+
+	if (bmap(inode_source, first) == FREE_LINK) {
+		memset(cluster, '\0', length * sb.block_size);
+		return cluster_hole;
+	}
+
+	// cluster is compressed, when its last block is missing
+	if (length == 1 || bmap(inode_source, first + length - 1) != FREE_LINK) {
+		for (i = 0; i < length; ++i) {
+			if ((id_block = bmap(inode_source, first + i)) == FREE_LINK)
+				memset(cluster + i * sb.block_size, '\0', sb.block_size);
+			else
+				fs_read_data(cluster + i * sb.block_size, sb.block_size, id_block);
+		}
+		return cluster_raw;
+	}
+
+	for (i = 0; i < length - 1 && (id_block = bmap(inode_source, first + i)) != FREE_LINK; ++i) {
+		fs_read_data(packed + i * sb.block_size, sb.block_size, id_block);
+	}
+	memcpy(&length_packed, packed, CLUSTER_HEADER);
+	if (length_packed > i * sb.block_size - CLUSTER_HEADER
+			|| !lz_decompress(packed + CLUSTER_HEADER, length_packed, cluster, length * sb.block_size)) {
+		set_myerrno(Err_data_corrupted);
+		log_warning("Corrupted compressed data of inode [%d], block [%d].",
+					inode_source->id_inode, first);
+		return RETURN_FAILURE;
+	}
+	return cluster_packed;
+}
+
+/*
+ * Allocate buffers for decompressed and compressed cluster.
+ */
+static int alloc_cluster_buffers(char** cluster, char** packed) {
+	*cluster = malloc(COMPRESS_CLUSTER * sb.block_size);
+	*packed = malloc(COMPRESS_CLUSTER * sb.block_size);
+	if (*cluster == NULL || *packed == NULL) {
+		free(*cluster);
+		free(*packed);
+		set_myerrno(Err_malloc);
+		return RETURN_FAILURE;
+	}
+	return RETURN_SUCCESS;
+}
+
+// ---------- COMPRESSED FILE -------------------------------------------------
+
+/*
+ * In-copy data of system file to file inode without blocks, compressed by clusters
+ * of 'COMPRESS_CLUSTER' blocks. Cluster is stored in as few blocks as its compressed
+ * data need with their length in front of them, the rest of cluster is left as hole.
+ * Cluster, which doesn't get smaller, is stored as it is, cluster of zeros is hole.
+ * Data are read until end of file or 'limit' bytes, their length is stored to 'size'.
+ */
+int incp_data_compressed(struct inode* inode_target, FILE* file, const uint64_t limit, uint64_t* size) {
+	size_t i, read = 0;
+	size_t to_read = 0;
+	uint32_t length = 0;		// count of blocks in cluster
+	uint32_t count = 0;			// count of blocks to store
+	uint32_t length_packed = 0;
+	uint32_t logical = 0;		// index of first block of cluster in file
+	uint32_t links[COMPRESS_CLUSTER];
+	char* cluster = NULL;
+	char* packed = NULL;
+	char* data = NULL;
+
+	if (alloc_cluster_buffers(&cluster, &packed) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+
+	*size = 0;
+	while ((to_read = limit - *size < COMPRESS_CLUSTER * sb.block_size
+					  ? limit - *size : COMPRESS_CLUSTER * sb.block_size) > 0
+			&& (read = stream_incp(cluster, to_read, file)) > 0) {
+		// length of streamed data is known only at their end
+		if ((*size += read) > sb.max_file_size) {
+			set_myerrno(Err_os_file_too_big);
+			goto fail;
+		}
+		length = get_count_data_blocks(read);
+		// last cluster of data may be shorter, rest of its last block is filled with zeros
+		memset(cluster + read, '\0', length * sb.block_size - read);
+
+		data = cluster;
+		count = length;
+		// cluster of zeros is hole
+		if (cluster[0] == '\0' && memcmp(cluster, cluster + 1, length * sb.block_size - 1) == 0) {
+			logical += length;
+			continue;
+		}
+		// cluster is packed only, when it saves some block
+		if (length > 1 && (length_packed = lz_compress(cluster, length * sb.block_size,
+				packed + CLUSTER_HEADER, (length - 1) * sb.block_size - CLUSTER_HEADER)) > 0) {
+			memcpy(packed, &length_packed, CLUSTER_HEADER);
+			count = get_count_data_blocks(CLUSTER_HEADER + length_packed);
+			memset(packed + CLUSTER_HEADER + length_packed, '\0',
+				   count * sb.block_size - CLUSTER_HEADER - length_packed);
+			data = packed;
+		}
+
+		if (create_links_at(links, logical, count, inode_target) == RETURN_FAILURE) {
+			goto fail;
+		}
+		for (i = 0; i < count; ++i) {
+			fs_write_data(data + i * sb.block_size, sb.block_size, links[i]);
+		}
+		logical += length;
+	}
+
+	inode_target->flags |= INODE_FLAG_COMPRESSED;
+	fs_write_inode(inode_target, 1, inode_target->id_inode);
+
+	free(cluster);
+	free(packed);
+	return RETURN_SUCCESS;
+
+fail:
+	free(cluster);
+	free(packed);
+	return RETURN_FAILURE;
+}
+
+/*
+ * Read 'length' bytes of compressed file data from 'offset' to given buffer.
+ * Only clusters in the range are read and decompressed. Range is cut at end of file.
+ * Returns count of read bytes.
+ */
+size_t read_compressed_data(const struct inode* inode_source, char* buffer,
+							const uint64_t offset, const size_t length) {
+	size_t done = 0, chunk = 0, to_read = length;
+	uint64_t position = 0;
+	size_t in_cluster = 0;
+	size_t size_cluster = COMPRESS_CLUSTER * sb.block_size;
+	char* cluster = NULL;
+	char* packed = NULL;
+
+	if (offset >= inode_source->file_size) {
+		return 0;
+	}
+	if (to_read > inode_source->file_size - offset) {
+		to_read = inode_source->file_size - offset;
+	}
+	if (alloc_cluster_buffers(&cluster, &packed) == RETURN_FAILURE) {
+		return 0;
+	}
+
+	while (done < to_read) {
+		position = offset + done;
+		in_cluster = position % size_cluster;
+		chunk = size_cluster - in_cluster;
+		if (chunk > to_read - done)
+			chunk = to_read - done;
+
+		if (read_cluster_(inode_source, position / size_cluster * COMPRESS_CLUSTER, cluster, packed)
+				== RETURN_FAILURE) {
+			break;
+		}
+		memcpy(buffer + done, cluster + in_cluster, chunk);
+		done += chunk;
+	}
+
+	free(cluster);
+	free(packed);
+	return done;
+}
+
+/*
+ * Out-copy data of compressed file inode to system file. Clusters are decompressed,
+ * holes are not written, position in system file is moved over them instead.
+ */
+int outcp_data_compressed(const struct inode* inode_source, FILE* file) {
+	int type = cluster_hole;
+	uint32_t first = 0, count_blocks = get_count_data_blocks(inode_source->file_size);
+	size_t to_write = 0;
+	char* cluster = NULL;
+	char* packed = NULL;
+
+	if (alloc_cluster_buffers(&cluster, &packed) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+
+	for (first = 0; first < count_blocks; first += COMPRESS_CLUSTER) {
+		to_write = first + COMPRESS_CLUSTER < count_blocks
+				   ? COMPRESS_CLUSTER * sb.block_size
+				   : inode_source->file_size - first * sb.block_size;
+
+		if ((type = read_cluster_(inode_source, first, cluster, packed)) == RETURN_FAILURE) {
+			goto fail;
+		}
+		if (type == cluster_hole) {
+			fseek(file, (long) to_write, SEEK_CUR);
+			continue;
+		}
+		stream_outcp(cluster, to_write, file);
+	}
+
+	// file ending with hole has to be extended to its size
+	if (count_blocks > 0 && type == cluster_hole) {
+		fflush(file);
+		if (ftruncate(fileno(file), inode_source->file_size) != 0) {
+			set_myerrno(Err_os_open_file);
+			goto fail;
+		}
+	}
+
+	free(cluster);
+	free(packed);
+	return RETURN_SUCCESS;
+
+fail:
+	free(cluster);
+	free(packed);
+	return RETURN_FAILURE;
+}
+
+/*
+ * Decompress all clusters of compressed file to its blocks, so the file can be
+ * written in place. Blocks of packed cluster are kept (copied at first, if shared)
+ * and missing ones are created. If there are not enough blocks, already expanded
+ * clusters stay stored as they are, so the file is still readable.
+ */
+int expand_compressed_file(struct inode* inode_target) {
+	size_t i;
+	int type = cluster_hole;
+	uint32_t first = 0, length = 0;
+	uint32_t count_blocks = get_count_data_blocks(inode_target->file_size);
+	uint32_t links[COMPRESS_CLUSTER];
+	char* cluster = NULL;
+	char* packed = NULL;
+
+	if (!iscompressed(inode_target)) {
+		return RETURN_SUCCESS;
+	}
+	if (alloc_cluster_buffers(&cluster, &packed) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+
+	for (first = 0; first < count_blocks; first += COMPRESS_CLUSTER) {
+		if ((type = read_cluster_(inode_target, first, cluster, packed)) == RETURN_FAILURE) {
+			goto fail;
+		}
+		if (type != cluster_packed)
+			continue;
+
+		length = cluster_length(inode_target, first);
+		if (create_links_at(links, first, length, inode_target) == RETURN_FAILURE) {
+			goto fail;
+		}
+		for (i = 0; i < length; ++i) {
+			fs_write_data(cluster + i * sb.block_size, sb.block_size, links[i]);
+		}
+	}
+
+	inode_target->flags &= ~INODE_FLAG_COMPRESSED;
+	fs_write_inode(inode_target, 1, inode_target->id_inode);
+
+	free(cluster);
+	free(packed);
+	return RETURN_SUCCESS;
+
+fail:
+	free(cluster);
+	free(packed);
+	return RETURN_FAILURE;
+}
@@ -0,0 +1,247 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "fs_api.h"
+#include "fs_cache.h"
+#include "inode.h"
+
+#include "errors.h"
+#include "logger.h"
+
+
+// shared blocks are counted with reference counts, so deduplication needs them
+#define isdedup()	((sb.features & FS_FEATURE_DEDUP) && (sb.features & FS_FEATURE_REFLINK))
+
+static const struct dedup_entry entry_free = {0, FREE_LINK};
+
+
+/*
+ * FNV-1a hash of data block. Hash is never zero.
+ */
+static uint32_t hash_block(const char* block) {
+	size_t i;
+	uint32_t hash = 2166136261u;
+
+	for (i = 0; i < sb.block_size; ++i) {
+		hash ^= (unsigned char) block[i];
+		hash *= 16777619u;
+	}
+	return hash != 0 ? hash : 1;
+}
+
+/*
+ * Get first slot in index of data blocks, where block with given hash can be.
+ * Index has 'DEDUP_PROBES' more slots than blocks, so slots don't have to wrap around.
+ */
+static uint32_t hash_slot(const uint32_t hash) {
+	return hash % sb.block_count;
+}
+
+/*
+ * Find data block with the same data as given block in index of data blocks.
+ * Block with id 'id_exclude' is skipped. Data of found block are compared,
+ * because indexed block could be written since.
+ * Returns id of the block, or 'FREE_LINK'.
+ */
+uint32_t dedup_find_block(const char* block, const uint32_t id_exclude) {
+	size_t i;
+	uint32_t hash = 0;
+	struct dedup_entry entries[DEDUP_PROBES];
+	char data[sb.block_size];
+
+	if (!isdedup()) {
+		return FREE_LINK;
+	}
+
+	hash = hash_block(block);
+	fs_read_dedup_entry(entries, DEDUP_PROBES, hash_slot(hash));
+	for (i = 0; i < DEDUP_PROBES; ++i) {
+		if (entries[i].id == FREE_LINK || entries[i].id == id_exclude || entries[i].hash != hash)
+			continue;
+
+		fs_read_data(data, sb.block_size, entries[i].id);
+		if (memcmp(data, block, sb.block_size) == 0)
+			return entries[i].id;
+	}
+	return FREE_LINK;
+}
+
+/*
+ * Put data block with given id and data to index of data blocks. When all slots
+ * for its hash are used, block in the first one is dropped from index.
+ */
+void dedup_add_block(const char* block, const uint32_t id) {
+	size_t i;
+	uint32_t hash = 0, slot = 0;
+	struct dedup_entry entries[DEDUP_PROBES];
+
+	if (!isdedup()) {
+		return;
+	}
+	hash = hash_block(block);
+
+	// block could be indexed already, or with its former data
+	fs_read_dedup_slot(&slot, 1, id);
+	if (slot != 0) {
+		fs_read_dedup_entry(entries, 1, slot - 1);
+		if (entries[0].id == id && entries[0].hash == hash)
+			return;
+		dedup_remove_blocks(id, 1);
+	}
+
+	slot = hash_slot(hash);
+	fs_read_dedup_entry(entries, DEDUP_PROBES, slot);
+	for (i = 0; i < DEDUP_PROBES && entries[i].id != FREE_LINK; ++i)
+		;
+	if (i == DEDUP_PROBES) {
+		i = 0;
+		dedup_remove_blocks(entries[i].id, 1);
+	}
+
+	entries[i].hash = hash;
+	entries[i].id = id;
+	fs_write_dedup_entry(&entries[i], 1, slot + i);
+	// slots are stored +1, so zero means block is not indexed
+	slot += i + 1;
+	fs_write_dedup_slot(&slot, 1, id);
+}
+
+/*
+ * Drop 'length' data blocks starting at given id from index of data blocks,
+ * e.g. when they are released.
+ */
+void dedup_remove_blocks(const uint32_t id, const uint32_t length) {
+	size_t i, j, count;
+	bool is_changed = false;
+	uint32_t slots[sb.count_links];
+
+	if (!isdedup()) {
+		return;
+	}
+
+	// blocks are dropped by parts, so the array of their slots can be small
+	for (i = 0; i < length; i += count) {
+		count = length - i < sb.count_links ? length - i : sb.count_links;
+		is_changed = false;
+
+		fs_read_dedup_slot(slots, count, id + i);
+		for (j = 0; j < count; ++j) {
+			if (slots[j] == 0)
+				continue;
+			fs_write_dedup_entry(&entry_free, 1, slots[j] - 1);
+			slots[j] = 0;
+			is_changed = true;
+		}
+		if (is_changed) {
+			fs_write_dedup_slot(slots, count, id + i);
+		}
+	}
+}
+
+/*
+ * Drop reference of file to data block, block is released, if no other file uses it.
+ * Returns count of released blocks.
+ */
+static int64_t release_block_(const uint32_t id_block) {
+	char block[sb.block_size];
+
+	if (unshare_blocks(id_block, 1, NULL) > 0) {
+		return 0;
+	}
+	memset(block, '\0', sb.block_size);
+	fs_write_data(block, sb.block_size, id_block);
+	free_bitmap_field_data(id_block);
+	return 1;
+}
+
+/*
+ * Map run of file (logical blocks) to identical run of indexed blocks starting at 'start'
+ * and drop the blocks of file, which were there. Blocks are shared at first,
+ * so blocks of the file can be found in the run too.
+ * Returns count of released blocks, or 'RETURN_FAILURE'.
+ */
+static int64_t map_found_run_(struct inode* inode_target, const uint32_t logical_block,
+							  const uint32_t start, const uint32_t* links_old, const uint32_t length) {
+	size_t i;
+	int64_t released = 0;
+
+	// block can't be shared more, so the run is just kept
+	if (share_blocks(start, length) == RETURN_FAILURE) {
+		reset_myerrno();
+		return 0;
+	}
+	if (map_links_at(inode_target, logical_block, start, length) == RETURN_FAILURE) {
+		unshare_blocks(start, length, NULL);
+		return RETURN_FAILURE;
+	}
+	for (i = 0; i < length; ++i) {
+		released += release_block_(links_old[i]);
+	}
+	return released;
+}
+
+/*
+ * Share data blocks of file with identical indexed blocks, blocks which are not found
+ * are indexed, so other files can share them. Runs of blocks found one after another
+ * are mapped at once. Returns count of released blocks, or 'RETURN_FAILURE'.
+ */
+int64_t dedup_file(struct inode* inode_target) {
+	int64_t released = 0, ret = 0;
+	uint32_t i, count_blocks = 0;
+	uint32_t id_block = FREE_LINK;
+	uint32_t id_found = FREE_LINK;
+	uint32_t run_logical = 0;			// first block of run in file
+	uint32_t run_start = FREE_LINK;		// first found block of run
+	uint32_t run_length = 0;
+	uint32_t run_old[sb.count_links];	// blocks of file in the run
+	char block[sb.block_size];
+
+	if (!isdedup()) {
+		set_myerrno(Err_fs_no_feature);
+		return RETURN_FAILURE;
+	}
+	if (inode_target->inode_type != Inode_type_file || isinline(inode_target)) {
+		return 0;
+	}
+
+	count_blocks = get_count_data_blocks(inode_target->file_size);
+	for (i = 0; i <= count_blocks; ++i) {
+		id_found = FREE_LINK;
+		if (i < count_blocks && (id_block = bmap(inode_target, i)) != FREE_LINK) {
+			fs_read_data(block, sb.block_size, id_block);
+			id_found = dedup_find_block(block, id_block);
+		}
+
+		// found block continues the run
+		if (id_found != FREE_LINK && run_length > 0 && run_length < sb.count_links
+				&& i == run_logical + run_length && id_found == run_start + run_length) {
+			run_old[run_length++] = id_block;
+			continue;
+		}
+
+		if (run_length > 0) {
+			if ((ret = map_found_run_(inode_target, run_logical, run_start, run_old, run_length))
+					== RETURN_FAILURE) {
+				return RETURN_FAILURE;
+			}
+			released += ret;
+			run_length = 0;
+			// found block could be released with the run
+			if (ret > 0 && id_found != FREE_LINK) {
+				id_found = dedup_find_block(block, id_block);
+			}
+		}
+
+		if (id_found != FREE_LINK) {
+			run_logical = i;
+			run_start = id_found;
+			run_old[run_length++] = id_block;
+		}
+		else if (i < count_blocks && id_block != FREE_LINK) {
+			dedup_add_block(block, id_block);
+		}
+	}
+	return released;
+}
@@ -0,0 +1,691 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "fs_api.h"
+#include "fs_cache.h"
+#include "inode.h"
+
+#include "errors.h"
+#include "logger.h"
+
+
+#define count_block_extents()	((sb.count_links - EXTENT_BLOCK_HEADER) * sizeof(uint32_t) \
+								 / sizeof(struct extent))
+
+// all extents of inode in memory, with blocks where the overflowing extents are stored
+struct extent_list {
+	struct extent* extents;
+	size_t count;
+	size_t capacity;
+	uint32_t* blocks;
+	size_t count_blocks;
+};
+
+
+// ---------- EXTENT LIST -----------------------------------------------------
+
+static int append_extent(struct extent_list* list, const struct extent* extent) {
+	struct extent* extents_new = NULL;
+
+	// array is full, so make it twice bigger
+	if (list->count == list->capacity) {
+		list->capacity = list->capacity > 0 ? 2 * list->capacity : count_block_extents();
+		extents_new = realloc(list->extents, list->capacity * sizeof(struct extent));
+		if (extents_new == NULL) {
+			set_myerrno(Err_malloc);
+			return RETURN_FAILURE;
+		}
+		list->extents = extents_new;
+	}
+	memcpy(&list->extents[list->count++], extent, sizeof(struct extent));
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Insert extent to given position in list, so extents stay sorted by logical block.
+ */
+static int insert_extent(struct extent_list* list, const size_t index, const struct extent* extent) {
+	if (append_extent(list, extent) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+	memmove(&list->extents[index + 1], &list->extents[index],
+			(list->count - 1 - index) * sizeof(struct extent));
+	memcpy(&list->extents[index], extent, sizeof(struct extent));
+	return RETURN_SUCCESS;
+}
+
+static int append_extent_block(struct extent_list* list, const uint32_t id_block) {
+	uint32_t* blocks_new = realloc(list->blocks, (list->count_blocks + 1) * sizeof(uint32_t));
+	if (blocks_new == NULL) {
+		set_myerrno(Err_malloc);
+		return RETURN_FAILURE;
+	}
+	list->blocks = blocks_new;
+	list->blocks[list->count_blocks++] = id_block;
+	return RETURN_SUCCESS;
+}
+
+static void free_extent_list(struct extent_list* list) {
+	if (list->extents)
+		free(list->extents);
+	if (list->blocks)
+		free(list->blocks);
+}
+
+/*
+ * Read all extents of inode -- from inode itself and from chain of blocks with extents.
+ */
+static int load_extents(const struct inode* inode_source, struct extent_list* list) {
+	size_t i, count;
+	uint32_t id_block = extent_block(inode_source);
+	uint32_t block[sb.count_links];
+	struct extent extent;
+
+	for (i = 0; i < COUNT_INODE_EXTENTS && inode_extents(inode_source)[i].length > 0; ++i) {
+		if (append_extent(list, &inode_extents(inode_source)[i]) == RETURN_FAILURE) {
+			return RETURN_FAILURE;
+		}
+	}
+
+	// count of blocks is limited, so broken chain can't cycle forever
+	while (id_block != FREE_LINK && list->count_blocks < sb.block_count) {
+		if (append_extent_block(list, id_block) == RETURN_FAILURE) {
+			return RETURN_FAILURE;
+		}
+		fs_read_link(block, sb.count_links, id_block);
+
+		count = block[1] < count_block_extents() ? block[1] : count_block_extents();
+		for (i = 0; i < count; ++i) {
+			memcpy(&extent, (char*) &block[EXTENT_BLOCK_HEADER] + i * sizeof(struct extent),
+				   sizeof(struct extent));
+			if (append_extent(list, &extent) == RETURN_FAILURE) {
+				return RETURN_FAILURE;
+			}
+		}
+		id_block = block[0];
+	}
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Write extents to inode and to chain of blocks with extents, which don't fit to inode.
+ * Blocks of the chain are reused, missing ones are allocated and redundant ones are released.
+ * Nothing is written, if there are not enough blocks for the chain.
+ */
+static int store_extents(struct inode* inode_target, struct extent_list* list) {
+	size_t i, count;
+	size_t count_blocks = 0;
+	size_t count_loaded = list->count_blocks;
+	uint32_t block[sb.count_links];
+	uint32_t id_block = FREE_LINK;
+
+	if (list->count > COUNT_INODE_EXTENTS) {
+		count_blocks = (list->count - COUNT_INODE_EXTENTS + count_block_extents() - 1)
+					   / count_block_extents();
+	}
+
+	// allocate missing blocks of the chain at first, so it is possible to go back
+	for (i = list->count_blocks; i < count_blocks; ++i) {
+		if ((id_block = allocate_bitmap_field_data()) == FREE_LINK
+				|| append_extent_block(list, id_block) == RETURN_FAILURE) {
+			if (id_block != FREE_LINK)
+				free_bitmap_field_data(id_block);
+			while (list->count_blocks > count_loaded) {
+				free_bitmap_field_data(list->blocks[--list->count_blocks]);
+			}
+			return RETURN_FAILURE;
+		}
+	}
+
+	// write blocks of the chain
+	for (i = 0; i < count_blocks; ++i) {
+		count = list->count - COUNT_INODE_EXTENTS - i * count_block_extents();
+		if (count > count_block_extents())
+			count = count_block_extents();
+
+		memset(block, FREE_LINK, sizeof(block));
+		block[0] = i + 1 < count_blocks ? list->blocks[i + 1] : FREE_LINK;
+		block[1] = count;
+		memcpy(&block[EXTENT_BLOCK_HEADER],
+			   &list->extents[COUNT_INODE_EXTENTS + i * count_block_extents()],
+			   count * sizeof(struct extent));
+		fs_write_link(block, sb.count_links, list->blocks[i]);
+	}
+	// release redundant blocks of the chain, released blocks are always zeroed
+	memset(block, FREE_LINK, sizeof(block));
+	for (i = count_blocks; i < list->count_blocks; ++i) {
+		fs_write_link(block, sb.count_links, list->blocks[i]);
+		free_bitmap_field_data(list->blocks[i]);
+	}
+	list->count_blocks = count_blocks;
+
+	// write extents to inode
+	memset(inline_data(inode_target), FREE_LINK, INODE_INLINE_SIZE);
+	for (i = 0; i < COUNT_INODE_EXTENTS && i < list->count; ++i) {
+		memcpy(&inode_extents(inode_target)[i], &list->extents[i], sizeof(struct extent));
+	}
+	extent_block(inode_target) = count_blocks > 0 ? list->blocks[0] : FREE_LINK;
+	fs_write_inode(inode_target, 1, inode_target->id_inode);
+
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Clear run of data blocks and release it in bitmap.
+ * Blocks shared with other file only lose one reference and are kept.
+ */
+static void free_run(const uint32_t start, const uint32_t length) {
+	size_t i, j, count;
+	bool is_shared[sb.count_links];
+	char block[sb.block_size];
+
+	memset(block, '\0', sb.block_size);
+	// run is released by parts, so the array of shared blocks can be small
+	for (i = 0; i < length; i += count) {
+		count = length - i < sb.count_links ? length - i : sb.count_links;
+
+		if (unshare_blocks(start + i, count, is_shared) == 0) {
+			for (j = 0; j < count; ++j) {
+				fs_write_data(block, sb.block_size, start + i + j);
+			}
+			free_bitmap_range_data(start + i, count);
+			continue;
+		}
+		for (j = 0; j < count; ++j) {
+			if (is_shared[j])
+				continue;
+			fs_write_data(block, sb.block_size, start + i + j);
+			free_bitmap_field_data(start + i + j);
+		}
+	}
+}
+
+/*
+ * Split extents of list by given range of file (logical blocks). Extents and their parts
+ * out of the range are appended to 'list_out', parts in the range to 'list_in'.
+ */
+static int cut_extents(const struct extent_list* list, const uint32_t logical_block, const size_t length,
+					   struct extent_list* list_out, struct extent_list* list_in) {
+	size_t i;
+	uint64_t end = (uint64_t) logical_block + length;
+	uint64_t cut_start = 0, cut_end = 0;
+	struct extent extent = {0};
+
+	for (i = 0; i < list->count; ++i) {
+		memcpy(&extent, &list->extents[i], sizeof(struct extent));
+		cut_start = extent.logical > logical_block ? extent.logical : logical_block;
+		cut_end = (uint64_t) extent.logical + extent.length < end
+				  ? (uint64_t) extent.logical + extent.length : end;
+
+		// extent is out of range
+		if (cut_start >= cut_end) {
+			if (append_extent(list_out, &extent) == RETURN_FAILURE)
+				return RETURN_FAILURE;
+			continue;
+		}
+		// part before the range
+		if (cut_start > extent.logical) {
+			extent.length = cut_start - extent.logical;
+			if (append_extent(list_out, &extent) == RETURN_FAILURE)
+				return RETURN_FAILURE;
+		}
+		// part after the range
+		if (cut_end < (uint64_t) list->extents[i].logical + list->extents[i].length) {
+			extent.logical = cut_end;
+			extent.start = list->extents[i].start + (cut_end - list->extents[i].logical);
+			extent.length = list->extents[i].logical + list->extents[i].length - cut_end;
+			if (append_extent(list_out, &extent) == RETURN_FAILURE)
+				return RETURN_FAILURE;
+		}
+		// the range itself
+		extent.logical = cut_start;
+		extent.start = list->extents[i].start + (cut_start - list->extents[i].logical);
+		extent.length = cut_end - cut_start;
+		if (append_extent(list_in, &extent) == RETURN_FAILURE)
+			return RETURN_FAILURE;
+	}
+	return RETURN_SUCCESS;
+}
+
+// ---------- EXTENT ITERATE --------------------------------------------------
+
+/*
+ * Equivalent of 'iterate_links()' for inode mapped by extents. Runs of blocks
+ * are expanded to blocks of links, so callbacks don't have to know about extents.
+ */
+int iterate_extents(const struct inode* inode_source, void* carry, bool (*callback)()) {
+	bool ret_call = false;
+	size_t i, j, links_count = 0;
+	uint32_t links[sb.count_links];
+	struct extent_list list = {0};
+
+	if (load_extents(inode_source, &list) == RETURN_FAILURE) {
+		free_extent_list(&list);
+		return RETURN_FAILURE;
+	}
+
+	for (i = 0; i < list.count && !ret_call; ++i) {
+		for (j = 0; j < list.extents[i].length && !ret_call; ++j) {
+			links[links_count++] = list.extents[i].start + j;
+
+			// block of links is full, pass it to callback
+			if (links_count == sb.count_links) {
+				ret_call = callback(links, links_count, carry);
+				links_count = 0;
+			}
+		}
+	}
+	if (!ret_call && links_count > 0) {
+		ret_call = callback(links, links_count, carry);
+	}
+
+	free_extent_list(&list);
+	return ret_call ? RETURN_SUCCESS : RETURN_FAILURE;
+}
+
+/*
+ * Get id of data block with given index in file (logical block). Extents in inode
+ * are checked at first, then blocks with extents are read only until the block is found.
+ * Returns id of the block, or 'FREE_LINK', if the file has no such block.
+ */
+uint32_t bmap_extents(const struct inode* inode_source, const uint32_t logical_block) {
+	size_t i, count, count_blocks = 0;
+	uint32_t id_block = extent_block(inode_source);
+	uint32_t block[sb.count_links];
+	struct extent extent;
+
+	for (i = 0; i < COUNT_INODE_EXTENTS; ++i) {
+		memcpy(&extent, &inode_extents(inode_source)[i], sizeof(struct extent));
+		if (extent.logical <= logical_block && logical_block - extent.logical < extent.length) {
+			return extent.start + (logical_block - extent.logical);
+		}
+	}
+
+	while (id_block != FREE_LINK && count_blocks++ < sb.block_count) {
+		fs_read_link(block, sb.count_links, id_block);
+
+		count = block[1] < count_block_extents() ? block[1] : count_block_extents();
+		for (i = 0; i < count; ++i) {
+			memcpy(&extent, (char*) &block[EXTENT_BLOCK_HEADER] + i * sizeof(struct extent),
+				   sizeof(struct extent));
+			if (extent.logical <= logical_block && logical_block - extent.logical < extent.length) {
+				return extent.start + (logical_block - extent.logical);
+			}
+		}
+		id_block = block[0];
+	}
+	return FREE_LINK;
+}
+
+/*
+ * Get copy of all extents of inode. Returned array must be freed.
+ */
+struct extent* get_extents(const struct inode* inode_source, size_t* count) {
+	struct extent_list list = {0};
+
+	if (load_extents(inode_source, &list) == RETURN_FAILURE) {
+		free_extent_list(&list);
+		*count = 0;
+		return NULL;
+	}
+	if (list.blocks)
+		free(list.blocks);
+	*count = list.count;
+	return list.extents;
+}
+
+// ---------- EXTENT FREE -----------------------------------------------------
+
+/*
+ * Collect ids of all blocks of extent inode to carry -- data blocks and blocks with extents.
+ */
+int collect_extent_blocks(const struct inode* inode_source, struct carry_links* carry) {
+	int ret = RETURN_FAILURE;
+	struct extent_list list = {0};
+
+	if (load_extents(inode_source, &list) == RETURN_FAILURE) {
+		goto end;
+	}
+	// iteration returns failure, when all blocks are passed to callback
+	if (iterate_extents(inode_source, carry, collect_links) != RETURN_FAILURE
+			|| collect_links(list.blocks, list.count_blocks, carry)) {
+		goto end; // error during mallocation
+	}
+	ret = RETURN_SUCCESS;
+
+end:
+	free_extent_list(&list);
+	return ret;
+}
+
+/*
+ * Free all extents from given inode, including blocks with extents.
+ */
+int free_all_extents(struct inode* inode_source) {
+	size_t i;
+	struct extent_list list = {0};
+
+	if (load_extents(inode_source, &list) == RETURN_FAILURE) {
+		free_extent_list(&list);
+		return RETURN_FAILURE;
+	}
+
+	for (i = 0; i < list.count; ++i) {
+		free_run(list.extents[i].start, list.extents[i].length);
+	}
+	for (i = 0; i < list.count_blocks; ++i) {
+		free_run(list.blocks[i], 1);
+	}
+
+	// make extents free in the inode itself
+	memset(inline_data(inode_source), FREE_LINK, INODE_INLINE_SIZE);
+
+	free_extent_list(&list);
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Free given amount of data blocks from end of given inode.
+ */
+int free_amount_of_extents(struct inode* inode_target, const size_t to_free) {
+	int ret = RETURN_FAILURE;
+	size_t freed = 0;
+	uint32_t length = 0;
+	struct extent* last = NULL;
+	struct extent_list list = {0};
+
+	if (load_extents(inode_target, &list) == RETURN_FAILURE) {
+		goto end;
+	}
+
+	while (freed < to_free && list.count > 0) {
+		last = &list.extents[list.count - 1];
+		length = to_free - freed < last->length ? to_free - freed : last->length;
+
+		free_run(last->start + last->length - length, length);
+		last->length -= length;
+		freed += length;
+		if (last->length == 0) {
+			list.count--;
+		}
+	}
+	// only released blocks of chain could be needed
+	ret = store_extents(inode_target, &list);
+
+end:
+	free_extent_list(&list);
+	return ret;
+}
+
+/*
+ * Release data blocks in given range of file (logical blocks), so there is a hole.
+ * Extents are cut, or split in two, when the range is inside of them.
+ */
+int free_extents_range(struct inode* inode_target, const uint32_t logical_block, const size_t to_free) {
+	int ret = RETURN_FAILURE;
+	size_t i;
+	struct extent_list list = {0};
+	struct extent_list list_new = {0};
+	struct extent_list list_freed = {0};
+
+	if (load_extents(inode_target, &list) == RETURN_FAILURE
+			|| cut_extents(&list, logical_block, to_free, &list_new, &list_freed) == RETURN_FAILURE) {
+		goto end;
+	}
+
+	// chain of blocks is reused, so extents are stored before the blocks are released
+	list_new.blocks = list.blocks;
+	list_new.count_blocks = list.count_blocks;
+	list.blocks = NULL;
+	if ((ret = store_extents(inode_target, &list_new)) == RETURN_FAILURE) {
+		goto end;
+	}
+	for (i = 0; i < list_freed.count; ++i) {
+		free_run(list_freed.extents[i].start, list_freed.extents[i].length);
+	}
+
+end:
+	free_extent_list(&list);
+	free_extent_list(&list_new);
+	free_extent_list(&list_freed);
+	return ret;
+}
+
+// ---------- EXTENT CREATE ---------------------------------------------------
+
+/*
+ * Append 'count' of empty data blocks to end of given inode. Blocks are allocated
+ * in as long runs as possible and the last extent is extended, when it is possible.
+ * Ids of created blocks are put into given buffer.
+ * If not all blocks are created, inode is untouched and created blocks are released.
+ */
+int create_empty_extents(uint32_t* buffer, const size_t to_create, struct inode* inode_source) {
+	size_t i, created = 0;
+	uint32_t goal = FREE_LINK;
+	uint32_t start = FREE_LINK;
+	uint32_t length = 0;
+	struct extent extent = {0};
+	struct extent* last = NULL;
+	struct extent_list list = {0};
+
+	if (load_extents(inode_source, &list) == RETURN_FAILURE) {
+		goto fail;
+	}
+
+	while (created < to_create) {
+		last = list.count > 0 ? &list.extents[list.count - 1] : NULL;
+		goal = last != NULL ? last->start + last->length : FREE_LINK;
+
+		if ((start = allocate_bitmap_range_data(goal, to_create - created, &length)) == FREE_LINK) {
+			goto fail;
+		}
+		for (i = 0; i < length; ++i) {
+			buffer[created++] = start + i;
+		}
+
+		// new run continues the last one
+		if (last != NULL && start == goal) {
+			last->length += length;
+		} else {
+			extent.logical = last != NULL ? last->logical + last->length : 0;
+			extent.start = start;
+			extent.length = length;
+			if (append_extent(&list, &extent) == RETURN_FAILURE) {
+				goto fail;
+			}
+		}
+	}
+
+	if (store_extents(inode_source, &list) == RETURN_FAILURE) {
+		goto fail;
+	}
+
+	free_extent_list(&list);
+	return RETURN_SUCCESS;
+
+fail:
+	// release blocks created so far, they were not written, so they are still zeroed
+	for (i = 0; i < created; ++i) {
+		free_bitmap_field_data(buffer[i]);
+		buffer[i] = FREE_LINK;
+	}
+	free_extent_list(&list);
+	set_myerrno(Err_inode_no_links);
+	return RETURN_FAILURE;
+}
+
+/*
+ * Create data blocks in given range of file (logical blocks). Blocks already
+ * in the range are kept, holes in it are filled with runs placed right after
+ * the preceding block, when possible. Ids of blocks in the range are put into given buffer.
+ * If not all blocks are created, inode is untouched and created blocks are released.
+ */
+int create_extents_at(uint32_t* buffer, const uint32_t logical_block, const size_t to_create,
+					  struct inode* inode_source) {
+	size_t i, j, done = 0;
+	uint32_t position = 0;
+	uint32_t wanted = 0;
+	uint32_t goal = FREE_LINK;
+	uint32_t start = FREE_LINK;
+	uint32_t length = 0;
+	struct extent extent = {0};
+	struct extent* prev = NULL;
+	struct extent_list list = {0};
+	struct extent_list list_created = {0};
+
+	if (load_extents(inode_source, &list) == RETURN_FAILURE) {
+		goto fail;
+	}
+
+	while (done < to_create) {
+		position = logical_block + done;
+
+		// first extent, which doesn't end before the position
+		for (i = 0; i < list.count && list.extents[i].logical + list.extents[i].length <= position; ++i)
+			;
+
+		// position is mapped, take the whole part of extent in range
+		if (i < list.count && list.extents[i].logical <= position) {
+			for (j = position - list.extents[i].logical;
+					j < list.extents[i].length && done < to_create; ++j) {
+				buffer[done++] = list.extents[i].start + j;
+			}
+			continue;
+		}
+
+		// position is in hole, which ends with next extent or with the range
+		wanted = to_create - done;
+		if (i < list.count && list.extents[i].logical - position < wanted) {
+			wanted = list.extents[i].logical - position;
+		}
+		prev = i > 0 && list.extents[i - 1].logical + list.extents[i - 1].length == position
+			   ? &list.extents[i - 1] : NULL;
+		goal = prev != NULL ? prev->start + prev->length : FREE_LINK;
+
+		if ((start = allocate_bitmap_range_data(goal, wanted, &length)) == FREE_LINK) {
+			goto fail;
+		}
+		extent.logical = position;
+		extent.start = start;
+		extent.length = length;
+		if (append_extent(&list_created, &extent) == RETURN_FAILURE) {
+			free_bitmap_range_data(start, length);
+			goto fail;
+		}
+		for (j = 0; j < length; ++j) {
+			buffer[done++] = start + j;
+		}
+
+		// new run continues the previous extent, else it is inserted before the next one
+		if (prev != NULL && start == goal) {
+			prev->length += length;
+		}
+		else if (insert_extent(&list, i, &extent) == RETURN_FAILURE) {
+			goto fail;
+		}
+	}
+
+	if (store_extents(inode_source, &list) == RETURN_FAILURE) {
+		goto fail;
+	}
+
+	free_extent_list(&list);
+	free_extent_list(&list_created);
+	return RETURN_SUCCESS;
+
+fail:
+	// release runs created so far, they were not written, so they are still zeroed
+	for (i = 0; i < list_created.count; ++i) {
+		free_bitmap_range_data(list_created.extents[i].start, list_created.extents[i].length);
+	}
+	for (i = 0; i < to_create; ++i) {
+		buffer[i] = FREE_LINK;
+	}
+	free_extent_list(&list);
+	free_extent_list(&list_created);
+	set_myerrno(Err_inode_no_links);
+	return RETURN_FAILURE;
+}
+
+// ---------- EXTENT SHARE ----------------------------------------------------
+
+/*
+ * Map given range of file (logical blocks) to run of data blocks starting at 'start'.
+ * Blocks mapped in the range before are only unmapped, they are not released.
+ */
+int remap_extents(struct inode* inode_target, const uint32_t logical_block, const uint32_t start,
+				  const uint32_t length) {
+	int ret = RETURN_FAILURE;
+	size_t i;
+	struct extent extent = {logical_block, start, length};
+	struct extent_list list = {0};
+	struct extent_list list_new = {0};
+	struct extent_list list_cut = {0};
+
+	if (load_extents(inode_target, &list) == RETURN_FAILURE
+			|| cut_extents(&list, logical_block, length, &list_new, &list_cut) == RETURN_FAILURE) {
+		goto end;
+	}
+	for (i = 0; i < list_new.count && list_new.extents[i].logical < logical_block; ++i)
+		;
+	if (insert_extent(&list_new, i, &extent) == RETURN_FAILURE) {
+		goto end;
+	}
+
+	// chain of blocks is reused
+	list_new.blocks = list.blocks;
+	list_new.count_blocks = list.count_blocks;
+	list.blocks = NULL;
+	ret = store_extents(inode_target, &list_new);
+
+end:
+	free_extent_list(&list);
+	free_extent_list(&list_new);
+	free_extent_list(&list_cut);
+	return ret;
+}
+
+/*
+ * Map data blocks of file 'inode_target' to the same runs as of 'inode_source',
+ * so they share the data. Target gets its own blocks with extents.
+ * Blocks preallocated behind end of source are not shared, they are not data.
+ * Target must be mapped by extents and have no data blocks yet.
+ */
+int share_extents(const struct inode* inode_source, struct inode* inode_target) {
+	size_t i;
+	struct extent_list list = {0};
+	struct extent_list list_in = {0};	// runs in file
+	struct extent_list list_out = {0};	// runs behind end of file
+
+	if (load_extents(inode_source, &list) == RETURN_FAILURE
+			|| cut_extents(&list, 0, get_count_data_blocks(inode_source->file_size),
+						   &list_out, &list_in) == RETURN_FAILURE) {
+		goto fail;
+	}
+	for (i = 0; i < list_in.count; ++i) {
+		if (share_blocks(list_in.extents[i].start, list_in.extents[i].length) == RETURN_FAILURE)
+			goto fail_shared;
+	}
+
+	// chain of blocks with extents stays with the source, target gets its own
+	if (store_extents(inode_target, &list_in) == RETURN_FAILURE) {
+		goto fail_shared;
+	}
+
+	free_extent_list(&list);
+	free_extent_list(&list_in);
+	free_extent_list(&list_out);
+	return RETURN_SUCCESS;
+
+fail_shared:
+	while (i-- > 0) {
+		unshare_blocks(list_in.extents[i].start, list_in.extents[i].length, NULL);
+	}
+fail:
+	free_extent_list(&list);
+	free_extent_list(&list_in);
+	free_extent_list(&list_out);
+	return RETURN_FAILURE;
+}
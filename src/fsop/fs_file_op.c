@@ -0,0 +1,588 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "fs_api.h"
+#include "fs_cache.h"
+#include "inode.h"
+
+#include "errors.h"
+#include "logger.h"
+
+#define FILE_HANDLES_MAX	16		// maximal count of files open at once
+
+// open file with cached inode and ids of its data blocks by index in file
+struct file_handle {
+	bool is_open;
+	uint64_t position;
+	struct inode inode;
+	uint32_t* blocks;
+	size_t count_blocks;
+};
+
+static struct file_handle handles[FILE_HANDLES_MAX];
+
+
+// ---------- FILE READ -------------------------------------------------------
+
+/*
+ * Read 'length' bytes of file data from 'offset' to given buffer. Only blocks
+ * in the range are read, they are found with 'bmap()'. Range is cut at end of file
+ * and blocks missing in file are read as zeros.
+ * Returns count of read bytes.
+ */
+size_t read_file_data(const struct inode* inode_source, char* buffer,
+					  const uint64_t offset, const size_t length) {
+	size_t done = 0, chunk = 0, to_read = length;
+	uint64_t position = 0;
+	size_t in_block = 0;
+	uint32_t id_block = FREE_LINK;
+	char block[sb.block_size];
+
+	if (offset >= inode_source->file_size) {
+		return 0;
+	}
+	if (to_read > inode_source->file_size - offset) {
+		to_read = inode_source->file_size - offset;
+	}
+
+	// inline data are stored in inode itself
+	if (isinline(inode_source)) {
+		memcpy(buffer, inline_data(inode_source) + offset, to_read);
+		return to_read;
+	}
+	// compressed data are read by clusters
+	if (iscompressed(inode_source)) {
+		return read_compressed_data(inode_source, buffer, offset, to_read);
+	}
+
+	while (done < to_read) {
+		position = offset + done;
+		in_block = position % sb.block_size;
+		chunk = sb.block_size - in_block;
+		if (chunk > to_read - done)
+			chunk = to_read - done;
+
+		id_block = bmap(inode_source, position / sb.block_size);
+		if (id_block == FREE_LINK) {
+			memset(buffer + done, '\0', chunk);
+		}
+		// whole block is read directly to buffer
+		else if (chunk == sb.block_size) {
+			fs_read_data(buffer + done, sb.block_size, id_block);
+		}
+		else {
+			fs_read_data(block, sb.block_size, id_block);
+			memcpy(buffer + done, block + in_block, chunk);
+		}
+		done += chunk;
+	}
+	return done;
+}
+
+// ---------- FILE WRITE ------------------------------------------------------
+
+/*
+ * Write 'length' bytes from given buffer to file data at 'offset'. Only blocks
+ * in the range are touched -- missing ones are created, whole blocks are overwritten
+ * and only the first and the last partial block are read at first.
+ * File grows, when data are written behind its end, the gap is left as hole.
+ * Returns count of written bytes, or 'RETURN_FAILURE'.
+ */
+int64_t write_file_data(struct inode* inode_target, const char* buffer,
+						const uint64_t offset, const size_t length) {
+	size_t i, done = 0, chunk = 0;
+	uint64_t position = 0;
+	size_t in_block = 0;
+	size_t first = 0, count = 0;
+	uint64_t end = offset + length;
+	uint32_t links[sb.count_links];
+	char block[sb.block_size];
+
+	if (length == 0) {
+		return 0;
+	}
+	if (end > sb.max_file_size) {
+		set_myerrno(Err_os_file_too_big);
+		return RETURN_FAILURE;
+	}
+
+	// empty file starts inline, if data fit there and it has no preallocated blocks
+	if (inode_target->file_size == 0 && !isinline(inode_target) && !isprealloc(inode_target)
+			&& fits_inline(end)) {
+		set_inline_data(inode_target, inline_data(inode_target), 0);
+	}
+	// data still fit inline
+	if (isinline(inode_target) && fits_inline(end)) {
+		memcpy(inline_data(inode_target) + offset, buffer, length);
+		if (end > inode_target->file_size)
+			inode_target->file_size = end;
+		fs_write_inode(inode_target, 1, inode_target->id_inode);
+		return (int64_t) length;
+	}
+	if (isinline(inode_target) && expand_inline_file(inode_target) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+	// compressed data are written in place, so they are decompressed at first
+	if (expand_compressed_file(inode_target) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+
+	// blocks are created by blocks of links, so the array of ids has limited size
+	while (done < length) {
+		first = (offset + done) / sb.block_size;
+		count = get_count_data_blocks(end) - first;
+		if (count > sb.count_links)
+			count = sb.count_links;
+		if (create_links_at(links, first, count, inode_target) == RETURN_FAILURE) {
+			return RETURN_FAILURE;
+		}
+
+		for (i = 0; i < count; ++i) {
+			position = offset + done;
+			in_block = position % sb.block_size;
+			chunk = sb.block_size - in_block;
+			if (chunk > length - done)
+				chunk = length - done;
+
+			// whole block is rewritten, else the rest of block is kept
+			if (chunk == sb.block_size) {
+				fs_write_data(buffer + done, sb.block_size, links[i]);
+			} else {
+				fs_read_data(block, sb.block_size, links[i]);
+				memcpy(block + in_block, buffer + done, chunk);
+				fs_write_data(block, sb.block_size, links[i]);
+			}
+			done += chunk;
+		}
+	}
+
+	if (end > inode_target->file_size) {
+		update_size(inode_target, end);
+	}
+	return (int64_t) done;
+}
+
+/*
+ * Allocate data blocks for first 'size' bytes of file, so they can be written later
+ * without allocation. Holes get runs of blocks as contiguous as possible. Size of file
+ * is kept, blocks behind its end are unwritten -- inode is marked, so they are released
+ * with truncation of file. Unwritten blocks read as zeros.
+ */
+int preallocate_file(struct inode* inode_target, const uint64_t size) {
+	bool was_prealloc = isprealloc(inode_target);
+	uint32_t count_blocks = get_count_data_blocks(size);
+	uint32_t count_file = 0;
+	uint32_t count_mapped = 0;
+
+	if (size > sb.max_file_size) {
+		set_myerrno(Err_os_file_too_big);
+		return RETURN_FAILURE;
+	}
+	// inline data have their space in inode already
+	if (isinline(inode_target) && fits_inline(size)) {
+		return RETURN_SUCCESS;
+	}
+	if (isinline(inode_target) && expand_inline_file(inode_target) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+	// compressed data are written in place, so they are decompressed at first
+	if (expand_compressed_file(inode_target) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+
+	count_file = get_count_data_blocks(inode_target->file_size);
+	if (count_blocks > count_file) {
+		inode_target->flags |= INODE_FLAG_PREALLOC;
+	}
+	if (preallocate_links(inode_target, 0, count_blocks) == RETURN_FAILURE) {
+		// blocks behind end of file are released again, holes filled in file are kept
+		if (!was_prealloc && (count_mapped = get_count_mapped_blocks(inode_target)) > count_file) {
+			free_links_range(inode_target, count_file, count_mapped - count_file);
+		}
+		if (!was_prealloc) {
+			inode_target->flags &= ~INODE_FLAG_PREALLOC;
+		}
+		fs_write_inode(inode_target, 1, inode_target->id_inode);
+		return RETURN_FAILURE;
+	}
+	fs_write_inode(inode_target, 1, inode_target->id_inode);
+	return RETURN_SUCCESS;
+}
+
+// ---------- FILE HANDLE -----------------------------------------------------
+
+/*
+ * Load ids of all data blocks of file in handle. Blocks missing in file are 'FREE_LINK'.
+ */
+static int load_block_map(struct file_handle* handle) {
+	size_t i;
+	uint32_t* blocks_new = NULL;
+
+	handle->count_blocks = isinline(&handle->inode) ? 0
+						   : get_count_data_blocks(handle->inode.file_size);
+
+	// +1, so even for file without blocks is something allocated
+	blocks_new = realloc(handle->blocks, (handle->count_blocks + 1) * sizeof(uint32_t));
+	if (blocks_new == NULL) {
+		set_myerrno(Err_malloc);
+		return RETURN_FAILURE;
+	}
+	handle->blocks = blocks_new;
+
+	for (i = 0; i < handle->count_blocks; ++i) {
+		handle->blocks[i] = bmap(&handle->inode, i);
+	}
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Get open handle with given descriptor. Inode of the file is read again
+ * and cached block map is reloaded only if the inode was changed meanwhile,
+ * e.g. by other handle or command.
+ */
+static struct file_handle* get_handle(const int fd) {
+	struct inode inode_check = {0};
+	struct file_handle* handle = NULL;
+
+	if (fd < 0 || fd >= FILE_HANDLES_MAX || !handles[fd].is_open) {
+		set_myerrno(Err_fd_invalid);
+		return NULL;
+	}
+	handle = &handles[fd];
+
+	fs_read_inode(&inode_check, 1, handle->inode.id_inode);
+	if (inode_check.inode_type != Inode_type_file) {
+		// file was removed
+		file_close(fd);
+		set_myerrno(Err_item_not_exists);
+		return NULL;
+	}
+	if (memcmp(&inode_check, &handle->inode, sizeof(struct inode)) != 0) {
+		memcpy(&handle->inode, &inode_check, sizeof(struct inode));
+		if (load_block_map(handle) == RETURN_FAILURE) {
+			return NULL;
+		}
+	}
+	return handle;
+}
+
+/*
+ * Update block map of handle after data were written to given range of file (logical blocks).
+ */
+static int update_block_map(struct file_handle* handle, const bool was_inline,
+							const size_t first, const size_t count) {
+	size_t i;
+	uint32_t* blocks_new = NULL;
+
+	// inline data were moved to block, or compressed data were expanded, so the map is new
+	if (was_inline || isinline(&handle->inode)) {
+		return load_block_map(handle);
+	}
+
+	if (first + count > handle->count_blocks) {
+		blocks_new = realloc(handle->blocks, (first + count) * sizeof(uint32_t));
+		if (blocks_new == NULL) {
+			set_myerrno(Err_malloc);
+			return RETURN_FAILURE;
+		}
+		handle->blocks = blocks_new;
+		for (i = handle->count_blocks; i < first; ++i) {
+			handle->blocks[i] = FREE_LINK;
+		}
+		handle->count_blocks = first + count;
+	}
+	for (i = first; i < first + count; ++i) {
+		handle->blocks[i] = bmap(&handle->inode, i);
+	}
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Open file with given path. File must exist.
+ * Returns descriptor of handle, or 'RETURN_FAILURE'.
+ */
+int file_open(const char* path) {
+	int fd;
+	struct file_handle* handle = NULL;
+
+	for (fd = 0; fd < FILE_HANDLES_MAX && handles[fd].is_open; ++fd)
+		;
+	if (fd == FILE_HANDLES_MAX) {
+		set_myerrno(Err_fd_limit);
+		return RETURN_FAILURE;
+	}
+	handle = &handles[fd];
+
+	if (get_inode(&handle->inode, path) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+	if (handle->inode.inode_type != Inode_type_file) {
+		set_myerrno(Err_item_not_file);
+		return RETURN_FAILURE;
+	}
+	if (load_block_map(handle) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+
+	handle->position = 0;
+	handle->is_open = true;
+	log_info("File [%s] opened, fd: [%d].", path, fd);
+	return fd;
+}
+
+/*
+ * Close handle with given descriptor.
+ */
+int file_close(const int fd) {
+	if (fd < 0 || fd >= FILE_HANDLES_MAX || !handles[fd].is_open) {
+		set_myerrno(Err_fd_invalid);
+		return RETURN_FAILURE;
+	}
+	if (handles[fd].blocks) {
+		free(handles[fd].blocks);
+		handles[fd].blocks = NULL;
+	}
+	handles[fd].count_blocks = 0;
+	handles[fd].is_open = false;
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Close all handles, e.g. when other filesystem is loaded or formatted.
+ */
+void file_close_all() {
+	for (int fd = 0; fd < FILE_HANDLES_MAX; ++fd) {
+		if (handles[fd].is_open) {
+			file_close(fd);
+		}
+	}
+}
+
+/*
+ * Close all handles of given inode, e.g. when the inode is released,
+ * so they don't access other file, which gets the same inode later.
+ */
+void file_close_inode(const uint32_t id_inode) {
+	for (int fd = 0; fd < FILE_HANDLES_MAX; ++fd) {
+		if (handles[fd].is_open && handles[fd].inode.id_inode == id_inode) {
+			file_close(fd);
+		}
+	}
+}
+
+/*
+ * Reload block maps of all open handles, e.g. when data blocks of files were moved
+ * without changing their inodes.
+ */
+void file_reload_all() {
+	for (int fd = 0; fd < FILE_HANDLES_MAX; ++fd) {
+		if (handles[fd].is_open) {
+			fs_read_inode(&handles[fd].inode, 1, handles[fd].inode.id_inode);
+			load_block_map(&handles[fd]);
+		}
+	}
+}
+
+/*
+ * Read data of file from given offset. Position of handle is not changed.
+ * Returns count of read bytes, or 'RETURN_FAILURE'.
+ */
+int64_t file_pread(const int fd, char* buffer, const size_t length, const uint64_t offset) {
+	size_t done = 0, chunk = 0, to_read = length;
+	uint64_t position = 0;
+	size_t in_block = 0;
+	char block[sb.block_size];
+	struct file_handle* handle = get_handle(fd);
+
+	if (handle == NULL) {
+		return RETURN_FAILURE;
+	}
+	if (offset >= handle->inode.file_size) {
+		return 0;
+	}
+	if (to_read > handle->inode.file_size - offset) {
+		to_read = handle->inode.file_size - offset;
+	}
+	if (isinline(&handle->inode)) {
+		memcpy(buffer, inline_data(&handle->inode) + offset, to_read);
+		return (int64_t) to_read;
+	}
+	if (iscompressed(&handle->inode)) {
+		return (int64_t) read_compressed_data(&handle->inode, buffer, offset, to_read);
+	}
+
+	// the same as 'read_file_data()', but with cached block map
+	while (done < to_read) {
+		position = offset + done;
+		in_block = position % sb.block_size;
+		chunk = sb.block_size - in_block;
+		if (chunk > to_read - done)
+			chunk = to_read - done;
+
+		if (handle->blocks[position / sb.block_size] == FREE_LINK) {
+			memset(buffer + done, '\0', chunk);
+		}
+		else if (chunk == sb.block_size) {
+			fs_read_data(buffer + done, sb.block_size, handle->blocks[position / sb.block_size]);
+		}
+		else {
+			fs_read_data(block, sb.block_size, handle->blocks[position / sb.block_size]);
+			memcpy(buffer + done, block + in_block, chunk);
+		}
+		done += chunk;
+	}
+	return (int64_t) done;
+}
+
+/*
+ * Write data to file from given offset. File grows, when data are written behind its end.
+ * Position of handle is not changed.
+ * Returns count of written bytes, or 'RETURN_FAILURE'.
+ */
+int64_t file_pwrite(const int fd, const char* buffer, const size_t length, const uint64_t offset) {
+	bool was_inline = false;
+	int64_t written = 0;
+	struct file_handle* handle = get_handle(fd);
+
+	if (handle == NULL) {
+		return RETURN_FAILURE;
+	}
+	was_inline = isinline(&handle->inode) || iscompressed(&handle->inode);
+
+	if ((written = write_file_data(&handle->inode, buffer, offset, length)) <= 0) {
+		return written;
+	}
+	if (update_block_map(handle, was_inline, offset / sb.block_size,
+						 get_count_data_blocks(offset + length) - offset / sb.block_size)
+			== RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+	return written;
+}
+
+/*
+ * Read data of file from position of handle and move the position.
+ */
+int64_t file_read(const int fd, char* buffer, const size_t length) {
+	int64_t read = file_pread(fd, buffer, length, fd >= 0 && fd < FILE_HANDLES_MAX
+												  ? handles[fd].position : 0);
+	if (read > 0) {
+		handles[fd].position += read;
+	}
+	return read;
+}
+
+/*
+ * Write data to file at position of handle and move the position.
+ */
+int64_t file_write(const int fd, const char* buffer, const size_t length) {
+	int64_t written = file_pwrite(fd, buffer, length, fd >= 0 && fd < FILE_HANDLES_MAX
+													  ? handles[fd].position : 0);
+	if (written > 0) {
+		handles[fd].position += written;
+	}
+	return written;
+}
+
+/*
+ * Set position of handle relatively to start (SEEK_SET), actual position (SEEK_CUR)
+ * or end of file (SEEK_END). Position may be behind end of file.
+ * Returns new position, or 'RETURN_FAILURE'.
+ */
+int64_t file_seek(const int fd, const int64_t offset, const int whence) {
+	int64_t position = 0;
+	struct file_handle* handle = get_handle(fd);
+
+	if (handle == NULL) {
+		return RETURN_FAILURE;
+	}
+	switch (whence) {
+		case SEEK_SET:	position = offset;								break;
+		case SEEK_CUR:	position = handle->position + offset;			break;
+		case SEEK_END:	position = handle->inode.file_size + offset;	break;
+		default:		position = -1;
+	}
+	if (position < 0 || position > sb.max_file_size) {
+		set_myerrno(Err_dir_arg_invalid);
+		return RETURN_FAILURE;
+	}
+
+	handle->position = (uint64_t) position;
+	return position;
+}
+
+/*
+ * Change size of file. Data behind new size are released, or file is extended with hole.
+ */
+int file_truncate(const int fd, const uint64_t size) {
+	size_t count_blocks = get_count_data_blocks(size);
+	size_t count_mapped = 0;
+	uint32_t in_block = size % sb.block_size;
+	char block[sb.block_size];
+	char data[INODE_INLINE_SIZE] = {0};
+	struct file_handle* handle = get_handle(fd);
+
+	if (handle == NULL) {
+		return RETURN_FAILURE;
+	}
+	if (size > sb.max_file_size) {
+		set_myerrno(Err_os_file_too_big);
+		return RETURN_FAILURE;
+	}
+
+	// inline data are cut, or extended with zeros
+	if (isinline(&handle->inode) && fits_inline(size)) {
+		memcpy(data, inline_data(&handle->inode), size < handle->inode.file_size
+												  ? size : handle->inode.file_size);
+		return set_inline_data(&handle->inode, data, size);
+	}
+
+	// compressed data are cut in place, so they are decompressed at first
+	if (iscompressed(&handle->inode)) {
+		if (expand_compressed_file(&handle->inode) == RETURN_FAILURE
+				|| load_block_map(handle) == RETURN_FAILURE) {
+			return RETURN_FAILURE;
+		}
+	}
+	// inline data don't fit anymore, so they are moved to block and rest of file is hole
+	if (isinline(&handle->inode)) {
+		if (expand_inline_file(&handle->inode) == RETURN_FAILURE
+				|| load_block_map(handle) == RETURN_FAILURE) {
+			return RETURN_FAILURE;
+		}
+		handle->count_blocks = 1;
+		handle->blocks[0] = bmap(&handle->inode, 0);
+	}
+	// blocks preallocated behind end of file are released, unless the file is extended
+	count_mapped = handle->count_blocks;
+	if (isprealloc(&handle->inode) && size <= handle->inode.file_size) {
+		count_mapped = get_count_mapped_blocks(&handle->inode);
+		handle->inode.flags &= ~INODE_FLAG_PREALLOC;
+	}
+	if (count_blocks < count_mapped) {
+		free_links_range(&handle->inode, count_blocks, count_mapped - count_blocks);
+	}
+	if (count_blocks < handle->count_blocks) {
+		handle->count_blocks = count_blocks;
+	}
+
+	// rest of last block behind new end must be zeros, so extending the file reads them
+	if (in_block > 0 && size < handle->inode.file_size
+			&& handle->blocks[count_blocks - 1] != FREE_LINK) {
+		// block shared with other file is copied at first
+		if (create_links_at(&handle->blocks[count_blocks - 1], count_blocks - 1, 1,
+							&handle->inode) == RETURN_FAILURE) {
+			return RETURN_FAILURE;
+		}
+		fs_read_data(block, sb.block_size, handle->blocks[count_blocks - 1]);
+		memset(block + in_block, '\0', sb.block_size - in_block);
+		fs_write_data(block, sb.block_size, handle->blocks[count_blocks - 1]);
+	}
+
+	update_size(&handle->inode, size);
+	return load_block_map(handle);
+}
@@ -1,4 +1,6 @@
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "fs_api.h"
 #include "fs_cache.h"
@@ -7,8 +9,6 @@
 #include "logger.h"
 
 
-extern int free_all_links(struct inode* inode_source);
-
 // ---------- INODE FREE ------------------------------------------------------
 
 /*
@@ -16,10 +16,14 @@ extern int free_all_links(struct inode* inode_source);
  * 	freeing links and turning on its bitmap field.
  */
 static int free_inode(struct inode* inode2free) {
+	// handles of the file would access next file with the same inode
+	file_close_inode(inode2free->id_inode);
 	// free given inode
 	inode2free->inode_type = Inode_type_free;
 	inode2free->file_size = 0;
 	free_all_links(inode2free);
+	inode2free->flags = 0;
+	inode2free->nlink = 0;
 	free_bitmap_field_inode(inode2free->id_inode);
 	fs_write_inode(inode2free, 1, inode2free->id_inode);
 
@@ -44,6 +48,56 @@ int free_inode_file(struct inode* inode2free) {
 	return ret;
 }
 
+/*
+ * Remove one directory item linking given file inode. The inode is freed,
+ * when no directory item links it anymore.
+ */
+int unlink_inode_file(struct inode* inode_target) {
+	if (inode_target->inode_type != Inode_type_file) {
+		return free_inode_file(inode_target);
+	}
+	// file linked from other directory items stays
+	if (inode_target->nlink > 1) {
+		inode_target->nlink--;
+		fs_write_inode(inode_target, 1, inode_target->id_inode);
+		return RETURN_SUCCESS;
+	}
+	return free_inode_file(inode_target);
+}
+
+static int compare_inode_id(const void* a, const void* b) {
+	const uint32_t id_a = ((const struct inode*) a)->id_inode;
+	const uint32_t id_b = ((const struct inode*) b)->id_inode;
+	return (id_a > id_b) - (id_a < id_b);
+}
+
+/*
+ * Free inodes, whose blocks were already released, e.g. by 'free_blocks()'.
+ * Inodes are sorted by ids, so each run of following inodes is written
+ * and released in bitmap at once.
+ */
+int free_inodes_released(struct inode* inodes, const size_t count) {
+	size_t i, j;
+
+	qsort(inodes, count, sizeof(struct inode), compare_inode_id);
+
+	for (i = 0; i < count; ++i) {
+		file_close_inode(inodes[i].id_inode);
+		inodes[i].inode_type = Inode_type_free;
+		inodes[i].file_size = 0;
+		inodes[i].flags = 0;
+		inodes[i].nlink = 0;
+		memset(inline_data(&inodes[i]), FREE_LINK, INODE_INLINE_SIZE);
+	}
+	for (i = 0; i < count; i = j) {
+		for (j = i + 1; j < count && inodes[j].id_inode == inodes[j - 1].id_inode + 1; ++j)
+			;
+		free_bitmap_range_inode(inodes[i].id_inode, j - i);
+		fs_write_inode(&inodes[i], j - i, inodes[i].id_inode);
+	}
+	return RETURN_SUCCESS;
+}
+
 /*
  * Free file inode. If directory is not empty
  * or 'id_inode' is id of file or free inode, error is set.
@@ -81,12 +135,19 @@ uint32_t create_inode_file(struct inode* new_inode) {
 		// cache the free inode, init it and write it
 		fs_read_inode(new_inode, 1, id_free_inode);
 		new_inode->inode_type = Inode_type_file;
+		// new file is always added to a directory
+		new_inode->nlink = 1;
+		// data blocks of new file are mapped by extents
+		if (sb.features & FS_FEATURE_EXTENTS) {
+			new_inode->flags |= INODE_FLAG_EXTENTS;
+		}
 		fs_write_inode(new_inode, 1, id_free_inode);
 
 		log_info("New file inode created, id: [%d].", id_free_inode);
 	} else {
 		// no need for free_bitmap_field_inode(), because nothing
-		// was allocated, if 'id_free_inode' is RETURN_FAILURE
+		// was allocated, if 'id_free_inode' is FREE_LINK
+		id_free_inode = RETURN_FAILURE;
 		log_error("Unable to create new inode.");
 	}
 
@@ -95,18 +156,38 @@ uint32_t create_inode_file(struct inode* new_inode) {
 
 /*
  *  Create new inode for a directory. One inode and one data block from filesystem is used.
+ *  With inline data, new empty directory uses no data block -- only id of its parent
+ *  is stored inline and dot directories are created, when first item is added.
  *  Returns index number of new inode, or 'RETURN_FAILURE'.
  */
 uint32_t create_inode_directory(struct inode* new_inode, const uint32_t id_parent) {
 	// id of new inode, which will be initialized
 	uint32_t id_free_inode = allocate_bitmap_field_inode();
 	// id of new block, where first direct link will point to; equal to create_direct()
-	uint32_t id_free_block = allocate_bitmap_field_data();
+	uint32_t id_free_block = FREE_LINK;
 	// default folders in each directory
-	struct directory_item new_dirs[sb.count_dir_items];
+	struct directory_item* new_dirs = NULL;
+
+	// empty directory is stored inline
+	if (id_free_inode != FREE_LINK && fits_inline(0)) {
+		fs_read_inode(new_inode, 1, id_free_inode);
+
+		new_inode->inode_type = Inode_type_dirc;
+		new_inode->file_size = 0;
+		new_inode->nlink = 1;
+		new_inode->flags |= INODE_FLAG_INLINE;
+		// inode is written together with id of parent
+		set_parent_inode_id(new_inode, id_parent);
+
+		log_info("New directory inode created, id: [%d].", id_free_inode);
+		return id_free_inode;
+	}
+
+	id_free_block = allocate_bitmap_field_data();
+	new_dirs = alloc_dir_items();
 
 	// if there is free inode and data block for it, use it
-	if (!(id_free_inode == FREE_LINK || id_free_block == FREE_LINK)) {
+	if (!(id_free_inode == FREE_LINK || id_free_block == FREE_LINK || new_dirs == NULL)) {
 		fs_read_inode(new_inode, 1, id_free_inode);
 
 		// init first block of new directory
@@ -114,6 +195,7 @@ uint32_t create_inode_directory(struct inode* new_inode, const uint32_t id_paren
 		// init new inode
 		new_inode->inode_type = Inode_type_dirc;
 		new_inode->file_size = sb.block_size;
+		new_inode->nlink = 1;
 		new_inode->direct[0] = id_free_block;
 
 		// write new updated inode and data block
@@ -126,14 +208,100 @@ uint32_t create_inode_directory(struct inode* new_inode, const uint32_t id_paren
 		// getting empty bitmap fields turned them off, so turn them on again
 		if (id_free_inode != FREE_LINK) {
 			free_bitmap_field_inode(id_free_inode);
-			id_free_inode = FREE_LINK;
 		}
 		if (id_free_block != FREE_LINK) {
 			free_bitmap_field_data(id_free_block);
 		}
+		id_free_inode = RETURN_FAILURE;
 
 		log_error("Unable to create new inode.");
 	}
 
+	if (new_dirs)
+		free(new_dirs);
 	return id_free_inode;
 }
+
+// ---------- INODE INLINE ----------------------------------------------------
+
+/*
+ * Check if data of given size can be stored inline in inode.
+ */
+bool fits_inline(const uint64_t size) {
+	return (bool) ((sb.features & FS_FEATURE_INLINE_DATA) && size <= INODE_INLINE_SIZE);
+}
+
+/*
+ * Store given data inline in file inode. Links of the inode are freed at first.
+ */
+int set_inline_data(struct inode* inode_target, const char* data, const uint32_t size) {
+	char data_copy[INODE_INLINE_SIZE] = {0};
+
+	if (!fits_inline(size)) {
+		set_myerrno(Err_os_file_too_big);
+		return RETURN_FAILURE;
+	}
+	// data could be inline data of the inode itself
+	memcpy(data_copy, data, size);
+
+	free_all_links(inode_target);
+	memcpy(inline_data(inode_target), data_copy, INODE_INLINE_SIZE);
+	inode_target->flags |= INODE_FLAG_INLINE;
+	inode_target->file_size = size;
+	fs_write_inode(inode_target, 1, inode_target->id_inode);
+
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Move inline data of file inode to new data block, so the file can grow.
+ */
+int expand_inline_file(struct inode* inode_target) {
+	uint32_t link[1] = {FREE_LINK};
+	char block[sb.block_size];
+
+	memset(block, '\0', sb.block_size);
+	memcpy(block, inline_data(inode_target), INODE_INLINE_SIZE);
+
+	// links of the inode are free again
+	memset(inline_data(inode_target), FREE_LINK, INODE_INLINE_SIZE);
+	inode_target->flags &= ~INODE_FLAG_INLINE;
+
+	if (create_empty_links(link, 1, inode_target) == RETURN_FAILURE) {
+		memcpy(inline_data(inode_target), block, INODE_INLINE_SIZE);
+		inode_target->flags |= INODE_FLAG_INLINE;
+		return RETURN_FAILURE;
+	}
+	fs_write_data(block, sb.block_size, link[0]);
+
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Create first block with dot directories for inline directory, so items can be added to it.
+ */
+int expand_inline_directory(struct inode* inode_dir) {
+	uint32_t link[1] = {FREE_LINK};
+	uint32_t id_parent = get_parent_inode_id(inode_dir);
+	struct directory_item* block = NULL;
+
+	if ((block = alloc_dir_items()) == NULL) {
+		return RETURN_FAILURE;
+	}
+	// links of the inode are free again
+	memset(inline_data(inode_dir), FREE_LINK, INODE_INLINE_SIZE);
+	inode_dir->flags &= ~INODE_FLAG_INLINE;
+
+	// size of directory is increased with the new block here
+	if (create_empty_links(link, 1, inode_dir) == RETURN_FAILURE) {
+		inode_dir->flags |= INODE_FLAG_INLINE;
+		set_parent_inode_id(inode_dir, id_parent);
+		free(block);
+		return RETURN_FAILURE;
+	}
+	init_empty_dir_block(block, inode_dir->id_inode, id_parent);
+	fs_write_directory_item(block, sb.count_dir_items, link[0]);
+
+	free(block);
+	return RETURN_SUCCESS;
+}
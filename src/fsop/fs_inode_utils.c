@@ -11,14 +11,27 @@
 #include "errors.h"
 #include "logger.h"
 
+#define INODES_GAP_MAX		64		// maximal gap of unwanted inodes, which is read within one range
+#define INODES_RANGE_MAX	4096	// maximal count of inodes read at once
+
+struct id_index {
+	uint32_t id;
+	size_t index;
+};
 
 /*
  * Get id of parent of given inode, which must be directory.
  */
-static int32_t get_parent_inode_id(struct inode* inode_child) {
-//	assert(inode_child->inode_type == Inode_type_dirc); // TODO delete
-
+uint32_t get_parent_inode_id(const struct inode* inode_child) {
+	uint32_t id_parent = FREE_LINK;
 	struct directory_item dot_dirs[2] = {0};
+
+	// inline directory has no dot directories, only id of its parent
+	if (isinline(inode_child)) {
+		memcpy(&id_parent, inline_data(inode_child), sizeof(uint32_t));
+		return id_parent;
+	}
+
 	fs_read_directory_item(dot_dirs, 2, inode_child->direct[0]);
 	// it would be possible to iterate all blocks of inode, until ".." directory was found,
 	// but this is just faster and by filesystem definition, it will be always here,
@@ -26,6 +39,53 @@ static int32_t get_parent_inode_id(struct inode* inode_child) {
 	return dot_dirs[1].id_inode;
 }
 
+/*
+ * Set id of parent of given inode, which must be directory, e.g. after it was moved.
+ */
+int set_parent_inode_id(struct inode* inode_child, const uint32_t id_parent) {
+	struct directory_item* block = NULL;
+
+	if (isinline(inode_child)) {
+		memcpy(inline_data(inode_child), &id_parent, sizeof(uint32_t));
+		fs_write_inode(inode_child, 1, inode_child->id_inode);
+
+		// update 'inode_actual', if it was the one, which parent was changed
+		if (inode_child->id_inode == inode_actual.id_inode) {
+			fs_read_inode(&inode_actual, 1, inode_child->id_inode);
+		}
+		return RETURN_SUCCESS;
+	}
+
+	// ".." directory is always second in first block, see 'get_parent_inode_id()',
+	// whole block is rewritten, because variable-length records can't be written partially
+	if ((block = alloc_dir_items()) == NULL) {
+		return RETURN_FAILURE;
+	}
+	fs_read_directory_item(block, sb.count_dir_items, inode_child->direct[0]);
+	block[1].id_inode = id_parent;
+	fs_write_directory_item(block, sb.count_dir_items, inode_child->direct[0]);
+	free(block);
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Search directory for id of item with name given in carry.
+ * Dot directories of inline directory are not in any block, so they are resolved here.
+ */
+static int search_item_id(const struct inode* inode_dir, struct carry_dir_item* carry) {
+	if (isinline(inode_dir)) {
+		if (strcmp(carry->name, ".") == 0) {
+			carry->id = inode_dir->id_inode;
+			return RETURN_SUCCESS;
+		}
+		if (strcmp(carry->name, "..") == 0) {
+			carry->id = get_parent_inode_id(inode_dir);
+			return RETURN_SUCCESS;
+		}
+	}
+	return iterate_links(inode_dir, carry, search_block_inode_id);
+}
+
 /*
  *  Get id of inode from given path and id of its parent. If path starts with "/",
  *  then function searches from root inode, else from actual inode, where user is.
@@ -60,9 +120,10 @@ static int get_inode_ids(uint32_t* p_id_destination, uint32_t* p_id_parent, cons
 
 	// go over all elements in given path
 	while (dir != NULL) {
-		// get inode of element in given path
-		strncpy(carry.name, dir, strlen(dir));
-		ret_iter = iterate_links(&inode_dest, &carry, search_block_inode_id);
+		// get inode of element in given path, item with too long name can't exist
+		strncpy(carry.name, dir, STRLEN_ITEM_NAME - 1);
+		ret_iter = strlen(dir) < STRLEN_ITEM_NAME
+				   ? search_item_id(&inode_dest, &carry) : RETURN_FAILURE;
 
 		// element in path was found in block
 		if (ret_iter != RETURN_FAILURE) {
@@ -204,6 +265,11 @@ int add_to_parent(struct inode* inode_parent, struct carry_dir_item* carry) {
 	// link number to empty block, in case all blocks of parent are full
 	uint32_t empty_block[1] = {0};
 
+	// inline directory gets its first block with dot directories
+	if (isinline(inode_parent) && expand_inline_directory(inode_parent) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+
 	// add record to parent inode about new directory
 	if (iterate_links(inode_parent, carry, add_block_item) == RETURN_FAILURE) {
 		// parent inode has all, so far created, blocks full
@@ -218,6 +284,75 @@ int add_to_parent(struct inode* inode_parent, struct carry_dir_item* carry) {
 	return RETURN_SUCCESS;
 }
 
+/*
+ * Remove record of inode from its parent directory inode.
+ * If block with the record is left empty, the directory is compacted.
+ */
+int remove_from_parent(struct inode* inode_parent, struct carry_dir_item* carry) {
+	// parent could be changed since it was loaded (e.g. when item is moved within it)
+	fs_read_inode(inode_parent, 1, inode_parent->id_inode);
+
+	carry->is_block_empty = false;
+	if (iterate_links(inode_parent, carry, delete_block_item) == RETURN_FAILURE) {
+		return RETURN_FAILURE;
+	}
+	if (carry->is_block_empty) {
+		return compact_directory(inode_parent);
+	}
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Move all items of directory forward to its first blocks
+ * and release trailing blocks, which are left empty.
+ */
+int compact_directory(struct inode* inode_dir) {
+	int ret = RETURN_FAILURE;
+	size_t i = 0, j;
+	size_t count_blocks = 0;
+	struct carry_items carry_items = {0};
+	struct carry_links carry_links = {0};
+	struct directory_item* block = NULL;
+
+	if ((block = alloc_dir_items()) == NULL
+			|| iterate_links(inode_dir, &carry_items, collect_items) != RETURN_FAILURE
+			|| iterate_links(inode_dir, &carry_links, collect_links) != RETURN_FAILURE) {
+		goto end; // error during mallocation
+	}
+
+	// rewrite blocks with items in the same order, each block is filled as much as possible,
+	// first block stays always, because of dot directories
+	while (count_blocks < carry_links.count && (count_blocks == 0 || i < carry_items.count)) {
+		for (j = 0; j < sb.count_dir_items; ++j) {
+			block[j].id_inode = FREE_LINK;
+			strncpy(block[j].item_name, "", STRLEN_ITEM_NAME);
+		}
+		for (j = 0; j < sb.count_dir_items && i < carry_items.count
+				&& has_space_for_record(block, carry_items.items[i].item_name); ++j, ++i) {
+			memcpy(&block[j], &carry_items.items[i], sizeof(struct directory_item));
+		}
+		fs_write_directory_item(block, sb.count_dir_items, carry_links.links[count_blocks++]);
+	}
+
+	// release trailing blocks -- links are freed from the end of inode
+	if (carry_links.count > count_blocks) {
+		free_amount_of_links(inode_dir, carry_links.count - count_blocks);
+		update_size(inode_dir, (uint64_t) count_blocks * sb.block_size);
+		log_info("Directory [%d] compacted, released blocks: [%d].",
+				 inode_dir->id_inode, (int) (carry_links.count - count_blocks));
+	}
+	ret = RETURN_SUCCESS;
+
+end:
+	if (block)
+		free(block);
+	if (carry_items.items)
+		free(carry_items.items);
+	if (carry_links.links)
+		free(carry_links.links);
+	return ret;
+}
+
 /*
  * Check if directory, represented by given inode, is empty.
  */
@@ -238,7 +373,7 @@ bool item_exists(const struct inode* inode_parent, const char* dir_name) {
 	strncpy(carry.name, dir_name, STRLEN_ITEM_NAME);
 
 	// check if item already exists
-	if (iterate_links(inode_parent, &carry, search_block_inode_id) != RETURN_FAILURE) {
+	if (search_item_id(inode_parent, &carry) != RETURN_FAILURE) {
 		exists = true;
 	}
 	return exists;
@@ -247,7 +382,7 @@ bool item_exists(const struct inode* inode_parent, const char* dir_name) {
 /*
  * Update size of file inode.
  */
-int update_size(struct inode* inode_target, const uint32_t file_size) {
+int update_size(struct inode* inode_target, const uint64_t file_size) {
 	inode_target->file_size = file_size;
 	fs_write_inode(inode_target, 1, inode_target->id_inode);
 
@@ -258,6 +393,216 @@ int update_size(struct inode* inode_target, const uint32_t file_size) {
 	return RETURN_SUCCESS;
 }
 
+static int compare_id_index(const void* a, const void* b) {
+	const struct id_index* id_a = (const struct id_index*) a;
+	const struct id_index* id_b = (const struct id_index*) b;
+	return (id_a->id > id_b->id) - (id_a->id < id_b->id);
+}
+
+/*
+ * Read inodes with given ids to array of inodes in the same order as ids are given.
+ * Ids are sorted at first, so inodes are read in few coalesced ranges
+ * of inode table, instead of one seek and read for every single inode.
+ */
+int load_inodes(struct inode* inodes, const uint32_t* ids, const size_t count) {
+	size_t i, j, k;
+	uint32_t id_first = FREE_LINK;
+	struct id_index* sorted = NULL;
+	struct inode* range = NULL;
+
+	// empty directory has no items to load, 'malloc(0)' could return NULL
+	if (count == 0) {
+		return RETURN_SUCCESS;
+	}
+	sorted = malloc(count * sizeof(struct id_index));
+	range = malloc(INODES_RANGE_MAX * sizeof(struct inode));
+	if (sorted == NULL || range == NULL) {
+		set_myerrno(Err_malloc);
+		goto fail;
+	}
+
+	for (i = 0; i < count; ++i) {
+		sorted[i].id = ids[i];
+		sorted[i].index = i;
+	}
+	qsort(sorted, count, sizeof(struct id_index), compare_id_index);
+
+	for (i = 0; i < count; i = j) {
+		id_first = sorted[i].id;
+
+		// extend range, while gaps between ids are small and range is not too long
+		for (j = i + 1; j < count; ++j) {
+			if (sorted[j].id - sorted[j - 1].id > INODES_GAP_MAX
+					|| sorted[j].id - id_first >= INODES_RANGE_MAX)
+				break;
+		}
+
+		// read whole range and pick wanted inodes from it
+		fs_read_inode(range, sorted[j - 1].id - id_first + 1, id_first);
+		for (k = i; k < j; ++k) {
+			memcpy(&inodes[sorted[k].index], &range[sorted[k].id - id_first], sizeof(struct inode));
+		}
+	}
+
+	free(range);
+	free(sorted);
+	return RETURN_SUCCESS;
+
+fail:
+	if (range)
+		free(range);
+	if (sorted)
+		free(sorted);
+	return RETURN_FAILURE;
+}
+
+/*
+ * Collect all items of directory tree under given inode in breadth-first order,
+ * so parent of every item is before it. Items of each directory are collected
+ * at once and their inodes are read together. First item is the root itself
+ * with empty name. Returned array has to be freed.
+ */
+int collect_tree(const struct inode* inode_root, struct tree_item** tree, size_t* count) {
+	size_t i, j, k;
+	size_t capacity = 1;
+	uint32_t* ids = NULL;
+	struct inode* inodes = NULL;
+	struct tree_item* items = NULL;
+	struct tree_item* items_new = NULL;
+	struct carry_items carry = {0};
+
+	if ((items = malloc(capacity * sizeof(struct tree_item))) == NULL) {
+		set_myerrno(Err_malloc);
+		goto fail;
+	}
+	memcpy(&items[0].inode, inode_root, sizeof(struct inode));
+	items[0].parent = 0;
+	items[0].name[0] = '\0';
+	*count = 1;
+
+	// tree grows behind the item, which is being read
+	for (i = 0; i < *count; ++i) {
+		if (items[i].inode.inode_type != Inode_type_dirc)
+			continue;
+
+		carry.count = 0;
+		if (iterate_links(&items[i].inode, &carry, collect_items) != RETURN_FAILURE) {
+			goto fail; // error during mallocation
+		}
+		if (carry.count == 0)
+			continue;
+
+		if (*count + carry.count > capacity) {
+			capacity = 2 * (*count + carry.count);
+			if ((items_new = realloc(items, capacity * sizeof(struct tree_item))) == NULL) {
+				set_myerrno(Err_malloc);
+				goto fail;
+			}
+			items = items_new;
+		}
+		free(ids);
+		free(inodes);
+		ids = malloc(carry.count * sizeof(uint32_t));
+		inodes = malloc(carry.count * sizeof(struct inode));
+		if (ids == NULL || inodes == NULL) {
+			set_myerrno(Err_malloc);
+			goto fail;
+		}
+
+		// dot directories are not part of tree
+		for (j = 0, k = 0; j < carry.count; ++j) {
+			if (strcmp(carry.items[j].item_name, ".") == 0
+					|| strcmp(carry.items[j].item_name, "..") == 0)
+				continue;
+			ids[k] = carry.items[j].id_inode;
+			items[*count + k].parent = i;
+			strncpy(items[*count + k].name, carry.items[j].item_name, STRLEN_ITEM_NAME);
+			k++;
+		}
+		if (k > 0 && load_inodes(inodes, ids, k) == RETURN_FAILURE) {
+			goto fail;
+		}
+		for (j = 0; j < k; ++j) {
+			memcpy(&items[*count + j].inode, &inodes[j], sizeof(struct inode));
+		}
+		*count += k;
+	}
+
+	free(ids);
+	free(inodes);
+	free(carry.items);
+	*tree = items;
+	return RETURN_SUCCESS;
+
+fail:
+	free(ids);
+	free(inodes);
+	free(carry.items);
+	free(items);
+	return RETURN_FAILURE;
+}
+
+/*
+ * Release directory tree collected by 'collect_tree()', which is already removed from
+ * its parent. Items are released from the deepest ones, blocks of all released inodes
+ * are collected too and released at once in sorted order. File with hard links
+ * out of the tree is only unlinked.
+ */
+int free_tree(struct tree_item* tree, const size_t count) {
+	int ret = RETURN_FAILURE;
+	size_t i, j, count_free = 0;
+	struct inode* inodes = NULL;		// inodes to free
+	struct carry_links carry = {0};
+
+	if ((inodes = malloc(count * sizeof(struct inode))) == NULL) {
+		set_myerrno(Err_malloc);
+		goto end;
+	}
+
+	// links of hard linked file are counted down at its first item in tree
+	for (i = 0; i < count; ++i) {
+		if (tree[i].inode.inode_type != Inode_type_file)
+			continue;
+		// file with single link has no other item, so it isn't searched for
+		j = i;
+		if (tree[i].inode.nlink > 1) {
+			for (j = 0; j < i && tree[j].inode.id_inode != tree[i].inode.id_inode; ++j)
+				;
+		}
+		// files created before link counts were tracked have count 0, but one link
+		if (j == i && tree[i].inode.nlink == 0)
+			tree[i].inode.nlink = 1;
+		tree[j].inode.nlink--;
+		// other items of the file are left to the first one
+		if (j < i)
+			tree[i].inode.inode_type = Inode_type_free;
+	}
+
+	// post-order -- items of directory are behind it
+	for (i = count; i > 0; --i) {
+		if (tree[i - 1].inode.inode_type == Inode_type_free)
+			continue;
+		// file linked from out of the tree stays
+		if (tree[i - 1].inode.inode_type == Inode_type_file && tree[i - 1].inode.nlink > 0) {
+			fs_write_inode(&tree[i - 1].inode, 1, tree[i - 1].inode.id_inode);
+			continue;
+		}
+		if (collect_all_blocks(&tree[i - 1].inode, &carry) == RETURN_FAILURE) {
+			goto end;
+		}
+		memcpy(&inodes[count_free++], &tree[i - 1].inode, sizeof(struct inode));
+	}
+
+	free_blocks(carry.links, carry.count);
+	free_inodes_released(inodes, count_free);
+	ret = RETURN_SUCCESS;
+
+end:
+	free(inodes);
+	free(carry.links);
+	return ret;
+}
+
 /*
  * Load ids of all inodes in filesystem.
  */
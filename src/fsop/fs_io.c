@@ -2,38 +2,193 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include <assert.h>
 
 #include "fs_api.h"
 #include "fs_cache.h"
 
 
+#define LINK_CACHE_SIZE		64		// count of blocks with links in cache
+
+
 extern FILE* filesystem;
 
+// Direct-mapped cache of whole blocks with links, so repeated iterations over links
+// of the same inode don't read blocks with indirect links again. Slot of block is given
+// by its id, the cache is filled on read and write of links and other writes to
+// the block invalidate it.
+static uint32_t link_cache_ids[LINK_CACHE_SIZE];
+static uint32_t* link_cache = NULL;
+
+
+// --- LINK CACHE
+
+static uint32_t* link_cache_slot(const uint32_t id) {
+	return link_cache + (size_t) (id % LINK_CACHE_SIZE) * sb.count_links;
+}
+
+static void link_cache_store(const uint32_t* links, const uint32_t id) {
+	// cache is only optimization, so it is just not used without memory
+	if (link_cache == NULL
+			&& (link_cache = malloc(LINK_CACHE_SIZE * sb.count_links * sizeof(uint32_t))) == NULL) {
+		return;
+	}
+	memcpy(link_cache_slot(id), links, sb.count_links * sizeof(uint32_t));
+	link_cache_ids[id % LINK_CACHE_SIZE] = id;
+}
+
+static void link_cache_invalidate(const uint32_t id) {
+	if (link_cache_ids[id % LINK_CACHE_SIZE] == id) {
+		link_cache_ids[id % LINK_CACHE_SIZE] = FREE_LINK;
+	}
+}
+
+/*
+ * Drop all cached blocks, e.g. when other filesystem is loaded or formatted.
+ */
+void fs_reset_link_cache() {
+	if (link_cache) {
+		free(link_cache);
+		link_cache = NULL;
+	}
+	memset(link_cache_ids, FREE_LINK, sizeof(link_cache_ids));
+}
+
 
 // --- SEEK
 
-static void fs_seek_set(const int64_t offset) {
-//	assert((0 <= offset) && (offset < (sb.disk_size*1024*1024))); // TODO delete
-	fseek(filesystem, offset, SEEK_SET);
+static void fs_seek_set(const uint64_t offset) {
+	// offsets are 64b, so 'fseek()' with long is not enough on every host
+	fseeko(filesystem, (off_t) offset, SEEK_SET);
 }
 
 static void fs_seek_inodes(const uint32_t index) {
-	fs_seek_set(sb.addr_inodes + (int64_t) index * sizeof(struct inode));
+	fs_seek_set(sb.addr_inodes + (uint64_t) index * sizeof(struct inode));
 }
 
 static void fs_seek_data(const uint32_t index) {
-	fs_seek_set(sb.addr_data + (int64_t) index * sb.block_size);
+	fs_seek_set(sb.addr_data + (uint64_t) index * sb.block_size);
 }
 
 // function is wrapped and only used in fs_bitmap.c
 void fs_seek_bm_inode(const uint32_t index) {
-	fs_seek_set(sb.addr_bm_inodes + (int64_t) index);
+	fs_seek_set(sb.addr_bm_inodes + (uint64_t) index);
 }
 
 // function is wrapped and only used in fs_bitmap.c
 void fs_seek_bm_data(const uint32_t index) {
-	fs_seek_set(sb.addr_bm_data + (int64_t) index);
+	fs_seek_set(sb.addr_bm_data + (uint64_t) index);
+}
+
+static void fs_seek_refcounts(const uint32_t index) {
+	fs_seek_set(sb.addr_refcounts + (uint64_t) index * sizeof(uint16_t));
+}
+
+static void fs_seek_dedup_index(const uint32_t index) {
+	fs_seek_set(sb.addr_dedup_index + (uint64_t) index * sizeof(struct dedup_entry));
+}
+
+static void fs_seek_dedup_slots(const uint32_t index) {
+	fs_seek_set(sb.addr_dedup_slots + (uint64_t) index * sizeof(uint32_t));
+}
+
+// --- DIRECTORY RECORDS
+
+static size_t decode_records_fixed(struct directory_item* buffer, const size_t count,
+								   const char* block) {
+	size_t i;
+	struct directory_record record;
+
+	for (i = 0; i < count; ++i) {
+		memcpy(&record, block + i * sizeof(struct directory_record), sizeof(struct directory_record));
+		buffer[i].id_inode = record.id_inode;
+		strncpy(buffer[i].item_name, record.item_name, STRLEN_RECORD_NAME);
+		buffer[i].item_name[STRLEN_RECORD_NAME - 1] = '\0';
+	}
+	return count;
+}
+
+static size_t encode_records_fixed(char* block, const struct directory_item* buffer,
+								   const size_t count) {
+	size_t i;
+	struct directory_record record;
+
+	for (i = 0; i < count; ++i) {
+		memset(&record, '\0', sizeof(struct directory_record));
+		record.id_inode = buffer[i].id_inode;
+		strncpy(record.item_name, buffer[i].item_name, STRLEN_RECORD_NAME - 1);
+		memcpy(block + i * sizeof(struct directory_record), &record, sizeof(struct directory_record));
+	}
+	return count;
+}
+
+/*
+ * Records are packed one after another from start of block and rest of block is zeroed,
+ * so zero record length ends records in block. Decoded items are followed with free items.
+ */
+static size_t decode_records_varlen(struct directory_item* buffer, const size_t count,
+									const char* block) {
+	size_t i = 0, decoded;
+	size_t position = 0;
+	uint16_t record_length = 0;
+	uint8_t name_length = 0;
+
+	while (i < count && position + DIR_RECORD_HEADER <= sb.block_size) {
+		memcpy(&record_length, block + position + 4, sizeof(uint16_t));
+		memcpy(&name_length, block + position + 6, sizeof(uint8_t));
+		// end of records, or damaged record
+		if (record_length < dir_record_size(name_length)
+				|| position + record_length > sb.block_size) {
+			break;
+		}
+		memcpy(&buffer[i].id_inode, block + position, sizeof(uint32_t));
+		memcpy(buffer[i].item_name, block + position + DIR_RECORD_HEADER, name_length);
+		buffer[i].item_name[name_length] = '\0';
+
+		position += record_length;
+		++i;
+	}
+	decoded = i;
+
+	for (; i < count; ++i) {
+		buffer[i].id_inode = FREE_LINK;
+		buffer[i].item_name[0] = '\0';
+	}
+	return decoded;
+}
+
+/*
+ * Free items are skipped, so records are always packed. Items, which would not fit
+ * to block, are not encoded -- caller checks space with 'has_space_for_record()'.
+ */
+static size_t encode_records_varlen(char* block, const struct directory_item* buffer,
+									const size_t count) {
+	size_t i, encoded = 0;
+	size_t position = 0;
+	uint16_t record_length = 0;
+	uint8_t name_length = 0;
+
+	memset(block, '\0', sb.block_size);
+
+	for (i = 0; i < count; ++i) {
+		if (buffer[i].id_inode == FREE_LINK)
+			continue;
+
+		name_length = (uint8_t) strlen(buffer[i].item_name);
+		record_length = (uint16_t) dir_record_size(name_length);
+		if (position + record_length > sb.block_size)
+			break;
+
+		memcpy(block + position, &buffer[i].id_inode, sizeof(uint32_t));
+		memcpy(block + position + 4, &record_length, sizeof(uint16_t));
+		memcpy(block + position + 6, &name_length, sizeof(uint8_t));
+		memcpy(block + position + DIR_RECORD_HEADER, buffer[i].item_name, name_length);
+
+		position += record_length;
+		++encoded;
+	}
+	return encoded;
 }
 
 // --- READ
@@ -53,15 +208,33 @@ size_t fs_read_inode(struct inode* buffer, const size_t count, const uint32_t id
 	return fread(buffer, sizeof(struct inode), count, filesystem);
 }
 
+// directory records are decoded from block to items in memory, see 'DIRECTORY RECORDS' below
 size_t fs_read_directory_item(struct directory_item* buffer,
 							  const size_t count, const uint32_t id) {
-	fs_seek_data(id - 1);
-	return fread(buffer, sizeof(struct directory_item), count, filesystem);
+	char block[sb.block_size];
+	fs_read_data(block, sb.block_size, id);
+
+	if (sb.features & FS_FEATURE_DIR_VARLEN)
+		return decode_records_varlen(buffer, count, block);
+	else
+		return decode_records_fixed(buffer, count, block);
 }
 
+// only whole blocks are cached, see 'LINK CACHE'
 size_t fs_read_link(uint32_t* buffer, const size_t count, const uint32_t id) {
+	size_t ret;
+
+	if (count == sb.count_links && link_cache_ids[id % LINK_CACHE_SIZE] == id) {
+		memcpy(buffer, link_cache_slot(id), count * sizeof(uint32_t));
+		return count;
+	}
+
 	fs_seek_data(id - 1);
-	return fread(buffer, sizeof(uint32_t), count, filesystem);
+	ret = fread(buffer, sizeof(uint32_t), count, filesystem);
+	if (ret == sb.count_links) {
+		link_cache_store(buffer, id);
+	}
+	return ret;
 }
 
 size_t fs_read_data(char* buffer, const size_t count, const uint32_t id) {
@@ -69,6 +242,24 @@ size_t fs_read_data(char* buffer, const size_t count, const uint32_t id) {
 	return fread(buffer, sizeof(char), count, filesystem);
 }
 
+// reference counts of 'count' blocks from block with given id
+size_t fs_read_refcount(uint16_t* buffer, const size_t count, const uint32_t id) {
+	fs_seek_refcounts(id - 1);
+	return fread(buffer, sizeof(uint16_t), count, filesystem);
+}
+
+// entries of index of data blocks from given slot of the index
+size_t fs_read_dedup_entry(struct dedup_entry* buffer, const size_t count, const uint32_t slot) {
+	fs_seek_dedup_index(slot);
+	return fread(buffer, sizeof(struct dedup_entry), count, filesystem);
+}
+
+// slots in index of 'count' blocks from block with given id
+size_t fs_read_dedup_slot(uint32_t* buffer, const size_t count, const uint32_t id) {
+	fs_seek_dedup_slots(id - 1);
+	return fread(buffer, sizeof(uint32_t), count, filesystem);
+}
+
 // --- WRITE
 
 // only used in format.c:init_superblock()
@@ -95,12 +286,20 @@ size_t fs_write_inode(const struct inode* buffer, const size_t count, const uint
 	return ret;
 }
 
+// with variable-length records, whole block is always rewritten with given items,
+// so 'count' must cover all items in block
 size_t fs_write_directory_item(const struct directory_item* buffer,
 							   const size_t count, const uint32_t id) {
 	static size_t ret;
-	fs_seek_data(id - 1);
-	ret = fwrite(buffer, sizeof(struct directory_item), count, filesystem);
-	fs_flush();
+	char block[sb.block_size];
+
+	if (sb.features & FS_FEATURE_DIR_VARLEN) {
+		ret = encode_records_varlen(block, buffer, count);
+		fs_write_data(block, sb.block_size, id);
+	} else {
+		ret = encode_records_fixed(block, buffer, count);
+		fs_write_data(block, count * sizeof(struct directory_record), id);
+	}
 	return ret;
 }
 
@@ -109,17 +308,62 @@ size_t fs_write_link(const uint32_t* buffer, const size_t count, const uint32_t
 	fs_seek_data(id - 1);
 	ret = fwrite(buffer, sizeof(uint32_t), count, filesystem);
 	fs_flush();
+
+	if (ret == sb.count_links) {
+		link_cache_store(buffer, id);
+	} else {
+		link_cache_invalidate(id);
+	}
 	return ret;
 }
 
 size_t fs_write_data(const char* buffer, const size_t count, const uint32_t id) {
 	static size_t ret;
+	link_cache_invalidate(id);
 	fs_seek_data(id - 1);
 	ret = fwrite(buffer, sizeof(char), count, filesystem);
 	fs_flush();
 	return ret;
 }
 
+// 'count' whole blocks from block with given id
+size_t fs_write_blocks(const char* buffer, const size_t count, const uint32_t id) {
+	static size_t ret;
+	size_t i;
+
+	for (i = 0; i < count; ++i) {
+		link_cache_invalidate(id + i);
+	}
+	fs_seek_data(id - 1);
+	ret = fwrite(buffer, sb.block_size, count, filesystem);
+	fs_flush();
+	return ret;
+}
+
+size_t fs_write_refcount(const uint16_t* buffer, const size_t count, const uint32_t id) {
+	static size_t ret;
+	fs_seek_refcounts(id - 1);
+	ret = fwrite(buffer, sizeof(uint16_t), count, filesystem);
+	fs_flush();
+	return ret;
+}
+
+size_t fs_write_dedup_entry(const struct dedup_entry* buffer, const size_t count, const uint32_t slot) {
+	static size_t ret;
+	fs_seek_dedup_index(slot);
+	ret = fwrite(buffer, sizeof(struct dedup_entry), count, filesystem);
+	fs_flush();
+	return ret;
+}
+
+size_t fs_write_dedup_slot(const uint32_t* buffer, const size_t count, const uint32_t id) {
+	static size_t ret;
+	fs_seek_dedup_slots(id - 1);
+	ret = fwrite(buffer, sizeof(uint32_t), count, filesystem);
+	fs_flush();
+	return ret;
+}
+
 // --- FLUSH
 
 void fs_flush() {
@@ -1,6 +1,8 @@
 #include <memory.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 #include "fs_api.h"
 #include "fs_cache.h"
@@ -33,8 +35,22 @@ extern size_t get_count_links(const uint32_t* links);
 int iterate_links(const struct inode* inode_source, void* carry, bool (*callback)()) {
 	bool ret_call = false;
 	size_t i, ii;
-	uint32_t block_direct[sb.count_links];
-	uint32_t block_indirect[sb.count_links];
+	uint32_t* block_direct = NULL;
+	uint32_t* block_indirect = NULL;
+
+	// inline inode has no links, its data are stored in inode itself
+	if (isinline(inode_source)) {
+		return RETURN_FAILURE;
+	}
+	if (isextent(inode_source)) {
+		return iterate_extents(inode_source, carry, callback);
+	}
+	// callback may iterate links of other inode (e.g. subdirectory), so blocks are on heap
+	if ((block_direct = malloc(2 * sb.count_links * sizeof(uint32_t))) == NULL) {
+		set_myerrno(Err_malloc);
+		return RETURN_FAILURE;
+	}
+	block_indirect = block_direct + sb.count_links;
 
 	// mind the "&& !ret_call" in for loops
 
@@ -62,9 +78,120 @@ int iterate_links(const struct inode* inode_source, void* carry, bool (*callback
 			ret_call = callback(block_direct, sb.count_links, carry);
 		}
 	}
+	free(block_direct);
 	return ret_call ? RETURN_SUCCESS : RETURN_FAILURE;
 }
 
+// ---------- LINK LOOKUP -----------------------------------------------------
+
+/*
+ * Get id of data block with given index in file (logical block) without iterating links.
+ * Links are always created in order, so position of the link is computed directly
+ * and at most two blocks with indirect links are read.
+ * Returns id of the block, or 'FREE_LINK', if the file has no such block.
+ */
+uint32_t bmap(const struct inode* inode_source, const uint32_t logical_block) {
+	size_t index = logical_block;
+	uint32_t block[sb.count_links];
+
+	// inline inode has no blocks
+	if (isinline(inode_source)) {
+		return FREE_LINK;
+	}
+	if (isextent(inode_source)) {
+		return bmap_extents(inode_source, logical_block);
+	}
+
+	// DIRECT LINKS
+	if (index < COUNT_DIRECT_LINKS) {
+		return inode_source->direct[index];
+	}
+	index -= COUNT_DIRECT_LINKS;
+
+	// INDIRECT LINKS LVL 1
+	if (index < COUNT_INDIRECT_LINKS_1 * sb.count_links) {
+		if (inode_source->indirect_1[index / sb.count_links] == FREE_LINK)
+			return FREE_LINK;
+		fs_read_link(block, sb.count_links, inode_source->indirect_1[index / sb.count_links]);
+		return block[index % sb.count_links];
+	}
+	index -= COUNT_INDIRECT_LINKS_1 * sb.count_links;
+
+	// INDIRECT LINKS LVL 2
+	if (index < COUNT_INDIRECT_LINKS_2 * sb.count_links * sb.count_links) {
+		if (inode_source->indirect_2[index / (sb.count_links * sb.count_links)] == FREE_LINK)
+			return FREE_LINK;
+		fs_read_link(block, sb.count_links,
+					 inode_source->indirect_2[index / (sb.count_links * sb.count_links)]);
+		index %= sb.count_links * sb.count_links;
+
+		if (block[index / sb.count_links] == FREE_LINK)
+			return FREE_LINK;
+		fs_read_link(block, sb.count_links, block[index / sb.count_links]);
+		return block[index % sb.count_links];
+	}
+	return FREE_LINK;
+}
+
+/*
+ * Get index of the last used link in given array of links increased by one, or 0.
+ */
+static size_t get_links_end_(const uint32_t* links, const size_t count) {
+	size_t i = count;
+
+	while (i > 0 && links[i - 1] == FREE_LINK)
+		--i;
+	return i;
+}
+
+/*
+ * Get count of logical blocks of file up to its last data block. Blocks can be
+ * mapped behind end of file, when they were preallocated, so size of file is not used.
+ */
+uint32_t get_count_mapped_blocks(const struct inode* inode_source) {
+	size_t i, end;
+	size_t count_extents = 0;
+	uint32_t count = 0;
+	uint32_t block[sb.count_links];
+	struct extent* extents = NULL;
+
+	if (isinline(inode_source)) {
+		return 0;
+	}
+	if (isextent(inode_source)) {
+		extents = get_extents(inode_source, &count_extents);
+		for (i = 0; i < count_extents; ++i) {
+			if (extents[i].logical + extents[i].length > count)
+				count = extents[i].logical + extents[i].length;
+		}
+		if (extents)
+			free(extents);
+		return count;
+	}
+
+	// links are searched from the end, blocks with links have always some link in them
+	for (i = COUNT_INDIRECT_LINKS_2; i-- > 0; ) {
+		if (inode_source->indirect_2[i] == FREE_LINK)
+			continue;
+		fs_read_link(block, sb.count_links, inode_source->indirect_2[i]);
+		if ((end = get_links_end_(block, sb.count_links)) == 0)
+			continue;
+		count = COUNT_DIRECT_LINKS + COUNT_INDIRECT_LINKS_1 * sb.count_links
+				+ (i * sb.count_links + end - 1) * sb.count_links;
+		fs_read_link(block, sb.count_links, block[end - 1]);
+		return count + get_links_end_(block, sb.count_links);
+	}
+	for (i = COUNT_INDIRECT_LINKS_1; i-- > 0; ) {
+		if (inode_source->indirect_1[i] == FREE_LINK)
+			continue;
+		fs_read_link(block, sb.count_links, inode_source->indirect_1[i]);
+		if ((end = get_links_end_(block, sb.count_links)) == 0)
+			continue;
+		return COUNT_DIRECT_LINKS + i * sb.count_links + end;
+	}
+	return get_links_end_(inode_source->direct, COUNT_DIRECT_LINKS);
+}
+
 // ---------- LINK FREE -------------------------------------------------------
 
 /*
@@ -72,13 +199,26 @@ int iterate_links(const struct inode* inode_source, void* carry, bool (*callback
  * and free the block in bitmap. This invalidates the link.
  * Link must not be used further in function,
  * which calls this function and it should be set to FREE_LINK.
+ * Block shared with other file only loses one reference and is kept.
  */
 static int free_link_(const uint32_t id_block) {
-	// NOTE possible optimization -- static char block[FS_BLOCK_SIZE] = {0};
-	//  but FS_BLOCK_SIZE has to be visible here, now it is only in format.c
-	char block[sb.block_size];
-	memset(block, '\0', sb.block_size);
-	fs_write_data(block, sb.block_size, id_block);
+	// block of zeros is kept, until filesystem with other block size is used
+	static char* zeros = NULL;
+	static uint32_t zeros_size = 0;
+
+	if (unshare_blocks(id_block, 1, NULL) > 0) {
+		return RETURN_SUCCESS;
+	}
+	if (zeros_size != sb.block_size) {
+		free(zeros);
+		if ((zeros = calloc(sb.block_size, sizeof(char))) == NULL) {
+			zeros_size = 0;
+			set_myerrno(Err_malloc);
+			return RETURN_FAILURE;
+		}
+		zeros_size = sb.block_size;
+	}
+	fs_write_data(zeros, sb.block_size, id_block);
 	free_bitmap_field_data(id_block);
 	return RETURN_SUCCESS;
 }
@@ -144,6 +284,19 @@ static int free_all_indirect_2_links(const uint32_t* links, const size_t count)
 int free_all_links(struct inode* inode_source) {
 	size_t i;
 
+	// file without data is not compressed, nor has preallocated blocks
+	inode_source->flags &= ~(INODE_FLAG_COMPRESSED | INODE_FLAG_PREALLOC);
+
+	// inline inode has no links to free, only its inline data are cleared
+	if (isinline(inode_source)) {
+		memset(inline_data(inode_source), FREE_LINK, INODE_INLINE_SIZE);
+		inode_source->flags &= ~INODE_FLAG_INLINE;
+		return RETURN_SUCCESS;
+	}
+	if (isextent(inode_source)) {
+		return free_all_extents(inode_source);
+	}
+
 	// free links of given inode
 	free_all_direct_links(inode_source->direct, COUNT_DIRECT_LINKS);
 	free_all_indirect_1_links(inode_source->indirect_1, COUNT_INDIRECT_LINKS_1);
@@ -160,6 +313,117 @@ int free_all_links(struct inode* inode_source) {
 	return RETURN_SUCCESS;
 }
 
+/*
+ * Collect ids of all blocks of given inode to carry -- data blocks
+ * and blocks with links, so they can be released at once by 'free_blocks()'.
+ */
+int collect_all_blocks(const struct inode* inode_source, struct carry_links* carry) {
+	size_t i, ii;
+	uint32_t* block_direct = NULL;
+	uint32_t* block_indirect = NULL;
+
+	if (isinline(inode_source)) {
+		return RETURN_SUCCESS;
+	}
+	if (isextent(inode_source)) {
+		return collect_extent_blocks(inode_source, carry);
+	}
+	if ((block_direct = malloc(2 * sb.count_links * sizeof(uint32_t))) == NULL) {
+		set_myerrno(Err_malloc);
+		return RETURN_FAILURE;
+	}
+	block_indirect = block_direct + sb.count_links;
+
+	// callback returns true on error during mallocation
+	if (collect_links(inode_source->direct, COUNT_DIRECT_LINKS, carry)
+			|| collect_links(inode_source->indirect_1, COUNT_INDIRECT_LINKS_1, carry)
+			|| collect_links(inode_source->indirect_2, COUNT_INDIRECT_LINKS_2, carry)) {
+		goto fail;
+	}
+	for (i = 0; i < COUNT_INDIRECT_LINKS_1; ++i) {
+		if (inode_source->indirect_1[i] == FREE_LINK)
+			continue;
+		fs_read_link(block_direct, sb.count_links, inode_source->indirect_1[i]);
+		if (collect_links(block_direct, sb.count_links, carry))
+			goto fail;
+	}
+	for (ii = 0; ii < COUNT_INDIRECT_LINKS_2; ++ii) {
+		if (inode_source->indirect_2[ii] == FREE_LINK)
+			continue;
+		fs_read_link(block_indirect, sb.count_links, inode_source->indirect_2[ii]);
+		if (collect_links(block_indirect, sb.count_links, carry))
+			goto fail;
+
+		for (i = 0; i < sb.count_links; ++i) {
+			if (block_indirect[i] == FREE_LINK)
+				continue;
+			fs_read_link(block_direct, sb.count_links, block_indirect[i]);
+			if (collect_links(block_direct, sb.count_links, carry))
+				goto fail;
+		}
+	}
+
+	free(block_direct);
+	return RETURN_SUCCESS;
+
+fail:
+	free(block_direct);
+	return RETURN_FAILURE;
+}
+
+static int compare_block_id(const void* a, const void* b) {
+	const uint32_t id_a = *(const uint32_t*) a;
+	const uint32_t id_b = *(const uint32_t*) b;
+	return (id_a > id_b) - (id_a < id_b);
+}
+
+/*
+ * Release given blocks at once, e.g. blocks of whole removed tree. Ids are sorted,
+ * so each run of following blocks is cleared by one write and released in bitmap
+ * together. Blocks shared with other file only lose one reference and are kept.
+ * Block listed more times (shared within the given blocks) is released with its last id.
+ */
+int free_blocks(uint32_t* ids, const size_t count) {
+	size_t i, j, k, m, length;
+	size_t run_max = sb.count_links;		// cleared blocks are written by runs of this length
+	bool* is_shared = NULL;
+	char* zeros = NULL;
+
+	qsort(ids, count, sizeof(uint32_t), compare_block_id);
+
+	// releasing can't fail, so release blocks one by one without memory
+	if ((zeros = calloc(run_max, sb.block_size)) == NULL
+			|| (is_shared = malloc(run_max * sizeof(bool))) == NULL) {
+		free(zeros);
+		return free_links_array_(ids, count);
+	}
+
+	for (i = 0; i < count; i = j) {
+		for (j = i + 1; j < count && j - i < run_max && ids[j] == ids[j - 1] + 1; ++j)
+			;
+		length = j - i;
+
+		if (unshare_blocks(ids[i], length, is_shared) == 0) {
+			fs_write_blocks(zeros, length, ids[i]);
+			free_bitmap_range_data(ids[i], length);
+			continue;
+		}
+		// parts of run between shared blocks are released
+		for (k = 0; k < length; k = m) {
+			for (m = k + 1; m < length && is_shared[m] == is_shared[k]; ++m)
+				;
+			if (is_shared[k])
+				continue;
+			fs_write_blocks(zeros, m - k, ids[i] + k);
+			free_bitmap_range_data(ids[i] + k, m - k);
+		}
+	}
+
+	free(is_shared);
+	free(zeros);
+	return RETURN_SUCCESS;
+}
+
 static int free_direct_links(size_t* freed, const size_t to_free,
 							 uint32_t* direct_links, const size_t links_count) {
 	size_t i, ii;
@@ -243,6 +507,10 @@ static int free_indirect_2_links(size_t* freed, const size_t to_free,
  */
 int free_amount_of_links(struct inode* inode_target, const size_t to_free) {
 	size_t freed = 0;
+
+	if (isextent(inode_target)) {
+		return free_amount_of_extents(inode_target, to_free);
+	}
 	free_indirect_2_links(&freed, to_free, inode_target->indirect_2, COUNT_INDIRECT_LINKS_2);
 	free_indirect_1_links(&freed, to_free, inode_target->indirect_1, COUNT_INDIRECT_LINKS_1);
 	free_direct_links(&freed, to_free, inode_target->direct, COUNT_DIRECT_LINKS);
@@ -446,6 +714,10 @@ static int create_indirect_links_2(uint32_t** buffer, size_t* created, const siz
 int create_empty_links(uint32_t* buffer, const size_t to_create, struct inode* inode_source) {
 	size_t created = 0;
 	struct inode inode_tmp;
+
+	if (isextent(inode_source)) {
+		return create_empty_extents(buffer, to_create, inode_source);
+	}
 	memcpy(&inode_tmp, inode_source, sizeof(struct inode));
 
 	if (create_direct_links(&buffer, &created, to_create,
@@ -499,3 +771,415 @@ free_direct:
 	set_myerrno(Err_inode_no_links);
 	return RETURN_FAILURE;
 }
+
+// ---------- LINK MAP --------------------------------------------------------
+
+enum link_walk {
+	walk_create,	// missing blocks on the way are allocated
+	walk_release,	// data block is released, so are blocks with links, which become empty
+	walk_unmap,		// the same as release, but data block itself is kept
+};
+
+/*
+ * Find link to data block with given index in file (logical block) and create
+ * or release the data block there. Blocks with links on the way are allocated
+ * as needed, or released, when there are no more links in them.
+ * When creating, link is set to 'id_set' instead, if it is not 'FREE_LINK'.
+ * Only blocks with links are written, inode itself must be written by caller.
+ * Returns id of created (or already existing) or released block,
+ * or 'FREE_LINK', if there is no block to release, or no free block to create.
+ */
+static uint32_t walk_link_(struct inode* inode_target, const size_t logical_block,
+						   const enum link_walk walk, const uint32_t id_set) {
+	size_t level, depth = 0;
+	size_t index = logical_block;
+	size_t path[2] = {0};
+	bool created[3] = {false, false, false};
+	uint32_t ids[2] = {FREE_LINK, FREE_LINK};
+	uint32_t blocks[2][sb.count_links];
+	uint32_t* root = NULL;
+	uint32_t* slot = NULL;
+	uint32_t id_data = FREE_LINK;
+
+	// position of the link is computed the same way as in 'bmap()'
+	if (index < COUNT_DIRECT_LINKS) {
+		root = &inode_target->direct[index];
+	}
+	else if ((index -= COUNT_DIRECT_LINKS) < COUNT_INDIRECT_LINKS_1 * sb.count_links) {
+		root = &inode_target->indirect_1[index / sb.count_links];
+		path[0] = index % sb.count_links;
+		depth = 1;
+	}
+	else if ((index -= COUNT_INDIRECT_LINKS_1 * sb.count_links)
+			 < COUNT_INDIRECT_LINKS_2 * sb.count_links * sb.count_links) {
+		root = &inode_target->indirect_2[index / (sb.count_links * sb.count_links)];
+		index %= sb.count_links * sb.count_links;
+		path[0] = index / sb.count_links;
+		path[1] = index % sb.count_links;
+		depth = 2;
+	}
+	else {
+		return FREE_LINK;
+	}
+
+	// go down through blocks with links
+	slot = root;
+	for (level = 0; level < depth; ++level) {
+		if (*slot != FREE_LINK) {
+			fs_read_link(blocks[level], sb.count_links, *slot);
+		}
+		else if (walk != walk_create) {
+			return FREE_LINK; // hole
+		}
+		else if ((*slot = init_link_()) != FREE_LINK) {
+			memset(blocks[level], FREE_LINK, sizeof(blocks[level]));
+			created[level] = true;
+		}
+		else {
+			goto fail;
+		}
+		ids[level] = *slot;
+		slot = &blocks[level][path[level]];
+	}
+
+	if (walk == walk_create) {
+		if (id_set != FREE_LINK) {
+			*slot = id_set;
+			created[depth] = true;
+		}
+		else if (*slot == FREE_LINK) {
+			if ((*slot = init_link_()) == FREE_LINK)
+				goto fail;
+			created[depth] = true;
+		}
+		// block with links is written, when link in it was changed
+		for (level = 0; level < depth; ++level) {
+			if (created[level] || created[level + 1])
+				fs_write_link(blocks[level], sb.count_links, ids[level]);
+		}
+		return *slot;
+	}
+
+	if (*slot == FREE_LINK) {
+		return FREE_LINK; // hole
+	}
+	id_data = *slot;
+	if (walk == walk_release)
+		free_link_(id_data);
+	*slot = FREE_LINK;
+
+	// blocks with links are written from the bottom, empty ones are released
+	for (level = depth; level > 0; --level) {
+		if (get_count_links(blocks[level - 1]) > 0) {
+			fs_write_link(blocks[level - 1], sb.count_links, ids[level - 1]);
+			break;
+		}
+		free_link_(ids[level - 1]);
+		if (level == 1)
+			*root = FREE_LINK;
+		else
+			blocks[level - 2][path[level - 2]] = FREE_LINK;
+	}
+	return id_data;
+
+fail:
+	// new blocks with links were not written yet, so only bitmap is reset
+	for (level = 0; level < depth; ++level) {
+		if (created[level])
+			free_bitmap_field_data(ids[level]);
+	}
+	if (created[0])
+		*root = FREE_LINK;
+	return FREE_LINK;
+}
+
+/*
+ * Get ids of data blocks in given range of file (logical blocks), holes are 'FREE_LINK'.
+ */
+static int map_range_(uint32_t* buffer, const uint32_t logical_block, const size_t count,
+					  const struct inode* inode_source) {
+	size_t i, j, count_extents = 0;
+	struct extent* extents = NULL;
+
+	if (!isextent(inode_source)) {
+		for (i = 0; i < count; ++i) {
+			buffer[i] = bmap(inode_source, logical_block + i);
+		}
+		return RETURN_SUCCESS;
+	}
+
+	// extents are loaded only once for whole range
+	reset_myerrno();
+	if ((extents = get_extents(inode_source, &count_extents)) == NULL && is_error()) {
+		return RETURN_FAILURE;
+	}
+	memset(buffer, FREE_LINK, count * sizeof(uint32_t));
+	for (i = 0; i < count_extents; ++i) {
+		for (j = 0; j < extents[i].length; ++j) {
+			if (extents[i].logical + j >= logical_block && extents[i].logical + j - logical_block < count)
+				buffer[extents[i].logical + j - logical_block] = extents[i].start + j;
+		}
+	}
+	if (extents)
+		free(extents);
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Map given range of file (logical blocks) to run of existing data blocks starting at 'start'.
+ * Blocks mapped in the range before are not released, caller takes care of them.
+ * The range must be whole mapped, or be a hole. If the range can't be mapped,
+ * it is left as it was.
+ */
+int map_links_at(struct inode* inode_target, const uint32_t logical_block, const uint32_t start,
+				 const uint32_t length) {
+	size_t i;
+
+	if (isextent(inode_target)) {
+		return remap_extents(inode_target, logical_block, start, length);
+	}
+
+	for (i = 0; i < length; ++i) {
+		// only hole may need new blocks with links
+		if (walk_link_(inode_target, logical_block + i, walk_create, start + i) == FREE_LINK) {
+			while (i-- > 0) {
+				walk_link_(inode_target, logical_block + i, walk_unmap, FREE_LINK);
+			}
+			fs_write_inode(inode_target, 1, inode_target->id_inode);
+			set_myerrno(Err_inode_no_links);
+			return RETURN_FAILURE;
+		}
+	}
+	fs_write_inode(inode_target, 1, inode_target->id_inode);
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Give file its own copies of data blocks shared with other files in given range
+ * of file (logical blocks), so the blocks can be written without changing the other files.
+ * Runs of shared blocks are copied to new runs, which are mapped instead of them.
+ */
+static int copy_shared_links_(const uint32_t logical_block, const size_t count, struct inode* inode_target) {
+	size_t i, j, wanted;
+	uint32_t start = FREE_LINK;
+	uint32_t length = 0;
+	uint32_t goal = FREE_LINK;
+	uint32_t* links = NULL;
+	char* block = NULL;
+
+	// range can be long and block big, so both are on heap
+	if ((links = malloc(count * sizeof(uint32_t) + sb.block_size)) == NULL) {
+		set_myerrno(Err_malloc);
+		return RETURN_FAILURE;
+	}
+	block = (char*) (links + count);
+
+	if (map_range_(links, logical_block, count, inode_target) == RETURN_FAILURE) {
+		goto fail;
+	}
+
+	for (i = 0; i < count; i += length) {
+		length = 1;
+		if (links[i] == FREE_LINK || get_block_shares(links[i]) == 0)
+			continue;
+
+		for (wanted = 1; i + wanted < count && links[i + wanted] != FREE_LINK
+						 && get_block_shares(links[i + wanted]) > 0; ++wanted)
+			;
+		goal = i > 0 && links[i - 1] != FREE_LINK ? links[i - 1] + 1 : FREE_LINK;
+		if ((start = allocate_bitmap_range_data(goal, wanted, &length)) == FREE_LINK) {
+			goto fail;
+		}
+		for (j = 0; j < length; ++j) {
+			fs_read_data(block, sb.block_size, links[i + j]);
+			fs_write_data(block, sb.block_size, start + j);
+		}
+
+		if (map_links_at(inode_target, logical_block + i, start, length) == RETURN_FAILURE) {
+			// copies are cleared, so they are released the same way as other blocks
+			memset(block, '\0', sb.block_size);
+			for (j = 0; j < length; ++j) {
+				fs_write_data(block, sb.block_size, start + j);
+			}
+			free_bitmap_range_data(start, length);
+			goto fail;
+		}
+		for (j = 0; j < length; ++j) {
+			unshare_blocks(links[i + j], 1, NULL);
+			links[i + j] = start + j;
+		}
+	}
+	free(links);
+	return RETURN_SUCCESS;
+
+fail:
+	free(links);
+	return RETURN_FAILURE;
+}
+
+/*
+ * Create data blocks in given range of file (logical blocks), so data can be
+ * written at any position of file. Blocks already in the range are kept.
+ * Unlike 'create_empty_links()', which fills first free links, this keeps holes
+ * outside the range, so it is meant for files.
+ * Blocks shared with other files are copied at first, so all of them can be written.
+ * Ids of blocks in the range are put into given buffer.
+ * If not all blocks are created, created blocks are released again.
+ */
+int create_links_at(uint32_t* buffer, const uint32_t logical_block, const size_t to_create,
+					struct inode* inode_source) {
+	size_t i;
+	bool* created = NULL;
+
+	if ((sb.features & FS_FEATURE_REFLINK)
+			&& copy_shared_links_(logical_block, to_create, inode_source) == RETURN_FAILURE) {
+		memset(buffer, FREE_LINK, to_create * sizeof(uint32_t));
+		set_myerrno(Err_inode_no_links);
+		return RETURN_FAILURE;
+	}
+
+	if (isextent(inode_source)) {
+		return create_extents_at(buffer, logical_block, to_create, inode_source);
+	}
+	if ((created = malloc(to_create + 1)) == NULL) {
+		set_myerrno(Err_malloc);
+		return RETURN_FAILURE;
+	}
+
+	for (i = 0; i < to_create; ++i) {
+		created[i] = (buffer[i] = bmap(inode_source, logical_block + i)) == FREE_LINK;
+		if (created[i] && (buffer[i] = walk_link_(inode_source, logical_block + i,
+												  walk_create, FREE_LINK)) == FREE_LINK) {
+			goto fail;
+		}
+	}
+	fs_write_inode(inode_source, 1, inode_source->id_inode);
+	free(created);
+	return RETURN_SUCCESS;
+
+fail:
+	while (i-- > 0) {
+		if (created[i])
+			walk_link_(inode_source, logical_block + i, walk_release, FREE_LINK);
+		buffer[i] = FREE_LINK;
+	}
+	fs_write_inode(inode_source, 1, inode_source->id_inode);
+	free(created);
+	set_myerrno(Err_inode_no_links);
+	return RETURN_FAILURE;
+}
+
+/*
+ * Allocate data blocks for holes in given range of file (logical blocks), so the range
+ * can be written later without allocation. Each hole gets a run of blocks placed right
+ * after the preceding block, when possible. Blocks already in the range are kept.
+ * New blocks are not written -- released blocks are always cleared, so they read as zeros.
+ * Blocks allocated before a failure are kept in file.
+ */
+int preallocate_links(struct inode* inode_target, const uint32_t logical_block, const size_t count) {
+	size_t i, batch, wanted;
+	uint32_t start = FREE_LINK;
+	uint32_t length = 0;
+	uint32_t goal = FREE_LINK;
+	uint32_t* links = NULL;
+
+	if ((links = malloc(sb.count_links * sizeof(uint32_t))) == NULL) {
+		set_myerrno(Err_malloc);
+		return RETURN_FAILURE;
+	}
+
+	// range is mapped by blocks of links, so the array of ids has limited size
+	for (batch = 0; batch < count; batch += sb.count_links) {
+		wanted = count - batch < sb.count_links ? count - batch : sb.count_links;
+		// extents are extended with runs continuing them, the same way as when writing
+		if (isextent(inode_target)) {
+			if (create_extents_at(links, logical_block + batch, wanted, inode_target) == RETURN_FAILURE)
+				goto fail;
+			continue;
+		}
+		if (map_range_(links, logical_block + batch, wanted, inode_target) == RETURN_FAILURE) {
+			goto fail;
+		}
+
+		for (i = 0; i < wanted; i += length) {
+			length = 1;
+			if (links[i] != FREE_LINK) {
+				goal = links[i] + 1;
+				continue;
+			}
+			for (length = 1; i + length < wanted && links[i + length] == FREE_LINK; ++length)
+				;
+			if ((start = allocate_bitmap_range_data(goal, length, &length)) == FREE_LINK) {
+				goto fail;
+			}
+			if (map_links_at(inode_target, logical_block + batch + i, start, length) == RETURN_FAILURE) {
+				free_bitmap_range_data(start, length);
+				goto fail;
+			}
+			goal = start + length;
+		}
+	}
+
+	free(links);
+	return RETURN_SUCCESS;
+
+fail:
+	free(links);
+	return RETURN_FAILURE;
+}
+
+/*
+ * Release data blocks in given range of file (logical blocks), so there is a hole.
+ * Holes already in the range are skipped.
+ */
+int free_links_range(struct inode* inode_target, const uint32_t logical_block, const size_t to_free) {
+	size_t i;
+
+	if (isextent(inode_target)) {
+		return free_extents_range(inode_target, logical_block, to_free);
+	}
+
+	for (i = 0; i < to_free; ++i) {
+		walk_link_(inode_target, logical_block + i, walk_release, FREE_LINK);
+	}
+	fs_write_inode(inode_target, 1, inode_target->id_inode);
+	return RETURN_SUCCESS;
+}
+
+/*
+ * Map data blocks of file 'inode_target' to the same blocks as of 'inode_source',
+ * so they share the data, which are copied only when one of the files writes them.
+ * Target must be empty file mapped the same way as the source.
+ */
+int share_links(const struct inode* inode_source, struct inode* inode_target) {
+	size_t i;
+	uint32_t id_block = FREE_LINK;
+	uint32_t count_blocks = get_count_data_blocks(inode_source->file_size);
+
+	if (!(sb.features & FS_FEATURE_REFLINK)) {
+		set_myerrno(Err_fs_no_feature);
+		return RETURN_FAILURE;
+	}
+	if (isextent(inode_source)) {
+		return share_extents(inode_source, inode_target);
+	}
+
+	for (i = 0; i < count_blocks; ++i) {
+		if ((id_block = bmap(inode_source, i)) == FREE_LINK)
+			continue; // hole
+		if (share_blocks(id_block, 1) == RETURN_FAILURE)
+			goto fail;
+		if (walk_link_(inode_target, i, walk_create, id_block) == FREE_LINK) {
+			unshare_blocks(id_block, 1, NULL);
+			goto fail;
+		}
+	}
+	fs_write_inode(inode_target, 1, inode_target->id_inode);
+	return RETURN_SUCCESS;
+
+fail:
+	// shared blocks only lose the reference
+	free_all_links(inode_target);
+	fs_write_inode(inode_target, 1, inode_target->id_inode);
+	return RETURN_FAILURE;
+}
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <libgen.h>
+#include <unistd.h>
 
 #include "simulator.h"
 #include "fs_api.h"
@@ -11,34 +12,36 @@
 
 
 static void init_prompt() {
-	// create initial pwd, 2 for null terminator
+	// create initial pwd and path, 2 for null terminator
 	strncpy(buff_pwd, SEPARATOR, 2);
+	strncpy(buff_cwd, SEPARATOR, 2);
 	// create prompt
 	snprintf(buff_prompt, BUFFER_PROMPT_LENGTH, FORMAT_PROMPT, fs_name, buff_pwd);
 }
 
-static int handle_input(char* command, char* arg1, char* arg2) {
+static int handle_input(char* command, char* arg1, char* arg2, char* arg3) {
 	int ret = RETURN_FAILURE;
 
 	// discard char
 	static int c = 0;
-	// program buffer for user's inputs; 3x more for 'command', 'arg1' and 'arg2'
-	static char buff_in[3 * BUFFER_INPUT_LENGTH] = {0};
+	// program buffer for user's inputs; 4x more for 'command', 'arg1', 'arg2' and 'arg3'
+	static char buff_in[4 * BUFFER_INPUT_LENGTH] = {0};
 
 	// receive valid input from user, prevent empty of large input
-	if ((fgets(buff_in, 3 * BUFFER_INPUT_LENGTH, stdin) != NULL)) {
+	if ((fgets(buff_in, 4 * BUFFER_INPUT_LENGTH, stdin) != NULL)) {
 		// prevent overflowing input, so it doesn't go to next cycle
-		if (isoverflow(buff_in[3 * BUFFER_INPUT_LENGTH - 2])) {
+		if (isoverflow(buff_in[4 * BUFFER_INPUT_LENGTH - 2])) {
 			// discard everything in stdin and move on
 			while ((c = fgetc(stdin)) != '\n' && c != EOF);
 			puts("input too large");
 		}
 		// input from user is ok, so scan it
-		else if (sscanf(buff_in, "%s %s %s", command, arg1, arg2) > 0) {
+		else if (sscanf(buff_in, "%s %s %s %s", command, arg1, arg2, arg3) > 0) {
 			// in case some word is longer than BUFFER_INPUT_LENGTH
 			command[BUFFER_INPUT_LENGTH - 1] = '\0';
 			arg1[BUFFER_INPUT_LENGTH - 1] = '\0';
 			arg2[BUFFER_INPUT_LENGTH - 1] = '\0';
+			arg3[BUFFER_INPUT_LENGTH - 1] = '\0';
 			ret = RETURN_SUCCESS;
 		}
 	}
@@ -50,8 +53,8 @@ static int handle_input(char* command, char* arg1, char* arg2) {
 	return ret;
 }
 
-static void sim_format_(const char* arg1) {
-	if (sim_format(arg1, fs_name) == RETURN_FAILURE) {
+static void sim_format_(const char* arg1, const char* arg2, const char* arg3) {
+	if (sim_format(arg1, arg2, arg3, fs_name) == RETURN_FAILURE) {
 		is_formatted = false;
 		my_perror(CMD_FORMAT);
 		reset_myerrno();
@@ -62,7 +65,11 @@ static void sim_format_(const char* arg1) {
 }
 
 static void sim_help() {
-	puts(PR_USAGE);
+	fputs(PR_USAGE_FS, stdout);
+	fputs(PR_USAGE_FILES, stdout);
+	fputs(PR_USAGE_ITEMS, stdout);
+	fputs(PR_USAGE_COPY, stdout);
+	puts(PR_USAGE_TOOLS);
 }
 
 static void sim_exit() {
@@ -113,6 +120,20 @@ static int get_command_id(const char* command) {
 	if (strcmp(command, CMD_HELP) == 0)		return CMD_HELP_ID;
 	if (strcmp(command, CMD_EXIT) == 0)		return CMD_EXIT_ID;
 	if (strcmp(command, CMD_DEBUG) == 0)	return CMD_DEBUG_ID;
+	if (strcmp(command, CMD_COMPACT) == 0)	return CMD_COMPACT_ID;
+	if (strcmp(command, CMD_HEAD) == 0)		return CMD_HEAD_ID;
+	if (strcmp(command, CMD_TAIL) == 0)		return CMD_TAIL_ID;
+	if (strcmp(command, CMD_OPEN) == 0)		return CMD_OPEN_ID;
+	if (strcmp(command, CMD_CLOSE) == 0)	return CMD_CLOSE_ID;
+	if (strcmp(command, CMD_READ) == 0)		return CMD_READ_ID;
+	if (strcmp(command, CMD_WRITE) == 0)	return CMD_WRITE_ID;
+	if (strcmp(command, CMD_SEEK) == 0)		return CMD_SEEK_ID;
+	if (strcmp(command, CMD_TRUNCATE) == 0)	return CMD_TRUNCATE_ID;
+	if (strcmp(command, CMD_APPEND) == 0)	return CMD_APPEND_ID;
+	if (strcmp(command, CMD_SYNC) == 0)		return CMD_SYNC_ID;
+	if (strcmp(command, CMD_LN) == 0)		return CMD_LN_ID;
+	if (strcmp(command, CMD_DEDUP) == 0)	return CMD_DEDUP_ID;
+	if (strcmp(command, CMD_FALLOC) == 0)	return CMD_FALLOC_ID;
 	return CMD_UNKNOWN_ID;
 }
 
@@ -129,23 +150,28 @@ void run() {
 	char command[BUFFER_INPUT_LENGTH] = {0};
 	char arg1[BUFFER_INPUT_LENGTH] = {0};
 	char arg2[BUFFER_INPUT_LENGTH] = {0};
+	char arg3[BUFFER_INPUT_LENGTH] = {0};
+	// prompt is printed only to user, it would be mixed with output of scripts
+	bool is_interactive = isatty(STDIN_FILENO) && isatty(STDOUT_FILENO);
 	is_running = true;
 
 	while (is_running) {
-		fputs(buff_prompt, stdout);
+		if (is_interactive)
+			fputs(buff_prompt, stdout);
 
 		// clear buffers, so command doesn't accidentally receive
 		// wrong argument(s) from previous iteration
 		BUFFER_CLEAR(command);
 		BUFFER_CLEAR(arg1);
 		BUFFER_CLEAR(arg2);
+		BUFFER_CLEAR(arg3);
 
-		if (handle_input(command, arg1, arg2) == RETURN_SUCCESS) {
+		if (handle_input(command, arg1, arg2, arg3) == RETURN_SUCCESS) {
 			cmd_id = get_command_id(command);
 
 			// only basic commands allowed before formatting
 			switch (cmd_id) {
-				case CMD_FORMAT_ID: sim_format_(arg1);	continue;
+				case CMD_FORMAT_ID: sim_format_(arg1, arg2, arg3);	continue;
 				case CMD_HELP_ID:	sim_help();			continue;
 				case CMD_EXIT_ID:	sim_exit();			continue;
 				default:
@@ -159,22 +185,36 @@ void run() {
 			// all commands allowed, when filesystem is formatted
 			switch (cmd_id) {
 				case CMD_PWD_ID:	error = sim_pwd();				break;
-				case CMD_CAT_ID:	error = sim_cat(arg1);			break;
-				case CMD_LS_ID:		error = sim_ls(arg1);			break;
+				case CMD_CAT_ID:	error = sim_cat(arg1, arg2, arg3);	break;
+				case CMD_LS_ID:		error = sim_ls(arg1, arg2);		break;
 				case CMD_INFO_ID:	error = sim_info(arg1);			break;
 				case CMD_MV_ID:		error = sim_mv(arg1, arg2);		break;
-				case CMD_CP_ID:		error = sim_cp(arg1, arg2);		break;
-				case CMD_RM_ID:		error = sim_rm(arg1);			break;
+				case CMD_CP_ID:		error = sim_cp(arg1, arg2, arg3);	break;
+				case CMD_RM_ID:		error = sim_rm(arg1, arg2);		break;
 				case CMD_CD_ID:		error = sim_cd(arg1);			break;
 				case CMD_MKDIR_ID:	error = sim_mkdir(arg1);		break;
 				case CMD_RMDIR_ID:	error = sim_rmdir(arg1);		break;
-				case CMD_INCP_ID:	error = sim_incp(arg1, arg2);	break;
-				case CMD_OUTCP_ID:	error = sim_outcp(arg1, arg2);	break;
+				case CMD_INCP_ID:	error = sim_incp(arg1, arg2, arg3);	break;
+				case CMD_OUTCP_ID:	error = sim_outcp(arg1, arg2, arg3);	break;
 				case CMD_DF_ID:		error = sim_df(arg1, arg2);		break;
 				case CMD_LOAD_ID:	error = sim_load(arg1);			break;
 				case CMD_FSCK_ID:	error = sim_fsck();				break;
 				case CMD_CORRUPT_ID:error = sim_corrupt();			break;
 				case CMD_DEBUG_ID:	error = sim_debug(arg1, arg2);	break;
+				case CMD_COMPACT_ID:error = sim_compact(arg1);		break;
+				case CMD_HEAD_ID:	error = sim_head(arg1, arg2);	break;
+				case CMD_TAIL_ID:	error = sim_tail(arg1, arg2);	break;
+				case CMD_OPEN_ID:	error = sim_open(arg1);			break;
+				case CMD_CLOSE_ID:	error = sim_close(arg1);		break;
+				case CMD_READ_ID:	error = sim_read(arg1, arg2, arg3);	break;
+				case CMD_WRITE_ID:	error = sim_write(arg1, arg2, arg3);	break;
+				case CMD_SEEK_ID:	error = sim_seek(arg1, arg2, arg3);	break;
+				case CMD_TRUNCATE_ID:error = sim_truncate(arg1, arg2);	break;
+				case CMD_APPEND_ID:	error = sim_append(arg1, arg2);	break;
+				case CMD_SYNC_ID:	error = sim_sync(arg1, arg2);	break;
+				case CMD_LN_ID:		error = sim_ln(arg1, arg2);		break;
+				case CMD_DEDUP_ID:	error = sim_dedup();			break;
+				case CMD_FALLOC_ID:	error = sim_falloc(arg1, arg2);	break;
 				default:
 					puts("-zos: command not found");
 			}
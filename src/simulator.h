@@ -7,25 +7,78 @@
 #include "fs_prompt.h"
 #include "inode.h"
 
-#define PR_USAGE 	"Available commands:\n" \
-					"  format  SIZE              Format filesystem of SIZE in megabytes (MB).\n" \
-					"                            If filesystem already exists, the data inside will be destroyed.\n" \
+// usage is split to groups of commands, so each literal has length supported by C99 compilers
+#define PR_USAGE_FS	"Available commands:\n" \
+					"  format  SIZE [BLOCKSIZE] [OPTIONS]\n" \
+					"                            Format filesystem of SIZE in megabytes (MB) with blocks\n" \
+					"                            of BLOCKSIZE bytes (power of 2 from 512 to 65536, 1024 by default).\n" \
+					"                            OPTIONS are separated by commas, e.g. --dedup,--no-extents:\n" \
+					"                              --dedup        identical data blocks are shared, as they are written\n" \
+					"                              --no-inline    small files and directories use data blocks\n" \
+					"                              --no-varlen    directory items have fixed length, short names\n" \
+					"                              --no-extents   files are mapped by direct and indirect links\n" \
+					"                              --no-compress  files can't be compressed (incp --compress)\n" \
+					"                            If filesystem already exists, the data inside will be destroyed.\n"
+
+#define PR_USAGE_FILES \
 					"  pwd                       Print the working directory.\n" \
-					"  cat     FILE              Concatenate FILE to standard output.\n" \
-					"  ls      [FILE]            List information about the FILE (the current directory by default).\n" \
+					"  cat     FILE [OFFSET [LENGTH]]\n" \
+					"                            Concatenate FILE to standard output,\n" \
+					"                            or only LENGTH bytes from OFFSET (rest of FILE by default).\n" \
+					"  head    FILE [BYTES]      Print first BYTES of FILE (1024 by default).\n" \
+					"  tail    FILE [BYTES]      Print last BYTES of FILE (1024 by default).\n" \
+					"  open    FILE              Open FILE (created if missing) and print its descriptor FD.\n" \
+					"  close   FD                Close open file FD.\n" \
+					"  read    FD LENGTH [OFFSET]\n" \
+					"                            Print LENGTH bytes of FD from its position, or from OFFSET.\n" \
+					"  write   FD TEXT [OFFSET]  Write TEXT to FD at its position, or at OFFSET.\n" \
+					"  seek    FD OFFSET [cur|end]\n" \
+					"                            Move position of FD to OFFSET from start, actual position or end.\n" \
+					"  truncate FD SIZE          Cut FD to SIZE bytes, or extend it with zeros.\n" \
+					"  falloc  FILE SIZE         Reserve contiguous blocks for first SIZE bytes of FILE\n" \
+					"                            (created if missing), size of FILE is kept.\n"
+
+#define PR_USAGE_ITEMS \
+					"  ls      [-n|-s] [FILE]    List information about the FILE (the current directory by default).\n" \
+					"                            Items are sorted by name with -n, or by size with -s.\n" \
 					"  info    FILE|DIRECTORY    Print information about FILE or DIRECTORY in format\n" \
 					"                            \"NAME-SIZE-inode NUMBER-direct/indirect links\".\n" \
 					"  mv      SOURCE DEST       Rename SOURCE to DEST, or move SOURCE to DIRECTORY.\n" \
-					"  cp      SOURCE DEST       Copy SOURCE to DEST.\n" \
-					"  rm      FILE              Remove (unlink) the FILE.\n" \
+					"  cp      [--reflink|-r] SOURCE DEST\n" \
+					"                            Copy SOURCE to DEST. With --reflink, data blocks are shared\n" \
+					"                            and copied only when one of the files is written.\n" \
+					"                            With -r, directory SOURCE is copied with all its items.\n" \
+					"  ln      TARGET LINK       Create hard LINK to file TARGET, both names share the same data.\n" \
+					"  rm      [-r] FILE         Remove (unlink) the FILE, its data are freed with its last link.\n" \
+					"                            With -r, directory FILE is removed with all its items.\n" \
 					"  cd      [DIRECTORY]       Change the working DIRECTORY.\n" \
 					"  mkdir   DIRECTORY         Create the DIRECTORY, if they do not already exist.\n" \
-					"  rmdir   DIRECTORY         Remove the DIRECTORY, if they are empty.\n" \
-					"  incp    SOURCE DEST       Copy file from SOURCE on local HDD to DEST in filesystem.\n" \
-					"  outcp   SOURCE DEST       Copy file from SOURCE in filesystem to DEST on local HDD.\n" \
+					"  rmdir   DIRECTORY         Remove the DIRECTORY, if they are empty.\n"
+
+#define PR_USAGE_COPY \
+					"  incp    [--compress|-r|--tar] SOURCE DEST\n" \
+					"                            Copy file from SOURCE on local HDD to DEST in filesystem.\n" \
+					"                            With --compress, data are stored compressed.\n" \
+					"                            SOURCE '-' is standard input, pipes are copied until they end.\n" \
+					"                            With -r, directory SOURCE is copied with all its items,\n" \
+					"                            nothing is left of the copy, when it fails.\n" \
+					"                            With --tar, items of tar archive SOURCE are copied into directory DEST,\n" \
+					"                            items copied before a failure are kept.\n" \
+					"  outcp   [-r|--tar] SOURCE DEST\n" \
+					"                            Copy file from SOURCE in filesystem to DEST on local HDD.\n" \
+					"                            With -r, directory SOURCE is copied with all its items,\n" \
+					"                            with --tar, SOURCE is written to tar archive DEST ('-' is stdout).\n" \
+					"  append  SOURCE DEST       Append file from SOURCE on local HDD to end of DEST in filesystem.\n" \
+					"  sync    SOURCE DEST       Update DEST in filesystem from SOURCE on local HDD,\n" \
+					"                            only changed blocks are written.\n"
+
+#define PR_USAGE_TOOLS \
                     "  df                        Print disk filesystem usage -- used and remaining space and inodes.\n" \
 					"  load    FILE              Load FILE with commands and start executing them (1 command = 1 line).\n" \
 					"  fsck                      Check and repair the filesystem.\n" \
+					"  dedup                     Share identical data blocks of all files and release the duplicates.\n" \
+					"  compact [DIRECTORY]       Move items of DIRECTORY forward and release its empty blocks\n" \
+					"                            (the current directory by default).\n" \
                     "  corrupt                   Corrupts filesystem by randomly deleting item records from blocks.\n" \
                     "                            (for 'fsck' presentation)" \
 					"  help                      Print this help.\n" \
@@ -43,6 +96,7 @@ bool is_running;		// is simulation running or not
 
 char fs_name[STRLEN_FS_NAME];			// fs name given by user
 char buff_pwd[STRLEN_PWD_LENGTH];		// fs current working directory
+char buff_cwd[STRLEN_CWD_LENGTH];		// fs whole path to current working directory
 char buff_prompt[BUFFER_PROMPT_LENGTH];	// prompt in console
 
 // super block of actual using filesystem